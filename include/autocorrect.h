@@ -17,9 +17,13 @@
 */
 
 #include "cluster.h"
+#include "lru_cache.h"
 #include "macros.h"
 
+#include <limits>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -33,9 +37,18 @@ class autocorrect_database
 {
 protected:
 
-  UNORDERED_STRING_SET _calls { };                              ///< known good calls
+  static constexpr size_t CACHE_SIZE { 20'000 };     ///< maximum number of entries in the cache
 
-  mutable STRING_MAP<std::string /* output call */> _cache { }; ///< cache of input to output call mapping; key = input call; value = output call
+  UNORDERED_STRING_SET _calls { };                                      ///< known good calls
+  UNORDERED_STRING_MAP<const std::string* /* good call */> _busts { };  ///< busts of the good calls that are produced by the slips that corrected_call() recognises; points into <i>_calls</i>
+
+  mutable lru_cache<std::string, std::string /* output call */, stringly_hash, std::equal_to<>> _cache { CACHE_SIZE };   ///< cache of input to output call mapping; thread safe, as corrected_call() is called from the post_parser workers
+
+/*! \brief          Obtain the output call from an input call, without using the cache
+    \param  str     input call
+    \return         <i>str</i> or a corrected version of same
+*/
+  std::string _corrected_call(const std::string_view str) const;
 
 public:
 
@@ -44,9 +57,17 @@ public:
 
 /*! \brief              Initialise the database from a container of known-good calls
     \param  callsigns   vector of known-good calls
+
+    Also builds the index of busts
 */
-  inline void init_from_calls(const std::vector<std::string>& callsigns)
-    { _calls += callsigns; }
+  void init_from_calls(const std::vector<std::string>& callsigns);
+
+/// number of entries in the index of busts
+  inline size_t n_busts(void) const
+    { return _busts.size(); }
+
+/// cache statistics, as a printable string
+  std::string cache_statistics(void) const;
 
 /*! \brief                  Is a call a known-good call?
     \param  putative_call   target call
@@ -82,14 +103,39 @@ protected:
 
   using F100_TYPE = uint32_t;   // type of frequency measured to 100 Hz
 
+/// the number of appearances of a call in a single minute
+  struct minute_slot
+  { MINUTES_TYPE minute;        ///< the minute
+    uint32_t     call_id;       ///< the call, as an index into <i>_calls</i>
+    uint32_t     count;         ///< number of appearances of the call in the minute
+  };
+
   BAND _b;                      ///< band to which this database applies
 
   F100_TYPE _f_min_100;         ///< minimum frequency in hundreds of Hz
   F100_TYPE _f_max_100;         ///< maximum frequency in hundreds of Hz
 
-  std::map<time_t, std::map<F100_TYPE /* f_100 */, UNORDERED_STRING_MAP<size_t /* number of appearances */>>> _data_map_map_map; // time in minutes, f_100, callsign, number of times the
+  std::vector<std::vector<minute_slot>> _bins;              ///< one bin per 100 Hz from _f_min_100 to _f_max_100; expired slots are reused
+  std::vector<uint32_t>                 _occupied_bins;     ///< indices of the bins that are not empty
+  MINUTES_TYPE                          _retained_from { std::numeric_limits<MINUTES_TYPE>::min() };   ///< slots for earlier minutes have expired
+
+  UNORDERED_STRING_MAP<uint32_t> _call_ids;                 ///< ids of all the calls that have been seen
+  std::vector<std::string>       _calls;                    ///< calls, indexed by id
+
+  std::unordered_map<uint64_t, bool> _busts;                ///< whether a pair of calls is a bust pair; key = two call ids, smaller first
+
+/*! \brief          Obtain the id of a call, creating one if necessary
+    \param  call    call
+    \return         the id of <i>call</i>
+*/
+  uint32_t _call_id(const std::string& call);
 
-  STRING_SET _all_calls;
+/*! \brief          Is one call a bust of another?
+    \param  id1     id of first call
+    \param  id2     id of second call
+    \return         whether the calls with ids <i>id1</i> and <i>id2</i> are busts of each other
+*/
+  bool _is_bust(const uint32_t id1, const uint32_t id2);
 
 // this mutex introduces a lot of pain, as it is non-copyable and non-moveable; it means that instances
 // have first to be default-created, then moved to the correct band, rather than creating in place.
@@ -199,48 +245,4 @@ public:
   std::string autocorrect(const dx_post& post);
 };
 
-// -----------  busts_database  ----------------
-
-/*! \class  busts_database
-    \brief  A database for caching bust and non-bust information
-
-    This class is not thread-safe
-*/
-
-/*! \brief          Generate a single string from a pair of calls
-    \param  call1   first call
-    \param  call2   second call
-    \return         single string to be used as index into sets
-
-    Returns the same string for (call1, call2) and (call2, call1)
-*/
-inline std::string pair_index(const std::string_view call1, const std::string& call2)
-  { return (call1 < call2) ? (call1 + PLUS + call2) : (call2 + PLUS + call1); }
-
-class busts_database
-{
-protected:
-
-  UNORDERED_STRING_SET _known_busts;         ///< all the known bust-pairs
-  UNORDERED_STRING_SET _known_non_busts;     ///< all the known non-bust pairs
-
-public:
-
-/// is a pair of calls a known bust pair? <i>index_string</i> is the result of executing pair_index() on the two calls
-  inline bool is_known_bust(const std::string_view index_string) const
-    { return _known_busts.contains(index_string); }
-
-/// is a pair of calls a known non-bust pair? <i>index_string</i> is the result of executing pair_index() on the two calls
-  inline bool is_known_non_bust(const std::string_view index_string) const
-    { return _known_non_busts.contains(index_string); }
-
-/// add a pair of calls to the set of known busts <i>index_string</i> is the result of executing pair_index() on the two calls
-  inline void known_bust(const std::string_view index_string)
-    { _known_busts += index_string; }
-
-/// add a pair of calls to the set of known non-busts <i>index_string</i> is the result of executing pair_index() on the two calls
-  inline void known_non_bust(const std::string_view index_string)
-    { _known_non_busts += index_string; }
-};
-
 #endif    // AUTOCORRECT.H
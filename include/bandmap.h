@@ -28,10 +28,14 @@
 
 #include <array>
 #include <chrono>
-#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <queue>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 /// possible sources for bandmap entries
 enum class BANDMAP_ENTRY_SOURCE { LOCAL,
@@ -71,25 +75,67 @@ std::string to_string(const BANDMAP_ENTRY_SOURCE bes);
 
 /*! \class  n_posters_database
     \brief  A database for the number of posters of stations
+
+    Calls and posters are interned, and held in a ring of per-minute buckets that covers the window
 */
 
 class n_posters_database
 {
 protected:
 
-  std::map<time_t, UNORDERED_STRING_MAP<UNORDERED_STRING_SET>> _data; ///< time in minutes, callsign, posters; key is call
+/// the calls and posters seen in one minute
+  struct minute_bucket
+  { time_t                                                minute  { -1 };   ///< time in minutes; -1 if unused
+    std::unordered_map<uint32_t, std::vector<uint32_t>>  posters { };      ///< key is call id; value is ascending poster ids
+  };
+
+  std::vector<minute_bucket> _ring { };          ///< one bucket per minute in the window, indexed by time in minutes modulo the size of the window
+
+  UNORDERED_STRING_MAP<uint32_t> _call_ids   { };   ///< interned calls; value is the id of the key
+  std::vector<std::string>       _calls      { };   ///< interned calls; index is the id
+  UNORDERED_STRING_MAP<uint32_t> _poster_ids { };   ///< interned posters; value is the id of the key
+  std::vector<std::string>       _posters    { };   ///< interned posters; index is the id
 
-  UNORDERED_STRING_SET _known_good_calls;        ///< calls whose number of posters meets or exceeds _min_posters
+  std::vector<bool> _known_good_calls { };       ///< whether the number of posters of each call id meets or exceeds _min_posters
 
   int _min_posters { 1 };                                   ///< minumum number of posters needed to appear on bandmap, default = 1
   int _width       { 15 };                                  ///< width in minutes
 
   mutable std::recursive_mutex  _mtx;                       ///< mutex
 
+/*! \brief          Intern a string
+    \param  str     string to intern
+    \param  ids     map from interned strings to their ids
+    \param  strs    interned strings, indexed by id
+    \return         id of <i>str</i>
+*/
+  uint32_t _intern(const std::string& str, UNORDERED_STRING_MAP<uint32_t>& ids, std::vector<std::string>& strs);
+
+/*! \brief          Is a bucket within the window?
+    \param  mb      bucket to test
+    \param  now_m   current time in minutes
+    \return         whether <i>mb</i> holds data from the window that ends at <i>now_m</i>
+*/
+  inline bool _is_current(const minute_bucket& mb, const time_t now_m) const
+    { return ( (mb.minute != -1) and (mb.minute >= (now_m - _width)) ); }
+
+/*! \brief          Test whether a call appears enough times to be considered "good", and mark it as known good if so
+    \param  id      id of the call to test
+    \param  now_m   current time in minutes
+    \return         whether the call with id <i>id</i> is a known good call
+*/
+  bool _test_call_id(const uint32_t id, const time_t now_m);
+
+/*! \brief          Rebuild the record of known good calls from the buckets in the window
+    \param  now_m   current time in minutes
+*/
+  void _rebuild_known_good_calls(const time_t now_m);
+
 public:
 
 /// Constructor
-  n_posters_database(void) = default;
+  inline n_posters_database(void)
+    { _ring.resize(_width + 1); }
 
   READ_AND_WRITE(min_posters);      ///< minumum number of posters needed to appear on bandmap
 
@@ -99,11 +145,11 @@ public:
   void operator+=(const std::pair<std::string /* call */, std::string /* poster */>& pr);
 
 /*! \brief      Get all the times in the database
-    \return     all the times in <i>_data</i>
+    \return     all the times for which the database holds data
 */
   std::set<time_t> times(void) const;
 
-/*! \brief          Test whether a call appears enough times to be considered "good", and add to <i>_known_good_calls</i> if so
+/*! \brief          Test whether a call appears enough times to be considered "good", and mark it as known good if so
     \param  call    call to test
     \return         whether <i>call</i> is a known good call
 */
@@ -120,6 +166,8 @@ public:
 
 /*! \class  needed_mult_details
     \brief  Encapsulate the details of a type of mult associated with a bandmap entry
+
+    The values are held in a sorted vector, as there are rarely more than one or two of them
 */
 
 template<typename T>
@@ -129,7 +177,14 @@ protected:
 
   bool           _is_needed       { false };  ///< are any mult values needed?
   bool           _is_status_known { true };   ///< is the status known for sure?
-  std::set<T>    _values          { };        ///< values that are needed
+  std::vector<T> _values          { };        ///< values that are needed, in order
+
+/*! \brief      Is a value present in <i>_values</i>?
+    \param  v   value to test
+    \return     whether <i>v</i> is present
+*/
+  inline bool _contains(const T& v) const
+    { return std::binary_search(_values.cbegin(), _values.cend(), v); }
 
 public:
 
@@ -140,8 +195,9 @@ public:
     \param  v   needed value
 */
   inline explicit needed_mult_details(const T& v) :
-    _is_needed(true)
-  { _values += v; }
+    _is_needed(true),
+    _values( { v } )
+  { }
 
 /// is any value needed?
   inline bool is_any_value_needed(void) const
@@ -157,7 +213,11 @@ public:
 
 /// return all the needed values (as a set)
   inline std::set<T> values(void) const
-    { return _values; }
+    { return std::set<T> { _values.cbegin(), _values.cend() }; }
+
+/// number of bytes allocated on the heap for the values
+  inline size_t heap_size(void) const
+    { return _values.capacity() * sizeof(T); }
 
 /*! \brief      Add a needed value
     \param  v   needed value
@@ -165,33 +225,28 @@ public:
 */
   bool add(const T& v)
   { _is_needed = true;
-    return (_values.insert(v)).second;
-  }
 
-/*! \brief      Add a needed value
-    \param  v   needed value
-    \return     whether <i>v</i> was actually inserted
-*/
-  void operator+=(const T& v)
-  { _is_needed = true;
-    _values += v;
+    const auto it { std::lower_bound(_values.begin(), _values.end(), v) };
+
+    if ( (it != _values.end()) and (*it == v) )
+      return false;
+
+    _values.insert(it, v);
+    return true;
   }
 
 /*! \brief      Add a needed value
     \param  v   needed value
-    \return     whether <i>v</i> was actually inserted
 */
-  void operator+=(T&& v)
-  { _is_needed = true;
-    _values += std::forward<T>(v);
-  }
+  inline void operator+=(const T& v)
+    { add(v); }
 
 /*! \brief      Is a particular value needed?
     \param  v   value to test
     \return     whether <i>v</i> is needed
 */
   inline bool is_value_needed(const T& v) const
-    { return _is_needed ? !(_values.contains(v)) : false; }
+    { return _is_needed ? !_contains(v) : false; }
 
 /*! \brief      Remove a needed value
     \param  v   value to remove
@@ -200,15 +255,20 @@ public:
     Doesn't remove <i>v</i> if no values are needed; does nothing if <i>v</i> is unknown
 */
   bool remove(const T& v)
-  { if (!_is_needed or !(_values.contains(v)))
+  { if (!_is_needed)
+      return false;
+
+    const auto it { std::lower_bound(_values.begin(), _values.end(), v) };
+
+    if ( (it == _values.end()) or (*it != v) )
       return false;
 
-    const bool rv { (_values.erase(v) == 1) };
+    _values.erase(it);
 
     if (_values.empty())
       _is_needed = false;
 
-    return rv;
+    return true;
   }
 
 /*! \brief      Remove a needed value
@@ -240,9 +300,14 @@ public:
   { unsigned int v { version };   // dummy; for now, version isn't used
     v = v + 0;
 
+    std::set<T> values_set { values() };    // archived as a set, as before
+
     ar & _is_needed
        & _is_status_known
-       & _values;
+       & values_set;
+
+    if constexpr (Archive::is_loading::value)
+      _values.assign(values_set.cbegin(), values_set.cend());
   }
 };
 
@@ -284,6 +349,82 @@ std::ostream& operator<<(std::ostream& ost, const needed_mult_details<T>& nmd)
   return ost;
 }
 
+// -----------  mult_status_cache  ----------------
+
+/*! \class  mult_status_cache
+    \brief  A cache of the mult status of calls on particular bands and modes
+
+    Every entry belongs to one generation of the statistics and of the exchange database;
+    the whole cache is discarded as soon as either generation changes
+*/
+
+class mult_status_cache
+{
+public:
+
+/// the generations of the statistics and the exchange database
+  using generation_type = std::pair<uint32_t /* statistics */, uint32_t /* exchange database */>;
+
+/// the mult status of a call on a band and mode
+  struct mult_status
+  { needed_mult_details<std::pair<std::string, std::string>>  callsign_mult        { };          ///< details of needed callsign mults
+    needed_mult_details<std::string>                          country_mult         { };          ///< details of needed country mults
+    needed_mult_details<std::pair<std::string, std::string>>  exchange_mult        { };          ///< details of needed exchange mults
+    bool                                                      mult_status_is_known { false };    ///< whether the multiplier status is known
+  };
+
+protected:
+
+  UNORDERED_STRING_MAP<std::map<std::pair<BAND, MODE>, mult_status>> _cache { };   ///< key is call
+
+  generation_type _generation { };              ///< generation to which all the entries in <i>_cache</i> belong
+  size_t          _n_entries  { 0 };            ///< number of mult status values in <i>_cache</i>
+  size_t          _max_size   { 20'000 };       ///< maximum number of mult status values before the cache is discarded
+  uint64_t        _n_hits     { 0 };            ///< number of successful lookups
+  uint64_t        _n_misses   { 0 };            ///< number of unsuccessful lookups
+
+  mutable std::mutex _mtx;                      ///< mutex
+
+public:
+
+/// Constructor
+  mult_status_cache(void) = default;
+
+/*! \brief          Look up the mult status of a call on a band and mode
+    \param  call    call to look up
+    \param  b       band
+    \param  m       mode
+    \param  gen     current generation
+    \return         the cached status, if any
+
+    Discards the cache if <i>gen</i> differs from the generation of the cache
+*/
+  std::optional<mult_status> lookup(const std::string_view call, const BAND b, const MODE m, const generation_type& gen);
+
+/*! \brief          Add the mult status of a call on a band and mode
+    \param  call    call
+    \param  b       band
+    \param  m       mode
+    \param  gen     generation that was current when the status was calculated
+    \param  ms      the mult status of <i>call</i> on band <i>b</i> and mode <i>m</i>
+
+    Does nothing if <i>gen</i> is not the generation of the cache
+*/
+  void insert(const std::string& call, const BAND b, const MODE m, const generation_type& gen, const mult_status& ms);
+
+/// number of successful lookups
+  inline uint64_t n_hits(void) const
+    { std::lock_guard<std::mutex> lg(_mtx);
+      return _n_hits;
+    }
+
+/// number of unsuccessful lookups
+  inline uint64_t n_misses(void) const
+    { std::lock_guard<std::mutex> lg(_mtx);
+      return _n_misses;
+    }
+};
+
 // -----------   bandmap_filter_type ----------------
 
 /*! \class  bandmap_filter_type
@@ -298,6 +439,7 @@ protected:
 
   GROUP_TYPE  _continents  { };           ///< continents to filter
   bool        _enabled     { false };     ///< is bandmap filtering enabled?
+  std::atomic<uint32_t> _generation { 0 };     ///< incremented whenever the filter changes; atomic because bandmaps that share the filter read it without a common lock
   bool        _hide        { true };      ///< are we in hide mode? (as opposed to show)
   GROUP_TYPE  _prefixes    { };           ///< canonical country prefixes to filter
 
@@ -306,11 +448,51 @@ public:
 /// default constructor
   bandmap_filter_type(void) = default;
 
+/// copy constructor; std::atomic is not copyable
+  inline bandmap_filter_type(const bandmap_filter_type& bmf) :
+    _continents(bmf._continents),
+    _enabled(bmf._enabled),
+    _generation(bmf._generation.load()),
+    _hide(bmf._hide),
+    _prefixes(bmf._prefixes)
+  { }
+
+/// copy assignment; the generation is incremented, as the filter may have changed
+  inline bandmap_filter_type& operator=(const bandmap_filter_type& bmf)
+  { _continents = bmf._continents;
+    _enabled = bmf._enabled;
+    _hide = bmf._hide;
+    _prefixes = bmf._prefixes;
+    _generation++;
+
+    return *this;
+  }
+
   READ(continents);                             ///< continents to filter
-  READ_AND_WRITE(enabled);                      ///< is bandmap filtering enabled?
-  READ_AND_WRITE(hide);                         ///< are we in hide mode? (as opposed to show)
+  READ(enabled);                                ///< is bandmap filtering enabled?
+  READ(hide);                                   ///< are we in hide mode? (as opposed to show)
   READ(prefixes);                               ///< canonical country prefixes to filter
 
+/// incremented whenever the filter changes
+  inline uint32_t generation(void) const
+    { return _generation; }
+
+/// enable or disable filtering
+  inline void enabled(const bool torf)
+  { if (torf != _enabled)
+    { _enabled = torf;
+      _generation++;
+    }
+  }
+
+/// set or unset hide mode (as opposed to show)
+  inline void hide(const bool torf)
+  { if (torf != _hide)
+    { _hide = torf;
+      _generation++;
+    }
+  }
+
 /*! \brief      Get all the continents and canonical prefixes that are currently being filtered
     \return     all the continents and canonical prefixes that are currently being filtered
 
@@ -337,13 +519,77 @@ public:
        & _enabled
        & _hide
        & _prefixes;
+
+    if constexpr (Archive::is_loading::value)
+      _generation++;                            // anything that depends on the filter must be recalculated
   }
 };
 
+// -----------  interned_string  ----------------
+
+/*! \class  interned_string
+    \brief  A compact reference to an immutable string held in a global pool
+
+    Equal strings share a single copy in the pool, so comparison for equality is a comparison of pointers.
+    Strings are never removed from the pool. Thread safe.
+*/
+
+class interned_string
+{
+protected:
+
+  const std::string* _p { nullptr };          ///< the copy in the pool; nullptr => empty string
+
+/*! \brief          Obtain the copy of a string in the pool, adding it if necessary
+    \param  str     string to look up
+    \return         pointer to the copy of <i>str</i> in the pool; nullptr if <i>str</i> is empty
+*/
+  static const std::string* _intern(const std::string_view str);
+
+public:
+
+/// default constructor
+  interned_string(void) = default;
+
+/*! \brief          Constructor
+    \param  str     string to intern
+*/
+  inline explicit interned_string(const std::string_view str) :
+    _p(_intern(str))
+  { }
+
+/// the string
+  inline const std::string& str(void) const
+    { return (_p ? *_p : EMPTY_STR); }
+
+/// is the string empty?
+  inline bool empty(void) const
+    { return !_p; }
+
+/// are two interned strings equal?
+  inline bool operator==(const interned_string& is) const
+    { return (_p == is._p); }
+
+/// is the string equal to another string?
+  inline bool operator==(const std::string_view sv) const
+    { return (str() == sv); }
+
+/// is the string less than another interned string?
+  inline bool operator<(const interned_string& is) const
+    { return (str() < is.str()); }
+
+/// number of strings in the pool
+  static size_t pool_size(void);
+
+};
+
 // -----------  bandmap_entry  ----------------
 
 /*! \class  bandmap_entry
     \brief  An entry in a bandmap
+
+    Kept compact, because there may be many entries on each band: strings that repeat across entries are interned,
+    and the frequency string is derived from the frequency when needed
 */
 
 class bandmap_entry
@@ -351,13 +597,11 @@ class bandmap_entry
 protected:
 
   BAND                                                      _band;                                  ///< band
-  std::string                                               _callsign;                              ///< call
-  std::string                                               _canonical_prefix;                      ///< canonical prefix corresponding to the call
-  std::string                                               _continent;                             ///< continent corresponding to the call
+  interned_string                                           _callsign;                              ///< call
+  interned_string                                           _canonical_prefix;                      ///< canonical prefix corresponding to the call
+  interned_string                                           _continent;                             ///< continent corresponding to the call
   time_t                                                    _expiration_time  { 0 };                ///< time at which this entry expires (in seconds since the epoch)
-  TIME_POINT                                                _expiration_time_1;                     ///< time at which this entry expires
   frequency                                                 _freq;                                  ///< QRG
-  std::string                                               _frequency_str;                         ///< QRG (kHz, to 1 dp)
   bool                                                      _is_needed { true };                    ///< do we need this call?
   needed_mult_details<std::pair<std::string, std::string>>  _is_needed_callsign_mult;               ///< details of needed callsign mults
   needed_mult_details<std::string>                          _is_needed_country_mult;                ///< details of needed country mults
@@ -379,7 +623,10 @@ public:
   { }
 
   READ(band);                           ///< band
-  READ(callsign);                       ///< call
+
+/// call
+  inline const std::string& callsign(void) const
+    { return _callsign.str(); }
 
 /*! \brief          Set the callsign
     \param  call    the callsign to set
@@ -388,19 +635,35 @@ public:
 */
   bandmap_entry& callsign(const std::string_view call);
 
-  READ(canonical_prefix);               ///< canonical prefix corresponding to the call
-  READ(continent);                      ///< continent corresponding to the call
+/// canonical prefix corresponding to the call
+  inline const std::string& canonical_prefix(void) const
+    { return _canonical_prefix.str(); }
+
+/// continent corresponding to the call
+  inline const std::string& continent(void) const
+    { return _continent.str(); }
+
   READ_AND_WRITE_RET(expiration_time);  ///< time at which this entry expires (in seconds since the epoch)
-  READ_AND_WRITE_RET(expiration_time_1);    ///< time at which this entry expires
 
   READ(freq);                           ///< QRG
 
-/*! \brief      Set <i>_freq</i>, <i>_frequency_str</i>, <i>_band</i> and <i>_mode</i>
+/*! \brief      Set <i>_freq</i>, <i>_band</i> and <i>_mode</i>
     \param  f   frequency used to set the values
 */
   bandmap_entry& freq(const frequency f);
 
-  READ(frequency_str);                  ///< QRG (kHz, to 1 dp)
+/// QRG (kHz, to 1 dp); empty if the frequency has not been set
+  inline std::string frequency_str(void) const
+    { return (_freq.hz() ? _freq.display_string() : std::string { }); }
+
+/*! \brief      Is the frequency string of this entry the same as that of another entry?
+    \param  be  other bandmap entry
+    \return     whether frequency_str() is the same for *this and <i>be</i>
+
+    Compares frequencies rounded to 100 Hz, without constructing the strings
+*/
+  inline bool same_frequency_str(const bandmap_entry& be) const
+    { return (_freq.hz() and be._freq.hz()) ? (_freq.display_hhz() == be._freq.display_hhz()) : (_freq.hz() == be._freq.hz()); }
 
 /// do we need this call?
   inline bool is_needed(void) const
@@ -443,7 +706,9 @@ public:
     \param  statistics  the current statistics
 
     Adjust the mult status in accordance with the passed parameters;
-    Note that the parameters are NOT constant
+    Note that the parameters are NOT constant.
+    Reuses the status calculated for an earlier entry with the same call, band and mode if neither the
+    statistics nor the exchange database have changed since
 */
   void calculate_mult_status(contest_rules& rules, running_statistics& statistics);
 
@@ -540,18 +805,19 @@ public:
   inline bool is_needed_mult(void) const
     { return is_needed_callsign_mult() or is_needed_country_mult() or is_needed_exchange_mult(); }
 
-/*! \brief          Does <i>_frequency_str</i> match a target value?
-    \param  target  target value of <i>_frequency_str</i>
-    \return         whether <i>_frequency</i> matches <i>target</i>
+/*! \brief          Does the frequency string match a target value?
+    \param  target  target value of the frequency string
+    \return         whether frequency_str() matches <i>target</i>
 */
   inline bool is_frequency_str(const std::string_view target) const
-    { return (_frequency_str == target); }
+    { return (frequency_str() == target); }
 
-/*! \brief      Set <i>_frequency string</i> to a particular number of decimal places (in kHz)
-    \param  n   number of decimal places
+/*! \brief      Approximate number of bytes used by this entry
+    \return     the size of the object plus the heap memory that it alone owns
+
+    Interned strings are shared, and are not included
 */
-  inline void frequency_str_decimal_places(const int n)
-    { _frequency_str = decimal_places(_frequency_str, n); }
+  size_t memory_usage(void) const;
 
 /// a simple definition of whether there is no useful information in the object
   inline bool empty(void) const
@@ -623,7 +889,7 @@ public:
 
 /// how many QSOs have we had (before this contest) with this callsign, band and mode?
   inline unsigned int n_qsos(void) const
-    { return olog.n_qsos(_callsign, _band, _mode); }
+    { return olog.n_qsos(callsign(), _band, _mode); }
 
 /// is this call+band+mode an all-time first?
   inline bool is_all_time_first(void) const
@@ -635,7 +901,7 @@ public:
 
 /// is this a needed call for which the call+band+mode is an all-time first, or have we received a qsl for this call+band+mode
   inline bool is_new_or_previously_qsled(void) const
-    { return (is_needed() and (is_all_time_first() or olog.confirmed(_callsign, _band, _mode))); }
+    { return (is_needed() and (is_all_time_first() or olog.confirmed(callsign(), _band, _mode))); }
 
 /*! \brief          Does this call match the  custom criteria?
     \return         whether the call matches the N7DR custom criteria
@@ -661,13 +927,18 @@ public:
     { unsigned int v { version };   // dummy; for now, version isn't used
       v = v + 0;
 
+      std::string callsign_copy         { callsign() };           // the strings are archived as before
+      std::string canonical_prefix_copy { canonical_prefix() };
+      std::string continent_copy        { continent() };
+      std::string frequency_str_copy    { frequency_str() };      // derived from _freq; archived only to keep the format unchanged
+
       ar & _band
-         & _callsign
-         & _canonical_prefix
-         & _continent
+         & callsign_copy
+         & canonical_prefix_copy
+         & continent_copy
          & _expiration_time
          & _freq
-         & _frequency_str
+         & frequency_str_copy
          & _is_needed
          & _is_needed_callsign_mult
          & _is_needed_country_mult
@@ -675,10 +946,16 @@ public:
          & _mode
          & _source
          & _time;
+
+      if constexpr (Archive::is_loading::value)
+      { _callsign = interned_string { callsign_copy };
+        _canonical_prefix = interned_string { canonical_prefix_copy };
+        _continent = interned_string { continent_copy };
+      }
     }
 
   inline std::string to_brief_string(void) const
-    { return (_callsign + ": "sv + to_string(_freq)); }
+    { return (callsign() + ": "s + to_string(_freq)); }
 };
 
 /*! \brief          Write a <i>bandmap_entry</i> object to an output stream
@@ -688,9 +965,305 @@ public:
 */
 std::ostream& operator<<(std::ostream& ost, const bandmap_entry& be);
 
-using BM_ENTRIES      = std::list<bandmap_entry>;
+using BM_ENTRIES      = std::vector<bandmap_entry>;
 using PREDICATE_FUN_P = bool (bandmap_entry::*)(void) const;
 
+// -----------  bandmap_entry_store  ----------------
+
+/*! \class  bandmap_entry_store
+    \brief  Storage for the entries in a bandmap
+
+    The entries are held in a contiguous container, in non-decreasing order of frequency, together
+    with an index from callsign to position. A callsign appears at most once in the store.
+    Lookup by callsign is O(1); lookup by frequency is O(log n).
+
+    Not thread safe; the owning bandmap is responsible for locking.
+*/
+
+class bandmap_entry_store
+{
+protected:
+
+  BM_ENTRIES                    _entries { };     ///< the entries, in non-decreasing order of frequency
+  UNORDERED_STRING_MAP<size_t>  _index   { };     ///< key = callsign; value = position in <i>_entries</i>
+
+/*! \brief      Rebuild the index for all positions from a particular position onwards
+    \param  n   first position to re-index
+*/
+  void _reindex(const size_t n = 0);
+
+public:
+
+  using iterator       = BM_ENTRIES::iterator;
+  using const_iterator = BM_ENTRIES::const_iterator;
+
+/// default constructor
+  bandmap_entry_store(void) = default;
+
+/// all the entries, in order of frequency
+  inline const BM_ENTRIES& entries(void) const
+    { return _entries; }
+
+/// number of entries
+  inline size_t size(void) const
+    { return _entries.size(); }
+
+/// is the store empty?
+  inline bool empty(void) const
+    { return _entries.empty(); }
+
+/// remove all the entries
+  inline void clear(void)
+  { _entries.clear();
+    _index.clear();
+  }
+
+  inline const_iterator begin(void) const
+    { return _entries.cbegin(); }
+
+  inline const_iterator end(void) const
+    { return _entries.cend(); }
+
+  inline const_iterator cbegin(void) const
+    { return _entries.cbegin(); }
+
+  inline const_iterator cend(void) const
+    { return _entries.cend(); }
+
+/// mutable iteration; the callsign and frequency of an entry MUST NOT be changed through these iterators
+  inline iterator begin(void)
+    { return _entries.begin(); }
+
+/// mutable iteration; the callsign and frequency of an entry MUST NOT be changed through these iterators
+  inline iterator end(void)
+    { return _entries.end(); }
+
+/*! \brief              Is a particular call present?
+    \param  callsign    call to test
+    \return             whether <i>callsign</i> is present
+*/
+  inline bool contains(const std::string_view callsign) const
+    { return _index.contains(callsign); }
+
+/*! \brief              Find the entry for a particular call
+    \param  callsign    call to find
+    \return             iterator to the entry for <i>callsign</i>; <i>end()</i> if <i>callsign</i> is not present
+*/
+  const_iterator find(const std::string_view callsign) const;
+
+/*! \brief              Find the entry for a particular call
+    \param  callsign    call to find
+    \return             iterator to the entry for <i>callsign</i>; <i>end()</i> if <i>callsign</i> is not present
+
+    The callsign and frequency of the entry MUST NOT be changed through the returned iterator
+*/
+  iterator find(const std::string_view callsign);
+
+/*! \brief      Find the first entry whose frequency is not less than a particular frequency
+    \param  f   target frequency
+    \return     iterator to the first entry whose frequency is >= <i>f</i>
+*/
+  const_iterator lower_bound(const frequency f) const;
+
+/*! \brief      Find the first entry whose frequency is greater than a particular frequency
+    \param  f   target frequency
+    \return     iterator to the first entry whose frequency is > <i>f</i>
+*/
+  const_iterator upper_bound(const frequency f) const;
+
+/*! \brief      Insert an entry
+    \param  be  entry to insert
+
+    Any existing entry with the same callsign as <i>be</i> is replaced; if the existing entry has the same
+    frequency as <i>be</i>, the replacement is performed in place. Otherwise, <i>be</i> is placed after any
+    existing entries with the same frequency.
+*/
+  void insert(const bandmap_entry& be);
+
+/*! \brief              Remove the entry for a particular call
+    \param  callsign    call to remove
+    \return             whether an entry was removed
+*/
+  bool erase(const std::string_view callsign);
+
+/*! \brief          Remove all the entries that match a predicate
+    \param  pred    predicate to apply
+    \return         number of entries removed
+
+    Single pass; the relative order of the remaining entries is preserved
+*/
+  template <typename P>
+  size_t erase_if(P pred)
+  { size_t n_kept { 0 };
+
+    for (size_t n { 0 }; n < _entries.size(); ++n)
+    { if (pred(std::as_const(_entries[n])))
+        _index.erase(_entries[n].callsign());
+      else
+      { if (n_kept != n)
+        { _entries[n_kept] = std::move(_entries[n]);
+          _index[_entries[n_kept].callsign()] = n_kept;
+        }
+
+        n_kept++;
+      }
+    }
+
+    const size_t rv { _entries.size() - n_kept };
+
+    _entries.erase(_entries.begin() + n_kept, _entries.end());
+
+    return rv;
+  }
+
+/*! \brief          Merge a batch of new entries into the store in a single pass
+    \param  sorted  new entries, in non-decreasing order of frequency, with distinct callsigns
+    \param  remove  predicate that identifies existing entries to be removed
+
+    <i>remove</i> MUST identify every existing entry whose callsign is also in <i>sorted</i>.
+    New entries are placed after any remaining existing entries with the same frequency.
+*/
+  template <typename P>
+  void merge(BM_ENTRIES&& sorted, P remove)
+  { BM_ENTRIES merged;
+
+    merged.reserve(_entries.size() + sorted.size());
+
+    auto it_new { sorted.begin() };
+
+    for (bandmap_entry& be : _entries)
+    { if (remove(std::as_const(be)))
+        continue;
+
+      while ( (it_new != sorted.end()) and (it_new -> freq() < be.freq()) )
+        merged += std::move(*it_new++);
+
+      merged += std::move(be);
+    }
+
+    while (it_new != sorted.end())
+      merged += std::move(*it_new++);
+
+    _entries = std::move(merged);
+    _index.clear();
+    _reindex();
+  }
+
+/// serialise
+  template<typename Archive>
+  void serialize(Archive& ar, [[ maybe_unused ]] const unsigned int version)
+  { ar & _entries;
+
+    if constexpr (Archive::is_loading::value)
+    { _index.clear();
+      _reindex();
+    }
+  }
+};
+
+// -----------  expiry_wheel  ----------------
+
+/*! \class  expiry_wheel
+    \brief  A hashed timing wheel of callsigns, keyed by the time at which they expire
+
+    There is one slot per second; a callsign whose expiration lies more than one revolution in the
+    future simply stays in its slot until the wheel comes round to it again. Each call to expire()
+    examines only the slots for the seconds since the previous call.
+*/
+
+class expiry_wheel
+{
+protected:
+
+/// a callsign scheduled to expire
+  struct item
+  { std::string callsign;       ///< the callsign
+    time_t      fire_time;      ///< time (in seconds since the epoch) at which the callsign is to be returned by expire()
+  };
+
+  time_t                         _last_processed { 0 };     ///< last time (in seconds since the epoch) that has been processed; 0 => none
+  std::vector<std::vector<item>> _slots          { };       ///< the slots; index = fire_time % number of slots
+
+public:
+
+/// number of slots
+  inline size_t n_slots(void) const
+    { return _slots.size(); }
+
+/*! \brief      Set the number of slots
+    \param  n   number of slots (i.e., seconds in one revolution)
+
+    Any items already in the wheel are rescheduled
+*/
+  void n_slots(const size_t n);
+
+/*! \brief                      Schedule a callsign to expire
+    \param  callsign            callsign to schedule
+    \param  expiration_time     time (in seconds since the epoch) after which <i>callsign</i> expires
+
+    A callsign may be scheduled more than once; the caller is responsible for checking whether the
+    callsign has really expired when it is returned by expire()
+*/
+  void add(const std::string_view callsign, const time_t expiration_time);
+
+/*! \brief          Remove and return all the callsigns that have expired
+    \param  now     current time (in seconds since the epoch)
+    \return         the callsigns whose expiration time is earlier than <i>now</i>
+*/
+  std::vector<std::string> expire(const time_t now = NOW());
+
+/// remove all the items
+  void clear(void);
+};
+
+// -----------  callsign_matcher  ----------------
+
+/*! \class  callsign_matcher
+    \brief  Matches a call against a set of exact calls and regexes
+
+    The exact calls are held in a hash set. The regexes are compiled into a single DFA, so that a call is
+    tested against all of them in one linear pass, regardless of the number of regexes. Any regex that uses
+    features that the DFA cannot represent (back-references, assertions, etc.) is retained as a std::regex
+    and tested separately.
+*/
+
+class callsign_matcher
+{
+protected:
+
+  UNORDERED_STRING_SET     _calls          { };     ///< the exact calls
+  std::array<uint8_t, 256> _class_of       { };     ///< the character class of each byte
+  size_t                   _n_classes      { 1 };   ///< number of distinct character classes
+  std::vector<int>         _transitions    { };     ///< the DFA; index = (state * _n_classes) + class; value = next state, or -1 for no match
+  std::vector<bool>        _accepting      { };     ///< whether each DFA state is accepting; state 0 is the start state
+  std::vector<std::regex>  _fallback_regex { };     ///< regexes that could not be compiled into the DFA
+
+public:
+
+/// default constructor; matches nothing
+  callsign_matcher(void) = default;
+
+/*! \brief              Constructor
+    \param  calls       exact calls to match
+    \param  regexes     regexes to match; key = regex string, value = corresponding regex
+*/
+  callsign_matcher(const UNORDERED_STRING_SET& calls, const STRING_MAP<std::regex>& regexes);
+
+/*! \brief              Does a call match any of the exact calls or regexes?
+    \param  callsign    call to test
+    \return             whether <i>callsign</i> matches any of the calls or regexes
+*/
+  bool matches(const std::string_view callsign) const;
+
+/// number of states in the DFA
+  inline size_t n_states(void) const
+    { return _accepting.size(); }
+
+/// number of regexes that are tested individually
+  inline size_t n_fallback_regexes(void) const
+    { return _fallback_regex.size(); }
+};
+
 class bandmap;
 
 // allow other files to access some functions in a useful, simple  manner; has to appear after bandmap has been declared
@@ -711,23 +1284,175 @@ protected:
   mutable pt_mutex                  _bandmap_mutex          { "DEFAULT BANDMAP"s };       ///< mutex for this bandmap
   
   int16_t                           _column_offset          { 0 };                        ///< number of columns to offset start of displayed entries; used if there are two many entries to display them all
-  int                               _cull_function          { 0 };                        ///< cull function number to apply
+  int                               _cull_function          { 0 };                        ///< cull function number to apply; set only with cull_function()
   UNORDERED_STRING_SET              _do_not_add             { };                          ///< do not add these calls
   STRING_MAP<std::regex>            _do_not_add_regex       { };                          ///< regex string, actual regex
-  BM_ENTRIES                        _entries                { };                          ///< all the entries
+  callsign_matcher                  _do_not_add_matcher     { };                          ///< compiled matcher for <i>_do_not_add</i> and <i>_do_not_add_regex</i>
+  expiry_wheel                      _expiry_wheel           { };                          ///< calls, keyed by the time at which they expire
+  UNORDERED_STRING_MAP<UNORDERED_STRING_SET> _dependent_calls { };                       ///< reverse mult index; key = mult key (see _mult_keys()), value = calls whose status may depend on the key
+  UNORDERED_STRING_MAP<UNORDERED_STRING_SET> _mult_keys_of_call { };                    ///< forward mult index; key = call, value = keys under which the call is in <i>_dependent_calls</i>
+  bandmap_entry_store               _entries                { };                          ///< all the entries
   std::vector<COLOUR_TYPE>          _fade_colours;                                        ///< the colours to use as entries age
-  decltype(_entries)                _filtered_entries       { };                          ///< entries, with the filter applied
+  bandmap_entry_store               _filtered_entries       { };                          ///< entries, with the filter applied; maintained incrementally
   bandmap_filter_type*              _filter_p               { &BMF };                     ///< pointer to a bandmap filter
   std::vector<bandmap_filter_type>*              _filters_p               { &BMF_vec };                     ///< pointer to a bandmap filter
   frequency                         _mode_marker_frequency  { frequency(0) };             ///< the frequency of the mode marker
   uint8_t                           _rbn_threshold          { 1 };                        ///< number of posters needed before a station appears in the bandmap
-  decltype(_entries)                _rbn_threshold_and_filtered_entries { };              ///< entries, with the filter and RBN threshold applied
-  decltype(_entries)                _rbn_threshold_filtered_and_culled_entries { };       ///< entries, with the RBN threshold, filter and cull function applied
+  bandmap_entry_store               _rbn_threshold_filtered_and_culled_entries { };       ///< entries, with the RBN threshold, filter and cull function applied; maintained incrementally
   UNORDERED_STRING_SET              _recent_calls           { };                          ///< calls recently added
+  time_t                            _recent_calls_minute    { 0 };                        ///< minute (since the epoch) in which <i>_recent_calls</i> was last cleared
   COLOUR_TYPE                       _recent_colour          { COLOUR_BLACK };             ///< colour to use for entries < 120 seconds old (if black, then not used)
 
-  int                               _last_displayed_version { -1 };
+/// the contents of one cell (i.e., one entry) of the bandmap window
+  struct drawn_cell
+  { std::string      text             { };         ///< frequency, space, callsign, padded to COLUMN_WIDTH; empty => blank cell
+    PAIR_NUMBER_TYPE frequency_colour { 0 };       ///< colour pair of the frequency
+    PAIR_NUMBER_TYPE status_colour    { 0 };       ///< colour pair of the status marker
+    PAIR_NUMBER_TYPE callsign_colour  { 0 };       ///< colour pair of the callsign
+    bool             reverse          { false };   ///< whether the frequency is displayed in reverse video
+
+    bool operator==(const drawn_cell&) const = default;
+  };
+
+/// predicates used for navigation, for which a snapshot holds an index of the matching entries
+  static constexpr std::array<PREDICATE_FUN_P, 5> INDEXED_PREDICATES { &bandmap_entry::is_needed,
+                                                                       &bandmap_entry::is_needed_mult,
+                                                                       &bandmap_entry::matches_criteria,
+                                                                       &bandmap_entry::is_all_time_first_and_needed_qso,
+                                                                       &bandmap_entry::is_new_or_previously_qsled
+                                                                     };
+
+/// an immutable copy of the displayed entries, rebuilt when it is first needed after a change and read without locking
+  struct displayed_snapshot
+  { BM_ENTRIES entries             { };      ///< the displayed entries, in order of frequency
+    uint32_t   filter_generation   { 0 };    ///< generation of the filter when the snapshot was taken
+    frequency  my_marker_frequency { };      ///< frequency of MY_MARKER in <i>entries</i>, as stored (i.e., including the bias); zero if absent
+
+    mutable std::once_flag                                                   index_flag  { };   ///< controls the construction of <i>predicate_positions</i> and <i>non_markers</i>
+    mutable std::array<std::vector<uint32_t>, INDEXED_PREDICATES.size()>    predicate_positions { };  ///< for each indexed predicate, ascending positions of the non-marker entries that satisfy it
+    mutable std::vector<uint32_t>                                            non_markers { };   ///< ascending positions of the non-marker entries
+
+/*! \brief      Build the indices, if they have not already been built
+
+    The indices are built from per-entry predicate bits the first time that they are needed, which is safe even if several threads need them at once
+*/
+    void build_index(void) const;
+
+/*! \brief          Positions of the non-marker entries that satisfy a predicate
+    \param  fp      predicate
+    \param  buffer  storage for the result if <i>fp</i> is not indexed
+    \return         ascending positions in <i>entries</i> of the non-marker entries for which <i>fp</i> is true
+*/
+    const std::vector<uint32_t>& positions(PREDICATE_FUN_P fp, std::vector<uint32_t>& buffer) const;
+  };
+
+  std::atomic<std::shared_ptr<const displayed_snapshot>> _snapshot { };                  ///< the current snapshot of the displayed entries
+  std::atomic<bool>                                       _snapshot_is_stale { true };   ///< whether the bandmap has changed since <i>_snapshot</i> was published
+
+  std::vector<drawn_cell>           _drawn_cells            { };                          ///< cells as last written to <i>_drawn_window</i>, in display order
+  bool                              _drawn_frequency_up     { false };                    ///< value of bandmap_frequency_up when <i>_drawn_cells</i> was written
+  WIN_INT_TYPE                      _drawn_height           { 0 };                        ///< height of <i>_drawn_window</i> when <i>_drawn_cells</i> was written
+  const window*                     _drawn_window           { nullptr };                  ///< window to which <i>_drawn_cells</i> was written
+  WIN_INT_TYPE                      _drawn_width            { 0 };                        ///< width of <i>_drawn_window</i> when <i>_drawn_cells</i> was written
+  int                               _last_displayed_version { -1 };                       ///< value of _version when last written to a window
+  bool                              _version_deferred       { false };                    ///< whether increments of _version are deferred until the end of a merge
   std::atomic<int>                  _version                { 0 };                        ///< used for debugging; strictly monotonically increases with each change
+  int                               _views_version          { -1 };                       ///< value of _version to which the filtered and culled views correspond; -1 => views must be rebuilt
+  uint32_t                          _views_filter_generation { 0 };                       ///< generation of the filter when the views were last rebuilt
+
+/*!  \brief     Does a bandmap_entry pass the filter?
+     \param be  entry to test
+     \return    whether <i>be</i> should appear in the filtered entries
+*/
+  bool _passes_filter(const bandmap_entry& be) const;
+
+/*!  \brief     Does a bandmap_entry pass the cull function?
+     \param be  entry to test
+     \return    whether <i>be</i> should appear in the culled entries, given that it has passed the filter
+*/
+  bool _passes_cull(const bandmap_entry& be) const;
+
+/// rebuild the filtered and culled views from <i>_entries</i>
+  void _rebuild_views(void);
+
+/// rebuild the filtered and culled views if they are out of date with respect to the filter or the cull function
+  inline void _refresh_views(void)
+  { if ( (_views_version == -1) or (_views_filter_generation != _filter_p -> generation()) )
+      _rebuild_views();
+  }
+
+/*!  \brief     Bring the filtered and culled views up to date for a single entry
+     \param be  the entry as it now appears in <i>_entries</i>
+*/
+  void _update_views(const bandmap_entry& be);
+
+/*!  \brief             Remove a call from the bandmap and from the views
+     \param callsign    call to remove
+     \return            whether <i>callsign</i> was present
+*/
+  bool _erase(const std::string_view callsign);
+
+/*!  \brief         Remove all entries that match a predicate from the bandmap and from the views
+     \param pred    predicate to apply
+     \return        number of entries removed from the bandmap
+*/
+  template <typename P>
+  size_t _erase_if(P pred)
+  { std::vector<std::string> erased_calls;
+
+    const size_t rv { _entries.erase_if( [&pred, &erased_calls] (const bandmap_entry& be) { const bool erase_it { pred(be) };
+
+                                                                                              if (erase_it)
+                                                                                                erased_calls += be.callsign();
+
+                                                                                              return erase_it;
+                                                                                            } ) };
+
+    if (rv)
+    { _filtered_entries.erase_if(pred);
+      _rbn_threshold_filtered_and_culled_entries.erase_if(pred);
+
+      FOR_ALL(erased_calls, [this] (const std::string& callsign) { _unindex_mult_keys(callsign); });
+    }
+
+    return rv;
+  }
+
+/// increment the version; views that are up to date are stamped with the new version
+  inline void _increment_version(void)
+  { if (_version_deferred)
+      return;
+
+    _version++;
+
+    if (_views_version != -1)
+      _views_version = _version;
+
+    _snapshot_is_stale = true;                  // the snapshot is rebuilt when it is next needed, rather than after every change
+  }
+
+/*!  \brief     Publish a new snapshot of the displayed entries
+
+     <i>_bandmap_mutex</i> must be held by the caller
+*/
+  void _publish_snapshot(void);
+
+/*!  \brief     The current snapshot of the displayed entries
+     \return    the most recently published snapshot
+
+     Does not lock <i>_bandmap_mutex</i> unless the snapshot is missing or stale, or the (shared) filter has changed since it was published
+*/
+  std::shared_ptr<const displayed_snapshot> _current_snapshot(void);
+
+/*!  \brief     The displayed entries
+     \return    the entries after the RBN threshold, filtering and culling have been applied
+
+     <i>_bandmap_mutex</i> must be held by the caller for as long as the returned reference is used
+*/
+  inline const BM_ENTRIES& _displayed_entries(void)
+  { _refresh_views();
+    return _rbn_threshold_filtered_and_culled_entries.entries();
+  }
 
 /*!  \brief     Insert a bandmap_entry
      \param be  entry to add
@@ -737,6 +1462,50 @@ protected:
 */
   void _insert(const bandmap_entry& be);
 
+/*!  \brief     All the mult keys on which the need/mult status of a bandmap_entry depends
+     \param be  entry
+     \return    keys for the country, the callsign mult values and the exchange mult values of <i>be</i>
+*/
+  std::vector<std::string> _mult_keys(const bandmap_entry& be) const;
+
+/*!  \brief     Add a bandmap_entry to the reverse mult index
+     \param be  entry to add
+
+     The keys for a call are calculated only once while it remains in the bandmap; thereafter only newly-needed exchange mult values are added
+*/
+  void _index_mult_keys(const bandmap_entry& be);
+
+/*!  \brief             Remove a call from the reverse mult index
+     \param callsign    call to remove
+
+     Does nothing if <i>callsign</i> is not in the index
+*/
+  void _unindex_mult_keys(const std::string_view callsign);
+
+/*!  \brief     All the calls in the bandmap whose status may depend on a mult key
+     \param key mult key
+     \return    the calls that are present in the bandmap and whose status may depend on <i>key</i>
+
+     Calls that are no longer present are removed from the index
+*/
+  UNORDERED_STRING_SET _dependent_calls_of(const std::string_view key);
+
+/*!  \brief     Schedule the expiry of a bandmap_entry
+     \param be  entry whose expiry is to be scheduled
+
+     Markers never expire, so are not scheduled
+*/
+  void _schedule_expiry(const bandmap_entry& be);
+
+/*!  \brief             Add a call or regex to the do-not-add list, without rebuilding the matcher
+     \param callsign    callsign or regex to add
+*/
+  void _add_to_do_not_add(const std::string_view callsign);
+
+/// rebuild the matcher for the do-not-add calls and regexes; must be called whenever either changes
+  inline void _rebuild_do_not_add_matcher(void)
+    { _do_not_add_matcher = callsign_matcher(_do_not_add, _do_not_add_regex); }
+
 /*!  \brief             Return whether a call is actually a regex
      \param callsign    call to test
      \return            whether <i>callsign</i> is actually a regex
@@ -744,6 +1513,31 @@ protected:
   inline bool _is_regex(const std::string_view callsign) const
     { return (callsign.find_first_not_of(CALLSIGN_CHARS) != std::string::npos); }
 
+/*!  \brief         Add a batch of bandmap_entry objects
+     \param batch   entries to add, in order of arrival
+
+     The result is the same as adding the elements of <i>batch</i> one at a time with +=, except that if
+     more than one element refers to the same call between markers or local entries, the last one wins (unless
+     the call is marked as recent, in which case subsequent elements are ignored, as they would be by +=).
+     Markers and local entries are added with += in their place in the batch; each run of other entries between
+     them is merged in a single pass. The version is incremented once.
+*/
+  void _merge(std::vector<bandmap_entry>&& batch);
+
+/*!  \brief         Add a run of bandmap_entry objects in a single pass
+     \param run     entries to add, in order of arrival; none is a marker or a local entry
+
+     If more than one element refers to the same call, the last one wins (unless the call is marked as recent,
+     in which case subsequent elements are ignored, as they would be by +=). Does not change the version.
+*/
+  void _merge_run(std::vector<bandmap_entry>&& run);
+
+/*!  \brief     Is it permissible to add a bandmap_entry?
+     \param be  entry to test
+     \return    whether <i>be</i> passes all the do-not-add, band, recent-call and mode-marker tests
+*/
+  bool _permitted(const bandmap_entry& be);
+
 /*!  \brief     Mark a bandmap_entry as recent
      \param be  entry to mark
 
@@ -812,7 +1606,12 @@ public:
   SAFE_READ_AND_WRITE_WITH_INTERNAL_MUTEX(band, _bandmap);    // don't really need the mutex, since it never changes after being set
 
 /// cull function number for the bandmap
-  SAFE_READ_AND_WRITE_WITH_INTERNAL_MUTEX(cull_function, _bandmap);
+  SAFE_READ_WITH_INTERNAL_MUTEX(cull_function, _bandmap);
+
+/*!  \brief     Set the cull function
+     \param n   number of the cull function to apply
+*/
+  void cull_function(const int n);
 
 /// all the do-not-add calls
   SAFEREAD_WITH_INTERNAL_MUTEX(do_not_add, _bandmap);
@@ -821,7 +1620,10 @@ public:
   SAFEREAD_WITH_INTERNAL_MUTEX(do_not_add_regex, _bandmap);
 
 /// all the entries in the bandmap
-  SAFEREAD_WITH_INTERNAL_MUTEX(entries, _bandmap);
+  inline BM_ENTRIES entries(void)
+  { SAFELOCK(_bandmap);
+    return _entries.entries();
+  }
     
 /// the colours used as entries age
   SAFE_READ_AND_WRITE_WITH_INTERNAL_MUTEX(fade_colours, _bandmap);
@@ -904,8 +1706,38 @@ public:
 */
   void not_needed_exchange_mult(const std::string_view mult_name, const std::string_view mult_value);
 
-/// prune the bandmap
-  void prune(void);
+/*! \brief              Re-mark the need/mult status of the entries that might be affected by some QSOs
+    \param  qsos        QSOs that have been added to, or removed from, the log
+    \param  rules       rules for the contest
+    \param  q_history   history of all the QSOs
+    \param  statistics  statistics for the contest so far
+    \return             whether the status of any entry changed
+
+    Only the entries for the calls in <i>qsos</i>, and those that share a country, callsign mult value or
+    exchange mult value with any of the QSOs, are re-marked. <i>statistics</i> and <i>q_history</i> must
+    be up to date before this is called.
+*/
+  bool remark(const std::vector<QSO>& qsos, contest_rules& rules, const call_history& q_history, running_statistics& statistics);
+
+/*! \brief              Re-mark the need/mult status of the entries that might be affected by a QSO
+    \param  qso         QSO that has been added to, or removed from, the log
+    \param  rules       rules for the contest
+    \param  q_history   history of all the QSOs
+    \param  statistics  statistics for the contest so far
+    \return             whether the status of any entry changed
+*/
+  inline bool remark(const QSO& qso, contest_rules& rules, const call_history& q_history, running_statistics& statistics)
+    { return remark(std::vector<QSO> { qso }, rules, q_history, statistics); }
+
+/*! \brief      Prune the bandmap, removing any entries that have expired
+    \return     whether any entries were removed
+
+    Uses <i>_expiry_wheel</i>, so the cost is proportional to the number of expired entries, not to the
+    number of entries in the bandmap. Intended to be called once per second. The recent calls are
+    cleared, and the version incremented so that the colours fade, the first time that this is called
+    in each minute.
+*/
+  bool prune(void);
 
 // filter functions -- these affect all bandmaps, as there's just one (global) filter
 
@@ -990,17 +1822,21 @@ public:
      empty string if no station was found within the guard band.
 */
   inline std::string nearest_rbn_threshold_and_filtered_callsign(const frequency target_frequency, const frequency guard_band)
-    { return _nearest_callsign(rbn_threshold_and_filtered_entries(), target_frequency, guard_band); }
+  { SAFELOCK(_bandmap);
+    _refresh_views();
+    return _nearest_callsign(_filtered_entries.entries(), target_frequency, guard_band);
+  }
 
 /*!  \brief                   Find the station in the displayed bandmap that is closest to a target frequency
      \param target_frequency  target frequency
      \param guard_band        guard band
      \return                  call of closest bandmap entry (if any) to the target frequency and within the guard band
 
-     Returns the empty string if no station was found within the guard band.
+     Returns the empty string if no station was found within the guard band. Reads the current snapshot,
+     so does not wait for any thread that is changing the bandmap.
 */
   inline std::string nearest_displayed_callsign(const frequency target_frequency, const frequency guard_band)
-    { return _nearest_callsign(displayed_entries(), target_frequency, guard_band); }
+    { return _nearest_callsign(_current_snapshot() -> entries, target_frequency, guard_band); }    // no lock needed
 
 /*!  \brief         Find the next needed station up or down in frequency from the current location
      \param fp      pointer to function to be used to determine whether a station is needed
@@ -1116,7 +1952,11 @@ public:
   template<typename C>
     requires (is_ssv<typename C::value_type>)
   inline void do_not_add(const C& calls)
-    { FOR_ALL(calls, [this] (const std::string_view s) { do_not_add(s); }); }
+  { SAFELOCK(_bandmap);
+
+    FOR_ALL(calls, [this] (const std::string_view s) { _add_to_do_not_add(s); });
+    _rebuild_do_not_add_matcher();                                                  // once, for the whole container
+  }
 
 /*!  \brief         Add all the calls in a container to the do-not-add list
      \param calls   container of calls to add
@@ -1126,7 +1966,11 @@ public:
   template<typename C>
     requires (is_ssv<typename C::value_type>)
   inline void do_not_add(C&& calls)
-    { FOR_ALL(std::forward<C>(calls), [this] (const std::string_view s) { do_not_add(s); }); }
+  { SAFELOCK(_bandmap);
+
+    FOR_ALL(std::forward<C>(calls), [this] (const std::string_view s) { _add_to_do_not_add(s); });
+    _rebuild_do_not_add_matcher();                                                  // once, for the whole container
+  }
 
 /*!  \brief             Remove a call from the do-not-add list
      \param callsign    callsign or regex to remove
@@ -1141,6 +1985,13 @@ public:
 */
   bool is_present(const std::string_view target_callsign) const;
 
+/*! \brief      Average memory used by each entry
+    \return     the average number of bytes used by each entry in the bandmap, including its share of the call index
+
+    Interned strings are shared between all bandmaps, and are not included
+*/
+  size_t memory_per_entry(void);
+
 /// convert to a printable string
   std::string to_str(void);
 
@@ -1148,8 +1999,8 @@ public:
     \param biq     insertion queue to process
     \return        whether any processing actually took place (i.e., was <i>biq</i> non-empty?)
      
-    <i>biq</i> changes (is emptied) by this routine
-    other threads MUST NOT access biq while this is executing
+    <i>biq</i> changes (is emptied) by this routine; the entire queue is drained at once and merged
+    into the bandmap at once, with a single increment of the version
 */
   bool process_insertion_queue(BANDMAP_INSERTION_QUEUE& biq);
 
@@ -1165,6 +2016,9 @@ public:
 /*! \brief          Write a <i>bandmap</i> object to a window
     \param  win     window to which to write
     \return         the window
+
+    Only the cells that differ from those that this bandmap last wrote to <i>win</i> are rewritten.
+    The whole window is redrawn if it has been resized or if another bandmap has written to it since.
 */
   window& write_to_window(window& win);
 
@@ -1215,15 +2069,24 @@ public:
          & _do_not_add
          & _entries
          & _fade_colours
-         & _filtered_entries
 //         & _filtered_entries_dirty    // **** WHAT ABOUT filter_p ???
          & _mode_marker_frequency
          & _rbn_threshold
-         & _rbn_threshold_and_filtered_entries
-//         & _rbn_threshold_and_filtered_entries_dirty
-         & _rbn_threshold_filtered_and_culled_entries
          & _recent_calls
          & _recent_colour;
+
+      if constexpr (Archive::is_loading::value)
+      { _views_version = -1;            // the views are not archived; rebuild them when next needed
+        _rebuild_do_not_add_matcher();
+        _expiry_wheel.clear();
+        _dependent_calls.clear();
+        _mult_keys_of_call.clear();
+
+        FOR_ALL(_entries, [this] (const bandmap_entry& be) { _schedule_expiry(be);
+                                                             _index_mult_keys(be);
+                                                           });
+        _snapshot_is_stale = true;
+      }
     }
 };
 
@@ -274,6 +274,10 @@ public:
 */
   std::string display_string(void) const;
 
+/// frequency in units of 100 Hz, rounded in the same way as in display_string()
+  inline uint32_t display_hhz(void) const
+    { return ( ((_hz / 1000) * 10) + ((((_hz % 1000) / 10) + 5) / 10) ); }
+
 /*! \brief      Return frequency in MHz as string (with 3 dp)
     \return     string of the frequency in MHz, to three decimal placex ([xxxx].yyy)
 */
@@ -22,7 +22,15 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
+#include <vector>
 
 /// the source of a remote post
 enum class POSTING_SOURCE { CLUSTER,                  ///< traditional cluster
@@ -54,10 +62,24 @@ protected:
   bool           _test_spots { false };         ///< whether sent spots are sent in test (DXT) mode
   TIME_POINT     _time_last_data_received { };  ///< time point of last data received
   unsigned int   _timeout;                      ///< timeout in seconds (defaults to 2)
-  std::string    _unprocessed_input;            ///< buffer for messages from the network
+  line_buffer    _input;                        ///< buffer for messages from the network
+
+  std::mutex              _new_lines_mtx;                 ///< mutex for <i>_new_lines</i>
+  std::condition_variable _new_lines_cv;                  ///< signalled when complete lines arrive
+  bool                    _new_lines { false };           ///< whether complete lines have arrived since the last call to wait_for_new_lines()
+
+  std::atomic<bool>       _resetting  { false };          ///< whether the connection is being reset
+  std::atomic<uint64_t>   _generation { 0 };              ///< incremented each time that the connection is reset
+
+  dx_cluster*              _parent_p { nullptr };         ///< the cluster whose processing thread also processes the lines from this one, if any
+  std::vector<dx_cluster*> _feeds    { };                 ///< the clusters whose lines are processed together with the lines from this one
+  mutable std::mutex       _feeds_mtx;                    ///< mutex for <i>_feeds</i>
 
 /// process a read error
   void _process_error(void);
+
+/// wake the processing thread, which belongs to the parent if there is one
+  void _notify_new_lines(void);
     
 public:
 
@@ -66,6 +88,14 @@ public:
     \param  src         whether this is a real DX cluster or the RBN
 */
   dx_cluster(const drlog_context& context, const POSTING_SOURCE src);
+
+/*! \brief              Constructor for a server other than the one in the context
+    \param  context     the drlog context
+    \param  src         whether this is a real DX cluster or the RBN
+    \param  server      name or IP address of the server
+    \param  port        server port
+*/
+  dx_cluster(const drlog_context& context, const POSTING_SOURCE src, const std::string& server, const unsigned int port);
   
 /// destructor
   ~dx_cluster(void);
@@ -80,14 +110,50 @@ public:
   inline void increment_n_posts(void)
     { _n_posts++; }
 
-/*! \brief      Read from the cluster socket, and append any data to <i>_unprocessed_input</i>
+/*! \brief      Read, without waiting, whatever data are available on the cluster socket, and append them to <i>_input</i>
+    \return     whether the connection is still usable
+
+    Wakes any thread in wait_for_new_lines() if a complete line has arrived. Does not attempt to reset a failed connection.
+*/
+  bool read_available(void);
+
+/*! \brief              Wait until complete lines have been read from the socket
+    \param  max_wait    maximum time to wait
+    \return             whether complete lines have arrived since the previous call
+
+    Returns immediately if lines have arrived since the previous call
 */
-  void read(void);
+  bool wait_for_new_lines(const std::chrono::milliseconds max_wait);
   
-/*! \brief      Return the unprocessed input, and clear it within the object
-    \return     the information that has been read from the socket but has not yet been processed
+/*! \brief          Move the complete lines that have been read from the socket, and from any feeds, to a buffer
+    \param  dest    buffer to receive the lines; any existing contents are discarded
+
+    Any trailing partial lines remain within the objects
+*/
+  void move_complete_lines_to(line_buffer& dest);
+
+/*! \brief          Process the lines from another cluster together with the lines from this one
+    \param  feed    the other cluster
+
+    <i>feed</i> must outlive this object
 */
-  std::string get_unprocessed_input(void);
+  void add_feed(dx_cluster& feed);
+
+/// the underlying socket
+  inline int socket_fd(void) const
+    { return _connection.socket(); }
+
+/// put the underlying socket into non-blocking mode
+  inline void non_blocking(void)
+    { _connection.non_blocking(true); }
+
+/// whether the connection is being reset
+  inline bool resetting(void) const
+    { return _resetting; }
+
+/// number of times that the connection has been reset
+  inline uint64_t generation(void) const
+    { return _generation; }
   
 /*! \brief          Send a message to the cluster
     \param  msg     the message to be sent
@@ -109,7 +175,10 @@ public:
 */
   bool spot(const std::string_view msg);
 
-/// reset the cluster socket
+/*! \brief  Reset the cluster socket
+
+    Blocks until the connection has been re-established; does nothing if a reset is already in progress
+*/
   void reset_connection(void);
 
 /*! \brief      The status of the connection, as a human-readable string
@@ -139,6 +208,276 @@ inline std::ostream& operator<<(std::ostream& ost, const dx_cluster& dxc)
   return ost;
 }
 
+// -----------  cluster_reactor  ----------------
+
+/*! \class  cluster_reactor
+    \brief  Read all the cluster and RBN connections in a single thread
+
+    The sockets are non-blocking, and are multiplexed with epoll. A connection that fails (or that is silent for too long,
+    if a limit is given) is reset in a separate thread, and is re-registered automatically once the reset is complete.
+*/
+
+class cluster_reactor
+{
+protected:
+
+/// a cluster, and the state of its registration with the epoll
+  struct registration
+  { dx_cluster*                         cluster_p   { nullptr };   ///< the cluster
+    int                                 fd          { -1 };        ///< the registered socket; -1 => not registered
+    uint64_t                            generation  { 0 };         ///< the generation of the connection when it was registered
+    std::optional<std::chrono::seconds> max_silence { };           ///< time without data after which the connection is reset
+    bool                                awaiting_reset { false };  ///< whether a reset has been requested, but is not yet complete
+  };
+
+  epoller                  _epoll;                  ///< the epoll
+  std::deque<registration> _registrations { };      ///< all the clusters; a deque so that references remain valid as clusters are added
+  mutable std::mutex       _mtx;                    ///< mutex for <i>_registrations</i>
+
+  std::mutex                  _reset_mtx;                       ///< mutex for <i>_clusters_to_reset</i>
+  std::condition_variable_any _reset_cv;                        ///< signalled when a cluster is added to <i>_clusters_to_reset</i>
+  std::deque<dx_cluster*>     _clusters_to_reset    { };        ///< clusters whose connections are waiting to be reset
+
+  std::jthread _reset_worker;                       ///< thread that resets connections; declared last, so that it is stopped first
+
+/*! \brief      Register the current socket of a cluster with the epoll, if the cluster is not being reset
+    \param  n   index of the cluster in <i>_registrations</i>; used as the tag in the epoll
+*/
+  void _register(const size_t n);
+
+/// reset the connection of a cluster in the reset thread
+  void _reset(registration& reg);
+
+/*! \brief          Body of the reset thread
+    \param  st      token that indicates that the thread should exit
+
+    Resets the connections one at a time, in the order in which they were requested
+*/
+  void _reset_connections(std::stop_token st);
+
+public:
+
+/// constructor; starts the reset thread
+  cluster_reactor(void);
+
+/// destructor; waits for any reset in progress to complete
+  inline ~cluster_reactor(void)
+    { stop_resets(); }
+
+  cluster_reactor(const cluster_reactor&) = delete;       ///< forbid copying
+
+/*! \brief  Stop the reset thread
+
+    Waits for any reset in progress to complete; no further resets are performed. Should be called before
+    exit, so that no connection is reset after the clusters have begun to be destroyed.
+*/
+  void stop_resets(void);
+
+/*! \brief                  Add a cluster
+    \param  cluster         cluster to add; must outlive this object
+    \param  max_silence     time without data after which the connection is reset by this object
+
+    May be called from any thread
+*/
+  void add(dx_cluster& cluster, const std::optional<std::chrono::seconds> max_silence = std::nullopt);
+
+/*! \brief              Reset the connection of a cluster in the reset thread
+    \param  cluster     cluster whose connection is to be reset; does nothing if <i>cluster</i> has not been added
+
+    May be called from any thread
+*/
+  void reset(const dx_cluster& cluster);
+
+/*! \brief              Wait for, and then read, data from any of the clusters
+    \param  max_wait    maximum time to wait
+
+    Must be called repeatedly from just one thread
+*/
+  void poll(const std::chrono::milliseconds max_wait);
+
+/// number of clusters
+  inline size_t size(void) const
+    { std::lock_guard<std::mutex> lg(_mtx);
+      return _registrations.size();
+    }
+};
+
+// -----------  rbn_replay_server  ----------------
+
+/*! \class  rbn_replay_server
+    \brief  A stand-in for an RBN server on the loopback interface, which replays a file written to RBN FILE
+
+    A single connection is served. Each line is sent at the time given by its HHMMZ field, with the times compressed
+    by the speedup; the lines in the same minute are spread evenly across it. A speedup of zero sends the lines as fast
+    as possible. The processing thread reports back, so that the throughput and latency of the processing can be measured.
+*/
+
+class rbn_replay_server
+{
+protected:
+
+  std::vector<std::string>               _lines;                ///< the lines to be replayed
+  std::vector<std::chrono::microseconds> _schedule;             ///< when to send each line, relative to the start of the replay
+  double                                 _speedup;              ///< factor by which the replay is faster than real time
+  int                                    _listen_fd { -1 };     ///< socket on which to listen for the connection
+  unsigned int                           _port      { 0 };      ///< port on which to listen for the connection
+  std::jthread                           _thread;               ///< thread that serves the connection
+
+  mutable std::mutex                           _mtx;                          ///< mutex for the remaining members
+  UNORDERED_STRING_MAP<std::deque<TIME_POINT>> _unmatched_send_times { };     ///< times at which lines were sent but not yet received, keyed by content
+  std::vector<TIME_POINT>                      _pass_send_times      { };     ///< times at which the lines in the current pass were sent
+  std::vector<std::chrono::microseconds>       _latencies            { };     ///< time from sending each line to the end of the pass that processed it
+  size_t                                       _n_sent               { 0 };   ///< number of lines that have been sent
+  size_t                                       _n_matched            { 0 };   ///< number of sent lines that have been received by the processing thread
+  size_t                                       _n_passes             { 0 };   ///< number of processing passes
+  size_t                                       _max_lines_per_pass   { 0 };   ///< greatest number of replayed lines in a processing pass
+  size_t                                       _max_queue_depth      { 0 };   ///< greatest number of entries waiting in the bandmap insertion queues
+  TIME_POINT                                   _first_sent           { };     ///< time at which the first line was sent
+  TIME_POINT                                   _last_processed       { };     ///< time at which the processing of the last line was complete
+
+/// serve the connection
+  void _serve(std::stop_token st);
+
+public:
+
+/*! \brief              Constructor
+    \param  lines       the lines to be replayed
+    \param  speedup     factor by which the replay is to be faster than real time; 0 => as fast as possible
+
+    Starts listening on an ephemeral port on the loopback interface; throws a socket_support_error if this is not possible
+*/
+  rbn_replay_server(const std::vector<std::string>& lines, const double speedup);
+
+/// destructor
+  ~rbn_replay_server(void);
+
+  rbn_replay_server(const rbn_replay_server&) = delete;     ///< forbid copying
+
+  READ(port);                   ///< port on which to listen for the connection
+
+/// number of lines to be replayed
+  inline size_t n_lines(void) const
+    { return _lines.size(); }
+
+/// start serving the connection, in a separate thread
+  void start(void);
+
+/*! \brief          Record the lines that are about to be processed in a pass
+    \param  lines   the lines
+
+    Lines that were not sent by the server (or that have already been recorded) are ignored
+*/
+  void lines_received(const line_buffer& lines);
+
+/*! \brief                  Record the end of a pass
+    \param  queue_depth     number of entries in the bandmap insertion queues before they were processed
+    \return                 whether this pass completed the replay
+*/
+  bool pass_complete(const size_t queue_depth);
+
+/// human-readable report of the replay
+  std::string report(void) const;
+};
+
+// -----------  line_classifier  ----------------
+
+/// the class of a line received from a cluster or the RBN; later values take precedence
+enum class LINE_CLASS : uint8_t { NORMAL,             ///< an ordinary line
+                                  BEACON,             ///< a post of a beacon
+                                  BLOCKED             ///< a line that contains a blocked pattern
+                                };
+
+/*! \class  line_classifier
+    \brief  Classify lines by the patterns that they contain, in a single pass
+
+    The patterns are compiled into an Aho-Corasick automaton, stored as a complete transition table.
+    A line takes the class of the highest-precedence pattern that it contains.
+*/
+
+class line_classifier
+{
+protected:
+
+  static constexpr size_t ALPHABET_SIZE { 256 };      ///< number of possible values of a char
+
+  std::vector<uint32_t>   _transitions { std::vector<uint32_t>(ALPHABET_SIZE, 0) };   ///< next state; index = state * ALPHABET_SIZE + character; state 0 is the root
+  std::vector<LINE_CLASS> _outputs     { LINE_CLASS::NORMAL };                        ///< class of the highest-precedence pattern that ends at each state
+  LINE_CLASS              _max_class   { LINE_CLASS::NORMAL };                        ///< highest class of any pattern
+
+public:
+
+/// default constructor; every line is NORMAL
+  line_classifier(void) = default;
+
+/*! \brief              Constructor
+    \param  patterns    patterns and the class of line that contains each of them
+
+    Empty patterns are ignored
+*/
+  explicit line_classifier(const std::vector<std::pair<std::string, LINE_CLASS>>& patterns);
+
+/*! \brief          Classify a line
+    \param  line    line to classify
+    \return         the class of <i>line</i>
+*/
+  LINE_CLASS operator()(const std::string_view line) const;
+
+/// the number of states in the automaton
+  inline size_t n_states(void) const
+    { return _outputs.size(); }
+};
+
+// -----------  post_fields  ----------------
+
+/// the format of a line received from a cluster or the RBN
+enum class POST_FORMAT { NONE,                    ///< not a recognised post
+                         SH_DX,                   ///< sh/dx format: 18073.1  P49V  29-Dec-2009 1931Z  nice signal NW  <N7XR>
+                         DX_DE                    ///< ordinary or RBN format: DX de DK9IP-#:  7006.0  LA3MHA  CW  21 dB  24 WPM  CQ  2257Z
+                       };
+
+/*! \class  post_fields
+    \brief  The fields of a line from a cluster or the RBN, located in a single pass
+
+    The fields are views into the line, which must outlive the object; the fields are meaningful only if the line is a recognised post
+*/
+
+class post_fields
+{
+protected:
+
+  std::string_view _callsign      { };                    ///< callsign that was heard
+  std::string_view _comment       { };                    ///< comment supplied by poster
+  POST_FORMAT      _format        { POST_FORMAT::NONE };  ///< format of the line
+  frequency        _freq          { };                    ///< frequency at which <i>_callsign</i> was heard
+  std::string_view _frequency_str { };                    ///< frequency, as it appears in the line
+  std::string_view _line          { };                    ///< the entire line
+  std::string_view _mode_str      { };                    ///< mode string from RBN post (empty if none)
+  std::string_view _poster        { };                    ///< call of poster
+
+public:
+
+/*! \brief                  Constructor
+    \param  line            a line received from the cluster or RBN
+    \param  post_source     the origin of the line
+
+    Only HF posts are recognised
+*/
+  post_fields(const std::string_view line, const enum POSTING_SOURCE post_source);
+
+  READ(callsign);               ///< callsign that was heard
+  READ(comment);                ///< comment supplied by poster
+  READ(format);                 ///< format of the line
+  READ(freq);                   ///< frequency at which <i>_callsign</i> was heard
+  READ(frequency_str);          ///< frequency, as it appears in the line
+  READ(line);                   ///< the entire line
+  READ(mode_str);               ///< mode string from RBN post (empty if none)
+  READ(poster);                 ///< call of poster
+
+/// is the line a recognised post?
+  inline bool recognised(void) const
+    { return (_format != POST_FORMAT::NONE); }
+};
+
 // -----------  dx_post  ----------------
 
 /*! \class  dx_post
@@ -177,6 +516,15 @@ public:
 */
   dx_post(const std::string_view received_info, location_database& db, const enum POSTING_SOURCE post_source);
 
+/*! \brief                  Construct from the fields of a line
+    \param  fields          the fields of a line received from the cluster or RBN
+    \param  db              the location database for this contest
+    \param  post_source     the origin of the post
+
+    Owning strings are created only once the fields have passed the cheap validity checks
+*/
+  dx_post(const post_fields& fields, location_database& db, const enum POSTING_SOURCE post_source);
+
   READ(band);                   ///< band of post
   READ_AND_WRITE(callsign);     ///< callsign that was heard
   READ(canonical_prefix);       ///< canonical prefix corresponding to <i>callsign</i>
@@ -213,6 +561,130 @@ public:
 */
 std::ostream& operator<<(std::ostream& ost, const dx_post& dxp);
 
+// -----------  post_parser  ----------------
+
+/*! \class  post_parser
+    \brief  A small pool of threads that turns lines from a cluster or the RBN into posts
+
+    A batch of lines is shared among the workers and the calling thread. The posts are
+    returned in the same order as the lines, so that they may be committed in order of arrival.
+*/
+
+class post_parser
+{
+protected:
+
+  using CORRECTION_FUN = std::function<void (dx_post&)>;   ///< type of the function that statically corrects a post
+
+  static constexpr size_t MIN_PARALLEL_BATCH { 8 };       ///< smaller batches are parsed by the calling thread alone
+
+  location_database& _db;                                 ///< location database used to parse posts
+  POSTING_SOURCE     _source;                             ///< source of the lines
+  CORRECTION_FUN     _correct;                            ///< static correction applied to each post after parsing
+
+  std::mutex                  _mtx;                       ///< mutex for the batch information
+  std::condition_variable_any _work_cv;                   ///< signalled when a new batch is available
+  std::condition_variable     _done_cv;                   ///< signalled when a worker finishes a batch
+
+  const std::vector<std::string_view>*  _lines_p   { nullptr };   ///< lines in the current batch
+  std::vector<std::optional<dx_post>>*  _results_p { nullptr };   ///< posts from the current batch
+  std::atomic<size_t>                   _next      { 0 };         ///< index of the next line to be claimed
+  uint64_t                              _batch_nr  { 0 };         ///< number of the current batch
+  size_t                                _n_done    { 0 };         ///< number of workers that have finished the current batch
+
+  std::vector<std::jthread> _workers;                     ///< the worker threads; declared last, so that they are stopped first
+
+/*! \brief          Parse a single line
+    \param  line    line to parse
+    \return         the corresponding post; empty if the line could not be parsed
+*/
+  std::optional<dx_post> _parse(const std::string_view line) const;
+
+/// claim and parse lines from the current batch until none remain
+  void _parse_batch(void);
+
+/*! \brief          Body of a worker thread
+    \param  st      token that indicates that the worker should exit
+*/
+  void _worker(std::stop_token st);
+
+public:
+
+/*! \brief              Constructor
+    \param  db          location database used to parse posts
+    \param  src         source of the lines
+    \param  n_workers   number of worker threads, in addition to the calling thread
+    \param  correct     static correction to apply to each post, in the worker thread
+*/
+  post_parser(location_database& db, const POSTING_SOURCE src, const unsigned int n_workers, CORRECTION_FUN correct = { });
+
+  post_parser(const post_parser&) = delete;       ///< forbid copying
+
+/*! \brief          Parse a batch of lines
+    \param  lines   lines to parse; none may be empty
+    \return         the posts, in the same order as <i>lines</i>
+
+    An element of the returned vector is empty if the corresponding line could not be processed.
+    Must not be called simultaneously from more than one thread.
+*/
+  std::vector<std::optional<dx_post>> operator()(const std::vector<std::string_view>& lines);
+
+/// number of worker threads
+  inline size_t n_workers(void) const
+    { return _workers.size(); }
+};
+
+// -----------  post_coalescer  ----------------
+
+/// a post, together with the posters of all the posts that have been merged into it
+struct coalesced_post
+{ dx_post                  post;        ///< the most recent of the merged posts
+  std::vector<std::string> posters;     ///< the posters of the merged posts, without duplicates, in order of arrival
+};
+
+/*! \class  post_coalescer
+    \brief  Merge posts of the same call on the same band and (nearly) the same frequency
+
+    Many RBN skimmers report the same station within a few seconds; merging the reports means that only
+    one bandmap entry need be generated for all of them. Not thread safe.
+*/
+
+class post_coalescer
+{
+protected:
+
+  frequency                                               _max_skew;        ///< maximum difference in frequency for posts to be merged
+  std::vector<coalesced_post>                             _posts    { };    ///< the merged posts, in order of arrival of the first post of each
+  std::map<std::pair<BAND, std::string /* call */>, size_t> _latest   { };    ///< index into <i>_posts</i> of the most recent merged post for each band and call
+  size_t                                                  _n_posts  { 0 };  ///< number of posts that have been added
+
+public:
+
+/*! \brief              Constructor
+    \param  max_skew    maximum difference in frequency for posts to be merged
+*/
+  inline explicit post_coalescer(const frequency max_skew) :
+    _max_skew(max_skew)
+  { }
+
+/*! \brief          Add a post
+    \param  post    post to add
+
+    <i>post</i> is merged with the most recent post of the same call on the same band if their frequencies are within <i>_max_skew</i>
+*/
+  void operator+=(const dx_post& post);
+
+  READ(posts);                  ///< the merged posts, in order of arrival of the first post of each
+  READ(n_posts);                ///< number of posts that have been added
+
+/// number of posts that have been absorbed by merging
+  inline size_t n_merged(void) const
+    { return (_n_posts - _posts.size()); }
+
+/// remove all the posts
+  void clear(void);
+};
+
 // -----------  monitored_posts_entry  ----------------
 
 /*! \class  monitored_posts_entry
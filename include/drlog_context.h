@@ -97,6 +97,7 @@ protected:
   unsigned int                                 _bandscope_span_sap                      { 0 };                          ///< bandscope span in SAP mode, in kHz (0 = no default span)
   std::string                                  _batch_messages_file                     { };                            ///< file that contains per-call batch messages
   std::string                                  _best_dx_unit                            { "MILES"s };                   ///< name of unit for the BEST DX window ("MILES" or "KM")
+  std::vector<std::string>                     _blocked_post_patterns                   { };                            ///< strings that cause a line from the cluster or RBN to be blocked if they appear anywhere in it; inner spaces are kept, and a string in quotation marks also keeps its leading and trailing spaces
   FLAT_STRING_SET                              _blocked_posts                           { };                            ///< canonical prefixes from cluster or RBN that will be blocked
   std::string                                  _cabrillo_eol                            { "LF"s };                      ///< EOL used in the cabrillo file; one of: "LF", "CR" or "CRLF"
   std::string                                  _cabrillo_filename                       { "cabrillo"s };                ///< name of Cabrillo log
@@ -176,9 +177,11 @@ protected:
   std::string                                  _exchange_sap                            { };                            ///< exchange in SAP mode
 //  std::string                                  _execute_at_start                        { };                            ///< string to execute as soon as config file is read
   std::vector<std::string>                     _execute_at_start                        { };                            ///< commands to execute as soon as config file is read
+  std::vector<std::pair<std::string, unsigned int>> _extra_rbn_servers                 { };                            ///< additional RBN-style servers, and their ports (0 => same as RBN PORT)
 
   unsigned int                                 _fast_cq_bandwidth                       { 400 };                        ///< fast CW bandwidth in CQ mode, in Hz
   unsigned int                                 _fast_sap_bandwidth                      { 400 };                        ///< fast CW bandwidth in SAP mode, in Hz
+  bool                                         _fuzzy_insertions_and_deletions          { false };                      ///< whether fuzzy matches include calls with one more or one fewer character
 
   std::string                                  _geomagnetic_indices_command             { };                                            ///< command to get geomagnetic indices
   std::map<MODE, frequency>                    _guard_band                              { { MODE_CW, 500_Hz }, { MODE_SSB, 2_kHz } };   ///< guard band
@@ -253,6 +256,7 @@ protected:
 
   std::vector<unsigned int>                    _rate_periods                            { 15, 30, 60 } ;                ///< periods (in minutes) over which rates should be calculated
   bool                                         _rbn_beacons                             { false };                      ///< whether to place RBN posts identified as from beacons on the bandmap
+  std::chrono::milliseconds                    _rbn_coalesce_window                     { 200 };                        ///< how long to accumulate new RBN or cluster posts before processing them
   std::string                                  _rbn_file                                { };                            ///< name of file to which RBN lines should be copied
   unsigned int                                 _rbn_port                                { 7000 };                       ///< port number on the RBN server
   std::string                                  _rbn_server                              { "telnet.reversebeacon.net"s };///< hostname or IP address of RBN server
@@ -426,6 +430,7 @@ public:
   CONTEXTREAD(bandscope_span_sap);               ///< bandscope span in SAP mode, in kHz
   CONTEXTREAD(batch_messages_file);              ///< file that contains per-call batch messages
   CONTEXTREAD(best_dx_unit);                     ///< name of unit for the BEST DX window ("MILES" or "KM")
+  CONTEXTREAD(blocked_post_patterns);            ///< strings that cause a line from the cluster or RBN to be blocked if they appear anywhere in it
   CONTEXTREAD(blocked_posts);                    ///< canonical prefixes from cluster or RBN that will be blocked
 
   CONTEXTREAD(cabrillo_address_1);               ///< first ADDRESS: line
@@ -503,9 +508,11 @@ public:
   CONTEXTREAD(exchange_prefill_files);           ///< external prefill files for exchange fields
   CONTEXTREAD(exchange_sap);                     ///< exchange in SAP mode
   CONTEXTREAD(execute_at_start);                 ///< commands to execute as soon as config file is read
+  CONTEXTREAD(extra_rbn_servers);                ///< additional RBN-style servers, and their ports (0 => same as RBN PORT)
 
   CONTEXTREAD(fast_cq_bandwidth);                ///< fast CW bandwidth in CQ mode, in Hz
   CONTEXTREAD(fast_sap_bandwidth);               ///< fast CW bandwidth in SAP mode, in Hz
+  CONTEXTREAD(fuzzy_insertions_and_deletions);   ///< whether fuzzy matches include calls with one more or one fewer character
 
   CONTEXTREAD(geomagnetic_indices_command);      ///< command to get geomagnetic indices
 
@@ -585,6 +592,7 @@ public:
 
   CONTEXTREAD(rate_periods);                     ///< periods (in minutes) over which rates should be calculated
   CONTEXTREAD(rbn_beacons);                      ///< whether to place RBN posts from beacons on the bandmap
+  CONTEXTREAD(rbn_coalesce_window);              ///< how long to accumulate new RBN or cluster posts before processing them
   CONTEXTREAD(rbn_file);                         ///< name of file to which RBN lines should be copied
   CONTEXTREAD(rbn_port);                         ///< port number on the RBN server
   CONTEXTREAD(rbn_server);                       ///< hostname or IP address of RBN server
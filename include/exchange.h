@@ -20,6 +20,7 @@
 #include "pthread_support.h"
 #include "rules.h"
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -362,6 +363,8 @@ protected:
   std::map< std::pair< std::string /* callsign */, std::string /* field name */>, std::string /* value */>  _db;  ///< the actual database
 //          --------------------------------  key  -----------------------------  --------  value  -------
 
+  std::atomic<uint32_t> _generation { 0 };    ///< incremented whenever a value is set explicitly
+
 public:
 
 /*! \brief              Guess the value of an exchange field
@@ -396,6 +399,9 @@ public:
 /// return number of calls in the database
   inline size_t size(void) const
     { return _db.size(); }
+/// generation of the database; changes whenever a value is set explicitly
+  inline uint32_t generation(void) const
+    { return _generation; }
 };
 
 // -------------------------  sweepstakes_exchange  ---------------------------
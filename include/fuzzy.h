@@ -22,7 +22,9 @@
 #include <array>
 #include <set>
 #include <string>
+#include <string_view>
 #include <unordered_set>
+#include <vector>
 
 using FUZZY_SET = UNORDERED_STRING_SET;    ///< define the type of set used in fuzzy functions
 
@@ -30,6 +32,12 @@ using FUZZY_SET = UNORDERED_STRING_SET;    ///< define the type of set used in f
 
 /*! \class  fuzzy_database
     \brief  The database for the fuzzy function
+
+    A fuzzy match for a key is a call of the same length that differs from it in exactly one position.
+    Each call is indexed under every variant of itself with one position replaced by a wildcard,
+    so the matches for a key of length L are found with L hash lookups. Optionally, each call is
+    also indexed under every variant of itself with one character deleted, so that calls with one
+    more or one fewer character than the key are matched as well.
 */
 
 constexpr size_t MIN_FUZZY_SIZE { 3 };               ///< any call with fewer than this number of characters is included with size MIN_FUZZY_SIZE
@@ -39,8 +47,32 @@ class fuzzy_database
 {
 protected:
 
+  static constexpr char WILDCARD { '?' };                         ///< character that replaces one position in a call; never appears in a call
+
   std::array<FUZZY_SET, MAX_FUZZY_SIZE + 1 /* call size */>  _db;    ///< the database;
-  
+
+  using FUZZY_INDEX = UNORDERED_STRING_MAP<std::vector<std::string_view>>;   ///< type of an index; the values refer to the calls held in <i>_db</i>
+
+  FUZZY_INDEX _substitutions { };                 ///< key = call with one position replaced by WILDCARD; value = the calls that produce it
+  FUZZY_INDEX _deletions     { };                 ///< key = call with one character deleted; value = the calls that produce it
+
+  bool _insertions_and_deletions { false };                       ///< whether to match calls with one more or one fewer character than the key
+
+/*! \brief          Add a call to the indices
+    \param  call    call to be added; must be the copy held in <i>_db</i>, as the indices refer to it
+*/
+  void _index(const std::string& call);
+
+/*! \brief          Remove a call from the indices
+    \param  call    call to be removed
+
+    Must be called before <i>call</i> is removed from <i>_db</i>
+*/
+  void _unindex(const std::string_view call);
+
+/// index every call under each of its deletions
+  void _index_deletions(void);
+
 /*! \brief      Force a value to be within the legal range of sizes
     \param  sz  size that may need to be forced to change
     \return     <i>sz</i>, or a value within the legal range
@@ -56,6 +88,9 @@ public:
 /// default constructor
   fuzzy_database(void) = default;
 
+  fuzzy_database(const fuzzy_database&) = delete;                   ///< forbid copying; the indices refer to the calls in <i>_db</i>
+  fuzzy_database& operator=(const fuzzy_database&) = delete;        ///< forbid copying; the indices refer to the calls in <i>_db</i>
+
 /*! \brief              Construct from a file
     \param  filename    name of the file from which to construct the object
 
@@ -83,8 +118,7 @@ public:
 
     Does nothing if the call is already in the database
 */
-  inline void operator+=(const std::string_view call)
-    { _db[ _to_valid_size(call.length()) ] += call; }
+  void operator+=(const std::string_view call);
 
 /*! \brief          Remove a call from the database
     \param  call    call to be removed
@@ -92,9 +126,7 @@ public:
 
     Does nothing and returns <i>false</i> if <i>call</i> is not in the database
 */
-  inline bool remove_call(const std::string& call)                      // erase() does not yet work with string_view (checked in gcc 15.2)
-//  inline bool remove_call(const std::string_view call)
-    { return ( (_db[ _to_valid_size(call.length()) ].erase(call)) != 0 ); }          // could use STRC_ERASE here, with some effort
+  bool remove_call(const std::string& call);                      // erase() does not yet work with string_view (checked in gcc 15.2)
 
 /*! \brief          Is a call in the database?
     \param  call    call to be removed
@@ -109,9 +141,19 @@ public:
 */
   FUZZY_SET operator[](const std::string_view key) const;
 
+/*! \brief          Set whether to match calls with one more or one fewer character than the key
+    \param  b       whether to match such calls
+
+    Matches differ from the key in exactly one position if this is not set, which is the default
+*/
+  void insertions_and_deletions(const bool b);
+
 /// empty the database
   inline void clear(void)
-    { _db.fill( FUZZY_SET { } ); }
+    { _db.fill( FUZZY_SET { } );
+      _substitutions.clear();
+      _deletions.clear();
+    }
 };
 
 // -----------  fuzzy_databases  ----------------
@@ -0,0 +1,153 @@
+// $Id: lru_cache.h 1 2026-10-15 00:00:00Z  $
+
+// Released under the GNU Public License, version 2
+//   see: https://www.gnu.org/licenses/gpl-2.0.html
+
+// Principal author: N7DR
+
+// Copyright owners:
+//    N7DR
+
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+/*! \file   lru_cache.h
+
+    A simple thread-safe bounded cache that discards the least-recently used entry
+*/
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+/*! \class  lru_cache
+    \brief  A thread-safe cache of bounded size, which discards the least-recently used entry when full
+
+    If <i>H</i> and <i>E</i> are transparent, lookups may use any type that they accept (e.g., std::string_view for std::string keys)
+*/
+
+template <typename K, typename V, typename H = std::hash<K>, typename E = std::equal_to<K>>
+class lru_cache
+{
+protected:
+
+  using ENTRIES = std::list<std::pair<K, V>>;                       ///< type that holds the entries; most recently used first
+
+  ENTRIES                                                   _entries;     ///< the entries, most recently used first
+  std::unordered_map<K, typename ENTRIES::iterator, H, E>   _index;       ///< index into <i>_entries</i>
+  size_t                                                    _max_size;    ///< maximum number of entries
+
+  uint64_t _n_hits   { 0 };                 ///< number of lookups that found an entry
+  uint64_t _n_misses { 0 };                 ///< number of lookups that did not find an entry
+
+  mutable std::mutex _mtx;                  ///< mutex
+
+public:
+
+/*! \brief              Constructor
+    \param  max_size    maximum number of entries
+*/
+  explicit lru_cache(const size_t max_size) :
+    _max_size(max_size)
+  { }
+
+/*! \brief          Look up a key
+    \param  key     key to look up
+    \return         the value corresponding to <i>key</i>, if any
+
+    Counts as a hit or miss; a hit makes the entry the most recently used
+*/
+  template <typename KK>
+  std::optional<V> get(const KK& key)
+  { std::lock_guard<std::mutex> lg(_mtx);
+
+    const auto it { _index.find(key) };
+
+    if (it == _index.end())
+    { _n_misses++;
+      return std::nullopt;
+    }
+
+    _n_hits++;
+    _entries.splice(_entries.begin(), _entries, it -> second);
+
+    return it -> second -> second;
+  }
+
+/*! \brief          Add or replace an entry
+    \param  key     key
+    \param  value   value corresponding to <i>key</i>
+
+    The least-recently used entry is discarded if the cache is full
+*/
+  void insert(const K& key, const V& value)
+  { std::lock_guard<std::mutex> lg(_mtx);
+
+    if (const auto it { _index.find(key) }; it != _index.end())
+    { it -> second -> second = value;
+      _entries.splice(_entries.begin(), _entries, it -> second);
+
+      return;
+    }
+
+    if (_max_size == 0)
+      return;
+
+    if (_entries.size() == _max_size)
+    { _index.erase(_entries.back().first);
+      _entries.pop_back();
+    }
+
+    _entries.emplace_front(key, value);
+    _index.emplace(key, _entries.begin());
+  }
+
+/// remove all the entries, but keep the counters
+  void clear(void)
+  { std::lock_guard<std::mutex> lg(_mtx);
+
+    _index.clear();
+    _entries.clear();
+  }
+
+/// number of entries
+  size_t size(void) const
+  { std::lock_guard<std::mutex> lg(_mtx);
+
+    return _entries.size();
+  }
+
+/// maximum number of entries
+  size_t max_size(void) const
+  { std::lock_guard<std::mutex> lg(_mtx);
+
+    return _max_size;
+  }
+
+/// number of lookups that found an entry
+  uint64_t n_hits(void) const
+  { std::lock_guard<std::mutex> lg(_mtx);
+
+    return _n_hits;
+  }
+
+/// number of lookups that did not find an entry
+  uint64_t n_misses(void) const
+  { std::lock_guard<std::mutex> lg(_mtx);
+
+    return _n_misses;
+  }
+
+/// fraction of lookups that found an entry
+  double hit_rate(void) const
+  { std::lock_guard<std::mutex> lg(_mtx);
+
+    return ( (_n_hits + _n_misses) ? (static_cast<double>(_n_hits) / static_cast<double>(_n_hits + _n_misses)) : 0.0 );
+  }
+};
+
+#endif    // LRU_CACHE_H
@@ -18,13 +18,15 @@
 
 #include "drmaster.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <map>
+#include <optional>
 #include <set>
 #include <string>
+#include <string_view>
 #include <unordered_set>
-
-// forward declaration
-class scp_databases;
+#include <vector>
 
 using SCP_SET = UNORDERED_STRING_SET;    ///< define the type of set used in SCP functions
 
@@ -36,21 +38,46 @@ constexpr int SCP_KEY_SIZE { 2 };         // we index using pairs of characters
     \brief  The database for SCP
 
     We build our own database instead of trying to use the old K1EA
-    memory layout
+    memory layout.
+
+    The calls are held in a suffix array over a single string that contains all of them, so that
+    the calls that contain a key of length k are found in O(k log n) time, plus the time taken to
+    copy the matches. Calls that are added or removed after the index is built are held separately
+    until there are enough of them to make it worth rebuilding the index.
 */
 
 class scp_database
 {
 protected:
 
-  UNORDERED_STRING_MAP</* two characters */ SCP_SET /* calls that contain the two characters */ > _db;   ///< the main database;
+  static constexpr char SEPARATOR { '\n' };                  ///< terminates each call in <i>_corpus</i>; must sort before any character in a call
+
+  std::string           _corpus      { };     ///< the indexed calls, in alphabetical order, each followed by SEPARATOR
+  std::vector<uint32_t> _call_starts { };     ///< position in <i>_corpus</i> of the start of each indexed call
+  std::vector<uint32_t> _suffixes    { };     ///< suffix array: positions in <i>_corpus</i> of the suffixes of the calls, ordered by the remainder of the call
+  SCP_SET               _added       { };     ///< calls added since the index was built
+  SCP_SET               _removed     { };     ///< indexed calls removed since the index was built
 
-// a one-shot cache; I'm far from convinced that this is useful,
-// because an ordinary cache-miss lookup is so fast
-  std::string              _last_key;       ///< the key of the last lookup
-  SCP_SET                  _last_result;    ///< the result from the last lookup
+/*! \brief          Obtain an indexed call
+    \param  start   position of the start of the call in <i>_corpus</i>
+    \return         the call that starts at <i>start</i>
+*/
+  std::string_view _call_at(const uint32_t start) const;
+
+/*! \brief          Is a call in the index?
+    \param  call    call to test
+    \return         whether <i>call</i> is in the index, regardless of whether it has since been removed
+*/
+  bool _is_indexed(const std::string_view call) const;
 
-  std::vector<scp_databases*> _parents;     ///< a "parent" is an scp_databases object
+/// whether enough calls have been added or removed that the index should be rebuilt
+  inline bool _index_is_stale(void) const
+    { return ( (_added.size() + _removed.size()) > std::max(static_cast<size_t>(256), _call_starts.size() / 16) ); }
+
+/// rebuild the index so that it contains all the calls
+  void _rebuild_index(void);
+
+  uint64_t _generation { 0 };               ///< incremented whenever the contents change or the cache is cleared, so that sessions discard their results for this database
 
 public:
 
@@ -71,7 +98,9 @@ public:
 
 /// populate the database from a vector of calls
   inline void init_from_calls(const std::vector<std::string>& calls)
-    { FOR_ALL(calls, [this] (const std::string& this_call) { *this += this_call; } ); }
+    { FOR_ALL(calls, [this] (const std::string& this_call) { *this += this_call; } );
+      _rebuild_index();
+    }
 
 /// add a call to the database
   void operator+=(const std::string_view call);
@@ -90,27 +119,81 @@ public:
 /*! \brief        Is a call in the database?
     \param  call  call to test
     \return       Whether <i>call</i> is in the database
-
-    Actually tests only the set of calls for the first pair of characters in <i>call</i>
 */
-  inline bool contains(const std::string_view call)
-    { return (call.empty() ? false : (_db[substring <std::string> (call, 0, SCP_KEY_SIZE)].contains(call))); }
+  inline bool contains(const std::string_view call) const
+    { return (_added.contains(call) or (_is_indexed(call) and !_removed.contains(call))); }
+
+/// number of calls in the database
+  inline size_t size(void) const
+    { return (_call_starts.size() - _removed.size() + _added.size()); }
 
 /*! \brief          Return all the matches for a partial call
     \param  key     partial call
     \return         all the partial matches for <i>key</i>
+
+    Not cached; use an scp_match_session for repeated lookups as a call is typed
 */
   SCP_SET operator[](const std::string_view key);
 
 /// empty the database; also clears the cache
   void clear(void);
 
-/// clear the cache (without altering the database)
-  void clear_cache(void);
+/// clear the cache (without altering the database); the results for this database in every session are discarded
+  inline void clear_cache(void)
+    { _generation++; }
 
-/// add a parent scp_databases object
-  inline void add_parent(scp_databases& dbs)
-    { _parents += &dbs; }
+  READ(generation);             ///< incremented whenever the contents change or the cache is cleared
+};
+
+// -----------  scp_match_session  ----------------
+
+/*! \class  scp_match_session
+    \brief  Incremental SCP matching as a call is typed in a single window
+
+    Holds a stack of keys and their matches; each key contains the key below it. A key that extends the top of the
+    stack is matched by filtering the matches for the top; a backspace pops the stack, and the matches for the shorter
+    key are already known. The matches are held separately for each database, so that a change to one database
+    discards only the matches for that database.
+*/
+
+class scp_match_session
+{
+protected:
+
+/// a key, and its matches
+  struct entry
+  { std::string                         key;            ///< the key
+    std::vector<std::optional<SCP_SET>> matches;        ///< the matches in each database; std::nullopt => not known
+    SCP_SET                             all_matches;    ///< the matches in all the databases
+  };
+
+  std::vector<scp_database*> _dbs         { };    ///< the databases, in priority order
+  std::vector<uint64_t>      _generations { };    ///< the generation of each database when the matches for it were calculated
+  std::vector<entry>         _stack       { };    ///< the keys and their matches; each key contains the key below it
+
+/// discard the matches for any databases that have changed
+  void _discard_changed_databases(void);
+
+public:
+
+/// add a database to those that are consulted
+  void add_db(scp_database& db);
+
+/*! \brief          Return all the matches for a partial call
+    \param  key     partial call
+    \return         all the partial matches for <i>key</i>, in all the databases
+
+    The returned reference is valid until the next call to a non-const member function
+*/
+  const SCP_SET& operator[](const std::string_view key);
+
+/// discard all the matches
+  inline void clear(void)
+    { _stack.clear(); }
+
+/// number of keys whose matches are held
+  inline size_t depth(void) const
+    { return _stack.size(); }
 };
 
 // -----------  scp_databases  ----------------
@@ -128,8 +211,7 @@ protected:
 
   std::vector<scp_database*> _vec;    ///< in priority order, most important (i.e., the basic, static database) first.
 
-  std::string                _last_key;       ///< the key of the last lookup
-  SCP_SET                    _last_result;    ///< the result from the last lookup
+  scp_match_session          _session;        ///< the session used by operator[]
 
 public:
 
@@ -152,8 +234,15 @@ public:
   inline void operator-=(const std::string_view call)
     { remove_call(call); }
 
-/// return matches
-  SCP_SET operator[](const std::string_view key);
+/*! \brief          Return all the matches for a partial call
+    \param  key     partial call
+    \return         all the partial matches for <i>key</i>
+
+    The returned reference is valid until the next lookup; successive lookups share a single scp_match_session,
+    so this should be used for just one window
+*/
+  inline const SCP_SET& operator[](const std::string_view key)
+    { return _session[key]; }
 
 /// clear the cache; also clear the caches of any children
   void clear_cache(void);
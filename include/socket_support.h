@@ -25,10 +25,15 @@
 #include "macros.h"
 #include "pthread_support.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <deque>
+#include <mutex>
+#include <ranges>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -56,23 +61,28 @@ constexpr int TCP_SOCKET_UNKNOWN_DESTINATION  { -1 },     ///< Destination not s
               TCP_SOCKET_UNABLE_TO_SET_OPTION { -4 },     ///< Error setting a socket option
               TCP_SOCKET_UNABLE_TO_CLOSE      { -5 },     ///< Error closing socket
               TCP_SOCKET_UNABLE_TO_RESOLVE    { -6 },     ///< Error resolving destination
-              TCP_SOCKET_UNABLE_TO_GET_OPTION { -7 };     ///< Error getting a socket option
+              TCP_SOCKET_UNABLE_TO_GET_OPTION { -7 },     ///< Error getting a socket option
+              TCP_SOCKET_CLOSED_BY_PEER       { -8 };     ///< Connection closed by the far end
 
 constexpr int ICMP_SOCKET_UNABLE_TO_CREATE    { -1 },     ///< Unable to create socket
               ICMP_SOCKET_SEND_ERROR          { -2 };     ///< Error when sending
 
-constexpr int EPOLL_UNABLE_TO_CREATE          { -1 },     ///< unable to create epoll
-              EPOLL_UNABLE_TO_ADD_DESCRIPTOR  { -2 };     ///< unable to add a file descriptor to an epoll
+constexpr int EPOLL_UNABLE_TO_CREATE            { -1 },   ///< unable to create epoll
+              EPOLL_UNABLE_TO_ADD_DESCRIPTOR    { -2 },   ///< unable to add a file descriptor to an epoll
+              EPOLL_UNABLE_TO_REMOVE_DESCRIPTOR { -3 },   ///< unable to remove a file descriptor from an epoll
+              EPOLL_WAIT_ERROR                  { -4 },   ///< error received from epoll_wait()
+              EPOLL_UNABLE_TO_WAKE              { -5 };   ///< unable to wake a waiting epoll
 
 /// TCP socket error messages
-const std::string tcp_socket_error_string[8] { std::string { },
+const std::string tcp_socket_error_string[9] { std::string { },
                                                "Destination not set"s,
                                                "Error return from write()"s,
                                                "Error return from recv()"s,
                                                "Error return from setsockopt()"s,
                                                "Error closing socket"s,
                                                "Error resolving destination"s,
-                                               "Error return from getsockopt()"s
+                                               "Error return from getsockopt()"s,
+                                               "Connection closed by peer"s
                                              };
 
 /// ICMP socket error messages
@@ -217,6 +227,165 @@ sockaddr_in to_sockaddr_in(const sockaddr_storage& ss);
 */
 std::ostream& operator<<(std::ostream& ost, const struct sockaddr_in& pa);
 
+// ------------------------------------  line_buffer  ----------------------------------
+
+/*! \class  line_buffer
+    \brief  A buffer of received data, framed into CRLF-terminated lines
+
+    Data are received directly into the free space at the end of the buffer. Complete lines are passed to a
+    consumer by exchanging storage with the consumer's buffer, so that only the trailing partial line is ever copied.
+    The capacity is fixed unless a burst of data overflows it, in which case it doubles.
+    Thread safe.
+*/
+
+class line_buffer
+{
+protected:
+
+  std::vector<char> _data     { };      ///< storage; the size of the vector is the capacity of the buffer
+  size_t            _size     { 0 };    ///< number of bytes of data in <i>_data</i>
+  size_t            _complete { 0 };    ///< number of bytes of data that form complete lines (including their terminators)
+
+  mutable std::mutex _mtx;              ///< mutex
+
+/// update <i>_complete</i> after data have been added from position <i>from</i> onwards
+  void _update_complete(const size_t from);
+
+public:
+
+/*! \class  line_iterator
+    \brief  Iterator over the complete lines in a buffer
+
+    Each line is returned without its terminator
+*/
+  class line_iterator
+  {
+  protected:
+
+    static constexpr std::string_view TERMINATOR { "\r\n" };   ///< line terminator
+
+    std::string_view _remaining   { };                        ///< the data, starting with the current line
+    size_t           _line_length { std::string_view::npos };  ///< length of the current line; npos => no more lines
+
+  public:
+
+    using value_type      = std::string_view;     ///< type of the dereferenced iterator
+    using difference_type = std::ptrdiff_t;       ///< type of the difference between two iterators
+
+/// default constructor
+    line_iterator(void) = default;
+
+/*! \brief      Constructor
+    \param  sv  data over whose lines the iterator is to range
+*/
+    inline explicit line_iterator(const std::string_view sv) :
+      _remaining(sv),
+      _line_length(sv.find(TERMINATOR))
+    { }
+
+/// the current line
+    inline std::string_view operator*(void) const
+      { return _remaining.substr(0, _line_length); }
+
+/// move to the next line
+    inline line_iterator& operator++(void)
+    { _remaining.remove_prefix(_line_length + TERMINATOR.length());
+      _line_length = _remaining.find(TERMINATOR);
+
+      return *this;
+    }
+
+/// move to the next line
+    inline void operator++(int)
+      { ++(*this); }
+
+/// are there no more lines?
+    inline bool operator==(const std::default_sentinel_t) const
+      { return (_line_length == std::string_view::npos); }
+  };
+
+/*! \brief              Constructor
+    \param  capacity    initial capacity, in bytes
+*/
+  inline explicit line_buffer(const size_t capacity = 65'536) :
+    _data(capacity)
+  { }
+
+  line_buffer(const line_buffer&) = delete;       ///< forbid copying
+
+/*! \brief              Receive data directly into the free space at the end of the buffer
+    \param  receive     function that is passed a pointer to the free space and its size, and returns the number of bytes written (or -1)
+    \return             the value returned by <i>receive</i>
+
+    The buffer is enlarged first if it is full
+*/
+  template <typename F>
+  ssize_t fill(F&& receive)
+  { std::lock_guard<std::mutex> lg(_mtx);
+
+    if (_size == _data.size())
+      _data.resize(std::max(_data.size() * 2, static_cast<size_t>(1'024)));
+
+    const ssize_t rv { receive(_data.data() + _size, _data.size() - _size) };
+
+    if (rv > 0)
+    { const size_t old_size { _size };
+
+      _size += static_cast<size_t>(rv);
+      _update_complete(old_size);
+    }
+
+    return rv;
+  }
+
+/*! \brief          Append data
+    \param  str     data to append
+*/
+  void append(const std::string_view str);
+
+/*! \brief          Move the complete lines to another buffer
+    \param  dest    destination buffer; must not be in use by another thread
+
+    Any data already in <i>dest</i> are discarded. Only the trailing partial line (if any) is copied; it remains in this buffer
+*/
+  void move_complete_lines_to(line_buffer& dest);
+
+/*! \brief          Append the complete lines to another buffer
+    \param  dest    destination buffer; must contain only complete lines
+
+    The trailing partial line (if any) remains in this buffer
+*/
+  void append_complete_lines_to(line_buffer& dest);
+
+/// does the buffer contain any complete lines?
+  inline bool has_complete_lines(void) const
+    { std::lock_guard<std::mutex> lg(_mtx);
+      return (_complete != 0);
+    }
+
+/// is the buffer empty?
+  inline bool empty(void) const
+    { std::lock_guard<std::mutex> lg(_mtx);
+      return (_size == 0);
+    }
+
+/// remove all the data, retaining the storage
+  inline void clear(void)
+    { std::lock_guard<std::mutex> lg(_mtx);
+      _size = _complete = 0;
+    }
+
+/*! \brief      The complete lines in the buffer
+    \return     range of the complete lines, each without its terminator
+
+    The buffer must not be modified while the range is in use
+*/
+  inline std::ranges::subrange<line_iterator, std::default_sentinel_t> lines(void) const
+    { std::lock_guard<std::mutex> lg(_mtx);
+      return { line_iterator { std::string_view { _data.data(), _complete } }, std::default_sentinel };
+    }
+};
+
 // ------------------------------------  tcp_socket  ----------------------------------
 
 /*! \class  tcp_socket
@@ -413,6 +582,21 @@ public:
 */
   std::string read(const unsigned long timeout_secs) const;
 
+/*! \brief          Receive, without waiting, whatever data are available directly into a line buffer
+    \param  buf     buffer into which data are to be received
+    \return         number of bytes received
+
+    Throws a tcp_socket_error if the far end has closed the connection or an error occurs
+*/
+  size_t read_available(line_buffer& buf) const;
+
+/*! \brief          Set or unset non-blocking mode
+    \param  torf    whether the socket is to be non-blocking
+
+    Throws a tcp_socket_error if an error occurs
+*/
+  void non_blocking(const bool torf = true);
+
 /*! \brief                  Simple receive
     \param  timeout_secs    timeout
     \return                 received string
@@ -614,32 +798,68 @@ public:
     { _icmp_socket_mutex.rename(new_name); }
 };
 
-#if 0
-
-not yet ready for use
-
 // ------------------------------------  epoller  ----------------------------------
 
 /*! \class  epoller
     \brief  Encapsulate and manage Linux epoll functions
+
+    Each file descriptor is registered with a tag, which is returned by wait() when the descriptor is ready.
+    A wait() may be interrupted from another thread with wake().
 */
 
 class epoller
 {
 protected:
 
-  int                _fd;
-
-  struct epoll_event _ev;
+  int _fd      { -1 };              ///< the epoll file descriptor
+  int _wake_fd { -1 };              ///< eventfd used to interrupt wait()
 
 public:
 
+  static constexpr uint64_t WAKE_TAG { UINT64_MAX };   ///< tag returned by wait() after a call to wake()
+
+/// constructor
   epoller(void);
 
-  void operator+=(const int file_descriptor);   // fd of interest
+/// destructor
+  ~epoller(void);
+
+  epoller(const epoller&) = delete;     ///< forbid copying
+
+/*! \brief                      Register a file descriptor
+    \param  file_descriptor     file descriptor of interest
+    \param  tag                 value to be returned by wait() when <i>file_descriptor</i> is ready
+    \param  events              events of interest
+
+    Throws an epoll_error if the descriptor cannot be added
+*/
+  void add(const int file_descriptor, const uint64_t tag, const uint32_t events = EPOLLIN);
+
+/*! \brief                      Register a file descriptor for input, tagged with the value of the descriptor
+    \param  file_descriptor     file descriptor of interest
+*/
+  inline void operator+=(const int file_descriptor)
+    { add(file_descriptor, static_cast<uint64_t>(file_descriptor)); }
+
+/*! \brief                      Unregister a file descriptor
+    \param  file_descriptor     file descriptor no longer of interest
+
+    Does nothing if <i>file_descriptor</i> is not registered or has been closed
+*/
+  void operator-=(const int file_descriptor);
+
+/*! \brief              Wait for registered file descriptors to become ready
+    \param  max_wait    maximum time to wait
+    \param  max_events  maximum number of events to return
+    \return             the ready events; empty if the wait timed out or was interrupted by a signal
+
+    Throws an epoll_error if an error occurs
+*/
+  std::vector<struct epoll_event> wait(const std::chrono::milliseconds max_wait, const int max_events = 16) const;
 
+/// interrupt a wait() in another thread
+  void wake(void);
 };
-#endif
 
 /*! \brief              Convert a name to a dotted decimal IP address
     \param  fqdn        name to be resolved
@@ -663,6 +883,6 @@ ERROR_CLASS(tcp_socket_error);      ///< errors related to TCP sockets
 
 ERROR_CLASS(icmp_socket_error);     ///< errors related to ICMP sockets
 
-//ERROR_CLASS(epoll_error);           ///< errors related to epolls
+ERROR_CLASS(epoll_error);           ///< errors related to epolls
 
 #endif    // !SOCKET_SUPPORT_H
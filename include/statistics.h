@@ -26,6 +26,7 @@
 #include "serialization.h"
 
 #include <array>
+#include <atomic>
 #include <map>
 #include <set>
 #include <string>
@@ -74,6 +75,8 @@ protected:
   NTYPE                                                      _qtc_qsos_sent   { 0 };     ///< total number of QSOs sent in QTCs
   NTYPE                                                      _qtc_qsos_unsent { 0 };     ///< total number of (legal) QSOs available but not yet sent in QTCs
 
+  std::atomic<uint32_t> _generation { 0 };         ///< incremented (under the lock) whenever anything that might change whether a mult is needed changes
+
   mutable pt_mutex _statistics_mutex { "STATISTICS"s };                                                           ///< mutex for statistics
 
 /*! \brief              Add a callsign mult name, value and band to those worked
@@ -125,6 +128,10 @@ public:
   SAFEREAD(country_mults_used, statistics);                 ///< are country mults used?
   SAFEREAD(exchange_mults_used, statistics);                ///< are exchange mults used?
 
+/// generation of the statistics; changes whenever anything that might change whether a mult is needed changes
+  inline uint32_t generation(void) const
+    { return _generation; }
+
 /*! \brief          How many QSOs have been made?
     \param  rules   rules for this contest
 
@@ -56,12 +56,37 @@ public:
     return tmp;
   }
 
+/*!  \brief   Remove all the elements from the queue
+     \return  the elements that were in the queue, front first
+*/
+  std::vector<T> pop_all(void)
+  { std::lock_guard<std::recursive_mutex> lock(_q_mutex);
+
+    std::vector<T> rv;
+
+    rv.reserve(_q.size());
+
+    while (!_q.empty())
+    { rv.push_back(std::move(_q.front()));
+      _q.pop();
+    }
+
+    return rv;
+  }
+
 /// is the queue empty?
   bool empty(void) const
   { std::lock_guard<std::recursive_mutex> lock(_q_mutex);
 
     return _q.empty();
   }
+
+/// number of elements in the queue
+  size_t size(void) const
+  { std::lock_guard<std::recursive_mutex> lock(_q_mutex);
+
+    return _q.size();
+  }
 };
 
 #endif    // TS_QUEUE_H
@@ -24,192 +24,178 @@ extern MINUTES_TYPE   now_minutes;  ///< access the current time in minutes
 
 void alert(const string_view msg, const SHOW_TIME show_time = SHOW_TIME::SHOW);   ///< Alert the user
 
-busts_database busts_db;
-
 // -----------  autocorrect_database  ----------------
 
 /*! \class  autocorrect_database
     \brief  The database of good calls for the (non-dynamic) autocorrect function
 */
 
-/*! \brief          Obtain an output call from an input
-    \param  str     input call
-    \return         <i>str</i> or a corrected version of same
-*/
-string autocorrect_database::corrected_call(const string_view str) const
-{ if (str.empty())
-    return string { };
-
-// insert a mapping into the cache
-  auto insert = [this] (const string_view input, const auto output)
-    { const string s { to_string(output) };
-
-      _cache += { input, s };
-
-      if (output != input)
-        ost << "  autocorrect: " << input << " -> " << output << endl;
-
-      return s;
-    };
+/*! \brief              Initialise the database from a container of known-good calls
+    \param  callsigns   vector of known-good calls
 
-// return cached value
-  if (const string from_cache { MUM_VALUE(_cache, str) }; !from_cache.empty())
-    return from_cache;
-
-  const bool present { contains(str) };   // whether str is a known good call
-  const bool absent  {!present };
-
-// return known good call
-  if (present)            // for now, assume that all the calls in the database are good; maybe change this later; note that this test is repeated in the tests below
-    return insert(str, str);
-
-// absent should always be true from this point on; but let's not assume it in case we change something later
-
-// long call ends with a bust of "TEST"
-  static const FLAT_STRING_SET broken_TEST { "EAE"s, "EETE"s, "EST"s, "NST"s, "TEAT"s, "TEET"s, "TEIT"s, "TENT"s, "TETT"s, "TRT"s, "TUT"s };
-
-  for ( const auto& broken_suffix : broken_TEST )
-  { const size_t broken_length { broken_suffix.size() };
-
-    if ( absent and (str.size() >= (broken_length + 3)) and str.ends_with(broken_suffix) )
-    { if (const string call_to_test { substring <string> (str, 0, str.size() - broken_length) }; contains(call_to_test))
-        return insert(str, call_to_test);
-    }
-  }
+    Also builds the index of busts
+*/
+void autocorrect_database::init_from_calls(const vector<string>& callsigns)
+{ _calls += callsigns;
+  _busts.clear();
+
+  UNORDERED_STRING_MAP<int> ranks;    // rank of the slip that produced each bust; a lower rank corresponds to an earlier test in _corrected_call()
+
+  auto add_bust { [this, &ranks] (const string& bust, const string* good_call_p, const int rank)
+                    { if (const auto it { ranks.find(bust) }; it == ranks.end())
+                      { ranks.emplace(bust, rank);
+                        _busts[bust] = good_call_p;
+                      }
+                      else
+                      { if (rank < it -> second)
+                        { it -> second = rank;
+                          _busts[bust] = good_call_p;
+                        }
+                      }
+                    } };
+
+  for (const string& call : _calls)
+  { const string* p    { &call };                                     // elements of an unordered set don't move
+    const string  tail1 { substring <string> (call, 1) };
+    const string  tail2 { substring <string> (call, 2) };
 
 // extraneous:
 //   E in front of a US K call
 //   T in front of a US K call
 //   T in front of a US N call
-  if (absent and (str.starts_with("EK"sv) or str.starts_with("TK"sv) or str.starts_with("TN"sv)))
-  { if (const string_view call_to_test { substring <string_view> (str, 1) }; contains(call_to_test))
-      return insert(str, call_to_test);
-  }
+    if (call.starts_with('K'))
+    { add_bust("E"s + call, p, 1);
+      add_bust("T"s + call, p, 1);
+    }
+
+    if (call.starts_with('N'))
+      add_bust("T"s + call, p, 1);
 
 // PA copied as GA
-  if (absent and str.starts_with("GA"sv))
-  { if (absent)
-    { if (const string call_to_test { "PA"s + substring <string> (str, 2) }; contains(call_to_test))
-        return insert(str, call_to_test);
-    }
-  }
+    if (call.starts_with("PA"sv))
+      add_bust("GA"s + tail2, p, 2);
 
 // US N call copied as I#
-  if (absent and str.starts_with('I') and (str.length() > 1) and isdigit(str[1]))
-  { if (const string call_to_test { "N"s + substring <string> (str, 1) }; contains(call_to_test))
-      return insert(str, call_to_test);
-  }
+    if (call.starts_with('N') and (call.length() > 1) and isdigit(call[1]))
+      add_bust("I"s + tail1, p, 3);
 
 // JA miscopied as JT
-  if (str.starts_with("JT"sv))
-  { if (absent)
-    { if (const string call_to_test { "JA"s + substring <string> (str, 2) }; contains(call_to_test))
-        return insert(str, call_to_test);
-    }
-  }
+    if (call.starts_with("JA"sv))
+      add_bust("JT"s + tail2, p, 4);
 
 // initial K or initial W copied as an initial M; if both K and W are valid, then we simply choose K
-  if (str.starts_with('M'))
-  { if (absent)
-    { const string sub { substring <string> (str, 1) };
-
-      if (const string call_to_test { "K"s + sub }; contains(call_to_test))
-        return insert(str, call_to_test);
+    if (call.starts_with('K'))
+      add_bust("M"s + tail1, p, 5);
 
-      if (const string call_to_test { "W"s + sub }; contains(call_to_test))
-        return insert(str, call_to_test);
-    }
-  }
+    if (call.starts_with('W'))
+      add_bust("M"s + tail1, p, 6);
 
 // initial L copied as an initial D
-  if (str.starts_with('D'))
-  { if (absent)
-    { if (const string call_to_test { "L"s + substring <string> (str, 1) }; contains(call_to_test))
-        return insert(str, call_to_test);
-    }
-  }
+    if (call.starts_with('L'))
+      add_bust("D"s + tail1, p, 7);
 
 // UA copied as MA
-  if (str.starts_with("MA"sv))
-  { if (absent)
-    { if (const string call_to_test { "UA"s + substring <string> (str, 2) }; contains(call_to_test))
-        return insert(str, call_to_test);
-    }
-  }
+    if (call.starts_with("UA"sv))
+      add_bust("MA"s + tail2, p, 8);
 
 // initial J copied as an initial O
-  if (str.starts_with('O') and (str.size() > 3))
-  { switch (str[1])
-    { case 'A' :
-      case 'E' :
-      case 'F' :
-      case 'G' :
-      case 'H' :
-      case 'I' :
-      case 'J' :
-      case 'K' :
-      case 'L' :
-      case 'M' :
-      case 'N' :
-      case 'O' :
-      case 'P' :
-      case 'Q' :
-      case 'R' :
-      case 'S' :
-        
-        if (const string call_to_test { "J"s + substring <string> (str, 1) }; contains(call_to_test))
-          return insert(str, call_to_test);
-
-      default :
-        break;
-    }
-  }
+    if (call.starts_with('J') and (call.size() > 3) and "AEFGHIJKLMNOPQRS"sv.contains(call[1]))
+      add_bust("O"s + tail1, p, 9);
 
 // US K call copied as TT#
-  if (absent and str.starts_with("TT"sv) and (str.length() > 2) and isdigit(str[2]))
-  { if (const string call_to_test { "K"s + substring <string> (str, 2) }; contains(call_to_test))
-      return insert(str, call_to_test);
-  }
+    if (call.starts_with('K') and (call.length() > 1) and isdigit(call[1]))
+      add_bust("TT"s + tail1, p, 10);
 
 // US N call copied as T#
-  if (absent and str.starts_with('T') and (str.length() > 1) and isdigit(str[1]))
-  { if (const string call_to_test { "N"s + substring <string> (str, 1) }; contains(call_to_test))
-      return insert(str, call_to_test);
-  }
+    if (call.starts_with('N') and (call.length() > 1) and isdigit(call[1]))
+      add_bust("T"s + tail1, p, 11);
 
 // initial PY copied as initial TM
-  if (absent and str.starts_with("TM"sv))
-  { if (const string call_to_test { "PY"s + substring <string> (str, 2) }; contains(call_to_test))
-      return insert(str, call_to_test);
-  }
+    if (call.starts_with("PY"sv))
+      add_bust("TM"s + tail2, p, 12);
 
 // initial YB copied as initial TI
-  if (absent and str.starts_with("TI"sv))
-  { if (const string call_to_test { "YB"s + substring <string> (str, 2) }; contains(call_to_test))
-      return insert(str, call_to_test);
+    if (call.starts_with("YB"sv))
+      add_bust("TI"s + tail2, p, 13);
+  }
+}
+
+/*! \brief          Obtain an output call from an input
+    \param  str     input call
+    \return         <i>str</i> or a corrected version of same
+*/
+string autocorrect_database::corrected_call(const string_view str) const
+{ if (str.empty())
+    return string { };
+
+// return cached value
+  if (const optional<string> from_cache { _cache.get(str) }; from_cache)
+    return from_cache.value();
+
+  const string rv { _corrected_call(str) };
+
+  _cache.insert(string { str }, rv);
+
+  if (rv != str)
+    ost << "  autocorrect: " << str << " -> " << rv << endl;
+
+  return rv;
+}
+
+/*! \brief          Obtain the output call from an input call, without using the cache
+    \param  str     input call
+    \return         <i>str</i> or a corrected version of same
+*/
+string autocorrect_database::_corrected_call(const string_view str) const
+{
+// return known good call
+  if (contains(str))            // for now, assume that all the calls in the database are good; maybe change this later
+    return string { str };
+
+// long call ends with a bust of "TEST"
+  static const FLAT_STRING_SET broken_TEST { "EAE"s, "EETE"s, "EST"s, "NST"s, "TEAT"s, "TEET"s, "TEIT"s, "TENT"s, "TETT"s, "TRT"s, "TUT"s };
+
+  for ( const auto& broken_suffix : broken_TEST )
+  { const size_t broken_length { broken_suffix.size() };
+
+    if ( (str.size() >= (broken_length + 3)) and str.ends_with(broken_suffix) )
+    { if (const string call_to_test { substring <string> (str, 0, str.size() - broken_length) }; contains(call_to_test))
+        return call_to_test;
+    }
   }
 
+// slips at the start of the call; the index holds the result of the first applicable test
+  if (const auto it { _busts.find(str) }; it != _busts.end())
+    return *(it -> second);
+
 // /P is quite often reported by the RBN as /W, especially in NFD
-  if (absent and str.ends_with("/W"sv))
+  if (str.ends_with("/W"sv))
   { const string base_call_to_test { substring <string> (str, 0, str.length() - 2) };
 
     if (contains(base_call_to_test) or contains(base_call_to_test + "/P"s))
-      return insert(str, base_call_to_test + "/P"s);
+      return base_call_to_test + "/P"s;
   }
 
 // various busts of "HQ" at the end of a call
   static const FLAT_STRING_SET broken_HQ { "EIQ"s, "HMT"s, "IEQ"s };
 
   for (const string& bust_HQ : broken_HQ)
-  { if (absent and str.ends_with(bust_HQ))
+  { if (str.ends_with(bust_HQ))
     { const string base_call_to_test { substring <string> (str, 0, str.length() - bust_HQ.length()) + "HQ"sv };
 
       if (contains(base_call_to_test))    // if xxxxHQ is present and xxxx<bust> is not
-        return insert(str, base_call_to_test);
+        return base_call_to_test;
     }
   }
 
-  return insert(str, str );
+  return string { str };
+}
+
+/// cache statistics, as a printable string
+string autocorrect_database::cache_statistics(void) const
+{ return "entries = "s + to_string(_cache.size()) + "/"s + to_string(_cache.max_size()) +
+         "; hits = "s + to_string(_cache.n_hits()) + "; misses = "s + to_string(_cache.n_misses()) +
+         "; hit rate = "s + to_string(static_cast<int>(_cache.hit_rate() * 100 + 0.5)) + "%"s;
 }
 
 // -----------  band_dynamic_autocorrect_database  ----------------
@@ -218,22 +204,52 @@ string autocorrect_database::corrected_call(const string_view str) const
     \brief  A single-band database for the dynamic lookup
 */
 
+/*! \brief          Obtain the id of a call, creating one if necessary
+    \param  call    call
+    \return         the id of <i>call</i>
+*/
+uint32_t band_dynamic_autocorrect_database::_call_id(const string& call)
+{ const auto [it, inserted] { _call_ids.try_emplace(call, static_cast<uint32_t>(_calls.size())) };
+
+  if (inserted)
+    _calls.push_back(call);
+
+  return it -> second;
+}
+
+/*! \brief          Is one call a bust of another?
+    \param  id1     id of first call
+    \param  id2     id of second call
+    \return         whether the calls with ids <i>id1</i> and <i>id2</i> are busts of each other
+*/
+bool band_dynamic_autocorrect_database::_is_bust(const uint32_t id1, const uint32_t id2)
+{ const uint64_t key { (static_cast<uint64_t>(min(id1, id2)) << 32) + max(id1, id2) };
+
+  if (const auto it { _busts.find(key) }; it != _busts.end())
+    return it -> second;
+
+  const bool rv { is_bust_call(_calls[id1], _calls[id2]) };
+
+  _busts[key] = rv;
+
+  return rv;
+}
+
 /*! \brief              Prune the database by removing old minutes
     \param  n_minutes   remove all data older than <i>n_minutes</i> ago
 */
 void band_dynamic_autocorrect_database::prune(const int n_minutes)
-{ const auto now_min    { now_minutes };
-  const auto target_min { now_min - n_minutes };
+{ lock_guard<recursive_mutex> lg(_mtx);
 
-  set<time_t> keys_to_remove;               // in theory this is unnecessary, as there will be, at most, only one element. But be paranoid.
+  _retained_from = now_minutes - n_minutes + 1;
 
-  lock_guard<recursive_mutex> lg(_mtx);
+// reset the expired slots, and forget bins that become empty
+  erase_if(_occupied_bins, [this] (const uint32_t bin_nr) { vector<minute_slot>& bin { _bins[bin_nr] };
 
-  for (const auto& [ time_in_minutes, _ ] : _data_map_map_map)      // remove old keys (which are times in minutes); start by filling a container of keys to remove
-    if (time_in_minutes <= target_min)
-      keys_to_remove += time_in_minutes;
+                                                            erase_if(bin, [this] (const minute_slot& slot) { return (slot.minute < _retained_from); });
 
-  FOR_ALL(keys_to_remove, [this] (const time_t key_to_remove) { _data_map_map_map -= key_to_remove; }); // perform the removal
+                                                            return bin.empty();
+                                                          });
 }
 
 /*! \brief      Set the value of the band
@@ -245,6 +261,9 @@ void band_dynamic_autocorrect_database::to_band(const BAND b)
   _b = b;
   _f_min_100 = lower_edge(b).hz() / 100;
   _f_max_100 = upper_edge(b).hz() / 100;
+
+  _bins.assign(_f_max_100 - _f_min_100 + 1, { });
+  _occupied_bins.clear();
 }
 
 /*! \brief          Add a post to the database
@@ -256,15 +275,38 @@ void band_dynamic_autocorrect_database::insert(const dx_post& post)
   if (post.band() != _b)    // check that the band is correct
     return;
 
-  const F100_TYPE f_100   { static_cast<F100_TYPE>(post.freq().hz() / 100) };    // frequency of the post in the correct units
-  const string&   call    { post.callsign() };
-  const auto      now_min { now_minutes };
+  const F100_TYPE f_100 { static_cast<F100_TYPE>(post.freq().hz() / 100) };    // frequency of the post in the correct units
+
+  if ( (f_100 < _f_min_100) or (f_100 > _f_max_100) )
+    return;
+
+  const uint32_t     bin_nr  { f_100 - _f_min_100 };
+  const uint32_t     call_id { _call_id(post.callsign()) };
+  const MINUTES_TYPE now_min { now_minutes };
+
+  vector<minute_slot>& bin { _bins[bin_nr] };
+
+  if (bin.empty())
+    _occupied_bins += bin_nr;
+
+  minute_slot* expired_slot_p { nullptr };
+
+  for (minute_slot& slot : bin)
+  { if ( (slot.minute == now_min) and (slot.call_id == call_id) )
+    { slot.count++;
+      return;
+    }
+
+    if (!expired_slot_p and (slot.minute < _retained_from))
+      expired_slot_p = &slot;
+  }
 
-  auto& data_this_minute          { _data_map_map_map[now_min] };           // creates if doesn't exist
-  auto& data_this_minute_and_freq { data_this_minute[f_100] };              // creates if doesn't exist
-  auto& data_minute_f100_call     { data_this_minute_and_freq[call] };
+  const minute_slot new_slot { now_min, call_id, 1 };
 
-  data_minute_f100_call++;
+  if (expired_slot_p)
+    *expired_slot_p = new_slot;
+  else
+    bin.push_back(new_slot);
 }
 
 /*! \brief          Perform dynamic autocorrection on a call (if necessary)
@@ -274,46 +316,28 @@ void band_dynamic_autocorrect_database::insert(const dx_post& post)
 string band_dynamic_autocorrect_database::autocorrect(const dx_post& post)
 { string rv { post.callsign() };            // default is to return an unchanged call
 
-  const string post_call { post.callsign() };
-
   lock_guard<recursive_mutex> lg(_mtx);
 
-  const F100_TYPE f_100       { static_cast<F100_TYPE>(post.freq().hz() / 100) };    // frequency of the post in the correct units
-  const F100_TYPE low_target  { f_100 - 2 };            // target - 200 Hz
-  const F100_TYPE high_target { f_100 + 3 };            // target + 200 Hz
-
-  UNORDERED_STRING_MAP<int> hits;     // key = call; value = n_occurrences
-
-//  std::map<time_t, std::map<F100_TYPE /* f_100 */, UNORDERED_STRING_MAP<size_t /* number of appearances */>>> _data_map_map_map; // time in minutes, f_100, callsign, number of times the
-
-  for (auto& [_, freq_map] : _data_map_map_map)
-  {
-// test only if frequency is in range
-    const auto lb { freq_map.lower_bound(low_target) };
-    const auto ub { freq_map.upper_bound(high_target) };
-
-    for (auto f_it { lb }; f_it != ub; ++f_it)
-    { for (const auto& [c, n] : f_it -> second)     // callsign, number of appearances
-      {
-// check it if it's a match or a bust of a match
-        if (post_call != c)
-        { const string calls { pair_index(post_call, c) };
-
-          if (busts_db.is_known_bust(calls))
-            hits[c] += n;
-          else
-          { if (!busts_db.is_known_non_bust(calls))    // if neither known bust nor known non-bust
-            { if (is_bust_call(post_call, c))
-              { busts_db.known_bust(calls);
-                hits[c] += n;
-              }
-              else
-                busts_db.known_non_bust(calls);
-            }
-          }
-        }
-        else    // posted call matches one that's been seen before (post_call == c)
-          hits[c] += n;
+  const F100_TYPE f_100 { static_cast<F100_TYPE>(post.freq().hz() / 100) };    // frequency of the post in the correct units
+
+  if ( _bins.empty() or (f_100 < _f_min_100) or (f_100 > _f_max_100) )
+    return rv;
+
+  const uint32_t post_id   { _call_id(rv) };
+  const size_t   first_bin { (f_100 - _f_min_100 >= 2) ? (f_100 - _f_min_100 - 2) : 0 };       // target - 200 Hz
+  const size_t   last_bin  { min(static_cast<size_t>(f_100 - _f_min_100 + 3), _bins.size() - 1) };  // target + 200 Hz
+
+  vector<pair<uint32_t /* call id */, uint32_t /* n_occurrences */>> hits;
+
+  for (size_t bin_nr { first_bin }; bin_nr <= last_bin; ++bin_nr)
+  { for (const minute_slot& slot : _bins[bin_nr])
+    {
+// count it if it's a match or a bust of a match
+      if ( (slot.minute >= _retained_from) and ( (slot.call_id == post_id) or _is_bust(post_id, slot.call_id) ) )
+      { if (auto it { SR::find(hits, slot.call_id, &pair<uint32_t, uint32_t>::first) }; it != hits.end())
+          it -> second += slot.count;
+        else
+          hits.emplace_back(slot.call_id, slot.count);
       }
     }
   }
@@ -326,22 +350,10 @@ string band_dynamic_autocorrect_database::autocorrect(const dx_post& post)
     ost << this -> to_string() << endl;
   }
   else
-  { string best_match;
-    int    highest_n;
-
-    tie(best_match, highest_n) = *(hits.begin());
-
-    for (auto it { next(hits.begin()) }; it != hits.end(); ++it)
-    { const auto& [ possible_best_match, possible_highest_n ] { *it };
-
-      if (possible_highest_n > highest_n)
-      { best_match = possible_best_match;
-        highest_n = possible_highest_n;
-      }
-    }
+  { const auto& [best_match_id, highest_n] { *SR::max_element(hits, {}, &pair<uint32_t, uint32_t>::second) };
 
     if (highest_n > 1)      // don't change if it's a 50/50 chance, since there's just no way to tell if we should do so
-      rv = best_match;
+      rv = _calls[best_match_id];
   }
 
   return rv;
@@ -358,15 +370,16 @@ string band_dynamic_autocorrect_database::to_string(const int n_spaces) const
 
   lock_guard<recursive_mutex> lg(_mtx);
 
-  for (const auto& [t, fcn] : _data_map_map_map)
-  { rv += leading_spaces + ::to_string(t) + COLON + EOL;
+  vector<uint32_t> bin_nrs { _occupied_bins };
 
-    for (const auto& [f, cn] : fcn)
-    { rv += leading_spaces + "  "s + ::to_string(f) + "  :"s + EOL;
+  SORT(bin_nrs);
 
-      for (const auto& [c, n] : cn)
-        rv += leading_spaces + "    "s + ::to_string(c) + "    : "s + ::to_string(n) + EOL;
-    }
+  for (const uint32_t bin_nr : bin_nrs)
+  { rv += leading_spaces + "  "s + ::to_string(_f_min_100 + bin_nr) + "  :"s + EOL;
+
+    for (const minute_slot& slot : _bins[bin_nr])
+      if (slot.minute >= _retained_from)
+        rv += leading_spaces + "    "s + _calls[slot.call_id] + "    : "s + ::to_string(slot.count) + " (minute "s + ::to_string(slot.minute) + ")"s + EOL;
   }
 
   return rv;
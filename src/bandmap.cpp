@@ -21,8 +21,12 @@
 #include "string_functions.h"
 #include "time_log.h"
 
+#include <bitset>
 #include <fstream>
 #include <functional>
+#include <limits>
+#include <map>
+#include <optional>
 
 using namespace std;
 
@@ -44,6 +48,8 @@ extern message_stream                ost;
 
 extern const FLAT_STRING_SET CONTINENT_SET;                 ///< two-letter abbreviations for all the continents
 
+extern contest_rules                 rules;                                     ///< the rules for this contest
+
 extern bool is_marked_frequency(const map<MODE, vector<pair<frequency, frequency>>>& marked_frequency_ranges, const MODE m, const frequency f); ///< Is a particular frequency within any marked range?
 
 /*! \brief                      Obtain value corresponding to a type of callsign mult from a callsign
@@ -54,6 +60,29 @@ extern bool is_marked_frequency(const map<MODE, vector<pair<frequency, frequency
 */
 extern string callsign_mult_value(const string_view callsign_mult_name, const string_view callsign);
 
+/*! \brief                      Key in the reverse mult index of a bandmap for a country
+    \param  canonical_prefix    canonical prefix of the country
+    \return                     the key corresponding to <i>canonical_prefix</i>
+*/
+inline string country_mult_key(const string_view canonical_prefix)
+  { return "P|"s + string { canonical_prefix }; }
+
+/*! \brief          Key in the reverse mult index of a bandmap for a callsign mult value
+    \param  name    name of the callsign mult (e.g., "WPXPX")
+    \param  value   value of the callsign mult
+    \return         the key corresponding to <i>name</i> and <i>value</i>
+*/
+inline string callsign_mult_key(const string_view name, const string_view value)
+  { return "M|"s + string { name } + "|"s + string { value }; }
+
+/*! \brief          Key in the reverse mult index of a bandmap for an exchange mult value
+    \param  name    name of the exchange mult
+    \param  value   canonical value of the exchange mult
+    \return         the key corresponding to <i>name</i> and <i>value</i>
+*/
+inline string exchange_mult_key(const string_view name, const string_view value)
+  { return "X|"s + string { name } + "|"s + string { value }; }
+
 constexpr unsigned int  MAX_CALLSIGN_WIDTH { 11 };        ///< maximum width of a callsign in the bandmap window
 constexpr frequency     MAX_FREQUENCY_SKEW { 250_Hz };    ///< maximum separation to be treated as same frequency
 
@@ -61,6 +90,11 @@ constexpr string MODE_MARKER { "********"s };          ///< string to mark the m
 constexpr string MY_MARKER   { "--------"s };          ///< the string that marks my position in the bandmap
 
 bandmap_filter_type BMF;                            ///< the global bandmap filter
+
+mult_status_cache mult_cache;                       ///< the mult status of recently seen calls
+
+pt_mutex                           bandmap_window_owner_mutex { "BANDMAP WINDOW OWNER"s };    ///< mutex for bandmap_window_owner
+map<const window*, const bandmap*> bandmap_window_owner;                                      ///< the bandmap that most recently wrote to each window
 vector<bandmap_filter_type> BMF_vec;                ///< the global bandmap filter
 
 /*! \brief          Printable version of the name of a bandmap_entry source
@@ -91,6 +125,68 @@ string to_string(const BANDMAP_ENTRY_SOURCE bes)
     \brief  A database for the number of posters of stations
 */
 
+/*! \brief          Intern a string
+    \param  str     string to intern
+    \param  ids     map from interned strings to their ids
+    \param  strs    interned strings, indexed by id
+    \return         id of <i>str</i>
+*/
+uint32_t n_posters_database::_intern(const string& str, UNORDERED_STRING_MAP<uint32_t>& ids, vector<string>& strs)
+{ if (const auto it { ids.find(str) }; it != ids.end())
+    return it -> second;
+
+  const uint32_t rv { static_cast<uint32_t>(strs.size()) };
+
+  ids.emplace(str, rv);
+  strs += str;
+
+  return rv;
+}
+
+/*! \brief          Test whether a call appears enough times to be considered "good", and mark it as known good if so
+    \param  id      id of the call to test
+    \param  now_m   current time in minutes
+    \return         whether the call with id <i>id</i> is a known good call
+
+    Walks the buckets in the window; no strings are involved
+*/
+bool n_posters_database::_test_call_id(const uint32_t id, const time_t now_m)
+{ if ( (id < _known_good_calls.size()) and _known_good_calls[id] )
+    return true;
+
+  size_t count_n_posters { 0 };
+
+  for (const minute_bucket& mb : _ring)
+  { if (_is_current(mb, now_m))
+    { if (const auto it { mb.posters.find(id) }; it != mb.posters.end())
+      { count_n_posters += it -> second.size();
+
+        if (count_n_posters >= static_cast<size_t>(_min_posters))
+        { if (id >= _known_good_calls.size())
+            _known_good_calls.resize(_calls.size(), false);
+
+          _known_good_calls[id] = true;
+
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+/*! \brief          Rebuild the record of known good calls from the buckets in the window
+    \param  now_m   current time in minutes
+*/
+void n_posters_database::_rebuild_known_good_calls(const time_t now_m)
+{ _known_good_calls.assign(_calls.size(), false);
+
+  for (const minute_bucket& mb : _ring)
+    if (_is_current(mb, now_m))
+      FOR_ALL(mb.posters, [now_m, this] (const auto& pr) { _test_call_id(pr.first, now_m); });
+}
+
 /*! \brief      Add a call and poster to the database
     \param  pr  call and poster to be added
 */
@@ -102,56 +198,64 @@ void n_posters_database::operator+=(const pair<string /* call */, string /* post
   lock_guard<recursive_mutex> lg(_mtx);
 
   if (_min_posters > 1)
-  { _data[now_m][call] += poster;
+  { const uint32_t call_id   { _intern(call, _call_ids, _calls) };
+    const uint32_t poster_id { _intern(poster, _poster_ids, _posters) };
+
+    minute_bucket& mb { _ring[static_cast<size_t>(now_m) % _ring.size()] };
+
+    if (mb.minute != now_m)                 // the bucket holds an old minute (or nothing); reuse it
+    { const bool discarding_data { !mb.posters.empty() };
+
+      mb.minute = now_m;
+      mb.posters.clear();
+
+      if (discarding_data)                  // prune() hasn't yet run for this minute
+        _rebuild_known_good_calls(now_m);
+    }
+
+    vector<uint32_t>& poster_ids { mb.posters[call_id] };
 
-    test_call(call);
+    if (const auto it { SR::lower_bound(poster_ids, poster_id) }; (it == poster_ids.end()) or (*it != poster_id))
+      poster_ids.insert(it, poster_id);
+
+    _test_call_id(call_id, now_m);
   }
 }
 
 /*! \brief      Get all the times in the database
-    \return     all the times in <i>_data</i>
+    \return     all the times for which the database holds data
 */
 set<time_t> n_posters_database::times(void) const
-{ lock_guard<recursive_mutex> lg(_mtx); 
+{ set<time_t> rv;
 
-  return ALL_KEYS_SET(_data);
+  lock_guard<recursive_mutex> lg(_mtx); 
+
+  for (const minute_bucket& mb : _ring)
+    if (mb.minute != -1)
+      rv += mb.minute;
+
+  return rv;
 }
 
-/*! \brief          Test whether a call appears enough times to be considered "good", and add to <i>_known_good_calls</i> if so
+/*! \brief          Test whether a call appears enough times to be considered "good", and mark it as known good if so
     \param  call    call to test
     \return         whether <i>call</i> is a known good call
 */
 bool n_posters_database::test_call(const string_view call)
 { lock_guard<recursive_mutex> lg(_mtx); 
 
-  if ( (_min_posters == 1) or _known_good_calls.contains(call) )
+  if (_min_posters == 1)
     return true;
 
-  const set<time_t> all_times { times() };
+  const auto it { _call_ids.find(call) };
 
-  bool known_good      { false };
-  int  count_n_posters { 0 };
-
-  for (auto it { all_times.cbegin() }; !known_good and (it != all_times.end()); ++it)
-  { const UNORDERED_STRING_MAP<UNORDERED_STRING_SET>& um { _data.at(*it) };    // key = call
-
-    if (um.contains(call))
-    { const string call_str { call };
-
-      count_n_posters += um.at(call_str).size();
-
-      if (count_n_posters >= _min_posters)
-      { _known_good_calls += call_str;
-        
-        return true;
-      }
-    }
-  }
-
-  return false;
+  return ( (it != _call_ids.end()) and _test_call_id(it -> second, now_minutes) );
 }
 
-/// Prune the database
+/*! \brief  Prune the database
+
+    Resets the buckets that have fallen out of the window
+*/
 void n_posters_database::prune(void)
 { const time_t now_m { now_minutes };
 
@@ -160,29 +264,18 @@ void n_posters_database::prune(void)
   if (_min_posters == 1)
     return;
 
-  const time_t target_time { now_m - _width };
-
-  set<time_t> all_times { times() };
-
   bool need_to_clear_known_good_calls { false };
 
-  for (const auto t : all_times)
-  { if (t < target_time)
-    { _data -= t;
+  for (minute_bucket& mb : _ring)
+  { if ( (mb.minute != -1) and !_is_current(mb, now_m) )
+    { mb.minute = -1;
+      mb.posters.clear();
       need_to_clear_known_good_calls = true;        // have to rebuild _known_good_calls if we've removed a minute
     }
   }
 
   if (need_to_clear_known_good_calls)
-  { all_times = move(times());
-    _known_good_calls.clear();
-
-// rebuild _known_good_calls
-    UNORDERED_STRING_SET all_calls { };
-
-    FOR_ALL(all_times, [&all_calls, this] (const time_t t)     { all_calls += move(ALL_KEYS_USET(_data.at(t))); });
-    FOR_ALL(all_calls, [this]             (const string& call) { test_call(call); });
-  }
+    _rebuild_known_good_calls(now_m);
 }
 
 /// Convert to printable string
@@ -191,31 +284,40 @@ string n_posters_database::to_string(void) const
 
   lock_guard<recursive_mutex> lg(_mtx);
 
-  for (const auto& [t, cp] : _data)
+  map<time_t, const minute_bucket*> ordered_buckets;
+
+  for (const minute_bucket& mb : _ring)
+    if (mb.minute != -1)
+      ordered_buckets.emplace(mb.minute, &mb);
+
+  for (const auto& [t, mbp] : ordered_buckets)
   { rv += ::to_string(t) + COLON + EOL;
 
-    for (const auto& [c, p] : cp)
-    { rv += "  "s + ::to_string(c) + "  :"s + EOL;
+    for (const auto& [call_id, poster_ids] : mbp -> posters)
+    { rv += "  "s + _calls[call_id] + "  :"s + EOL;
 
-      for (const auto& poster : p)
-        rv += "    "s + poster + SPACE;
+      for (const auto poster_id : poster_ids)
+        rv += "    "s + _posters[poster_id] + SPACE;
       
       rv += EOL;
-      rv += "n_posters = "s + ::to_string(p.size()) + EOL;
+      rv += "n_posters = "s + ::to_string(poster_ids.size()) + EOL;
     }
   }
 
   rv += EOL;
 
-  if (_known_good_calls.empty())
+  CALL_SET ordered_known_good_calls;
+
+  for (uint32_t id { 0 }; id < _known_good_calls.size(); ++id)
+    if (_known_good_calls[id])
+      ordered_known_good_calls += _calls[id];
+
+  if (ordered_known_good_calls.empty())
     rv += "No known good calls"s + EOL;
   else
   { rv += "Known good calls: "s;
 
-    CALL_SET ordered_known_good_calls;
-
-    FOR_ALL(_known_good_calls,        [&ordered_known_good_calls] (const string& call) { ordered_known_good_calls += call; } );
-    FOR_ALL(ordered_known_good_calls, [&rv]                       (const string& call) { rv += (call + SPACE); } );
+    FOR_ALL(ordered_known_good_calls, [&rv] (const string& call) { rv += (call + SPACE); } );
 
     rv += EOL + "Number of known good calls = "s + ::to_string(ordered_known_good_calls.size()) + EOL;
   }
@@ -225,6 +327,66 @@ string n_posters_database::to_string(void) const
   return rv;
 }
 
+// -----------  mult_status_cache  ----------------
+
+/*! \class  mult_status_cache
+    \brief  A cache of the mult status of calls on particular bands and modes
+*/
+
+/*! \brief          Look up the mult status of a call on a band and mode
+    \param  call    call to look up
+    \param  b       band
+    \param  m       mode
+    \param  gen     current generation
+    \return         the cached status, if any
+
+    Discards the cache if <i>gen</i> differs from the generation of the cache
+*/
+optional<mult_status_cache::mult_status> mult_status_cache::lookup(const string_view call, const BAND b, const MODE m, const generation_type& gen)
+{ lock_guard<mutex> lg(_mtx);
+
+  if (gen != _generation)
+  { _cache.clear();
+    _n_entries = 0;
+    _generation = gen;
+  }
+
+  if (const auto it { _cache.find(call) }; it != _cache.end())
+  { if (const auto it2 { it -> second.find( { b, m } ) }; it2 != it -> second.end())
+    { _n_hits++;
+      return it2 -> second;
+    }
+  }
+
+  _n_misses++;
+
+  return nullopt;
+}
+
+/*! \brief          Add the mult status of a call on a band and mode
+    \param  call    call
+    \param  b       band
+    \param  m       mode
+    \param  gen     generation that was current when the status was calculated
+    \param  ms      the mult status of <i>call</i> on band <i>b</i> and mode <i>m</i>
+
+    Does nothing if <i>gen</i> is not the generation of the cache
+*/
+void mult_status_cache::insert(const string& call, const BAND b, const MODE m, const generation_type& gen, const mult_status& ms)
+{ lock_guard<mutex> lg(_mtx);
+
+  if (gen != _generation)             // the statistics have changed while the status was being calculated
+    return;
+
+  if (_n_entries >= _max_size)         // keep the size bounded
+  { _cache.clear();
+    _n_entries = 0;
+  }
+
+  if (_cache[call].insert_or_assign( { b, m }, ms).second)
+    _n_entries++;
+}
+
 // -----------   bandmap_filter_type ----------------
 
 /*! \class  bandmap_filter_type
@@ -247,36 +409,76 @@ void bandmap_filter_type::add_or_subtract(const string_view str)
     g_ref += str_copy;
 }
 
+// -----------  interned_string  ----------------
+
+/*! \class  interned_string
+    \brief  A compact reference to an immutable string held in a global pool
+*/
+
+pt_mutex             interned_strings_mutex { "INTERNED STRINGS"s };    ///< mutex for interned_strings
+UNORDERED_STRING_SET interned_strings;                                  ///< the pool of interned strings; the elements of an unordered_set do not move
+
+/*! \brief          Obtain the copy of a string in the pool, adding it if necessary
+    \param  str     string to look up
+    \return         pointer to the copy of <i>str</i> in the pool; nullptr if <i>str</i> is empty
+*/
+const string* interned_string::_intern(const string_view str)
+{ if (str.empty())
+    return nullptr;
+
+  SAFELOCK(interned_strings);
+
+  if (const auto it { interned_strings.find(str) }; it != interned_strings.end())
+    return &(*it);
+
+  return &(*(interned_strings.emplace(str).first));
+}
+
+/// number of strings in the pool
+size_t interned_string::pool_size(void)
+{ SAFELOCK(interned_strings);
+
+  return interned_strings.size();
+}
+
 // -----------  bandmap_entry  ----------------
 
 /*! \brief          Set the callsign
     \param  call    the callsign to set
 */
 bandmap_entry& bandmap_entry::callsign(const string_view call)
-{ _callsign = call;
+{ _callsign = interned_string { call };
 
   if (!is_marker())
-  { const location_info li { location_db.info(_callsign)};
+  { const location_info li { location_db.info(callsign())};
 
-    _canonical_prefix = li.canonical_prefix();
-    _continent = li.continent();
+    _canonical_prefix = interned_string { li.canonical_prefix() };
+    _continent = interned_string { li.continent() };
   }
 
   return *this;
 }
 
-/*! \brief      Set <i>_freq</i>, <i>_frequency_str</i>, <i>_band</i> and <i>_mode</i>
+/*! \brief      Set <i>_freq</i>, <i>_band</i> and <i>_mode</i>
     \param  f   frequency used to set the values
 */
 bandmap_entry& bandmap_entry::freq(const frequency f)
 { _freq = f;
-  _frequency_str = _freq.display_string();
   _band = to_BAND(f);
   _mode = putative_mode();
 
   return *this;
 }
 
+/*! \brief      Approximate number of bytes used by this entry
+    \return     the size of the object plus the heap memory that it alone owns
+
+    Interned strings are shared, and are not included
+*/
+size_t bandmap_entry::memory_usage(void) const
+{ return sizeof(*this) + _is_needed_callsign_mult.heap_size() + _is_needed_country_mult.heap_size() + _is_needed_exchange_mult.heap_size();
+}
+
 /*! \brief              Calculate the mult status of this entry
     \param  rules       the rules for this contest
     \param  statistics  the current statistics
@@ -285,12 +487,22 @@ bandmap_entry& bandmap_entry::freq(const frequency f)
     Note that the parameters are NOT constant
 */
 void bandmap_entry::calculate_mult_status(contest_rules& rules, running_statistics& statistics)
-{
+{ const mult_status_cache::generation_type gen { statistics.generation(), exchange_db.generation() };    // obtain before calculating, so that a change during the calculation is not cached
+
+  if (const optional<mult_status_cache::mult_status> opt { mult_cache.lookup(callsign(), _band, _mode, gen) }; opt)
+  { _is_needed_callsign_mult = opt -> callsign_mult;
+    _is_needed_country_mult = opt -> country_mult;
+    _is_needed_exchange_mult = opt -> exchange_mult;
+    _mult_status_is_known = opt -> mult_status_is_known;
+
+    return;
+  }
+
 // callsign mult
   clear_callsign_mult();
 
   for ( string_view callsign_mult_name : rules.callsign_mults() )
-  { if (const string callsign_mult_val { callsign_mult_value(callsign_mult_name, _callsign) }; !callsign_mult_val.empty())
+  { if (const string callsign_mult_val { callsign_mult_value(callsign_mult_name, callsign()) }; !callsign_mult_val.empty())
     { if (statistics.is_needed_callsign_mult(callsign_mult_name, callsign_mult_val, _band, _mode))
         add_callsign_mult(callsign_mult_name, callsign_mult_val);
     }
@@ -302,8 +514,8 @@ void bandmap_entry::calculate_mult_status(contest_rules& rules, running_statisti
   if (rules.n_country_mults())        // if country mults are used
   { clear_country_mult();
 
-    if (statistics.is_needed_country_mult(_callsign, _band, _mode, rules))
-      add_country_mult(_canonical_prefix);
+    if (statistics.is_needed_country_mult(callsign(), _band, _mode, rules))
+      add_country_mult(canonical_prefix());
 
     _is_needed_country_mult.status_is_known(true);
   }
@@ -320,13 +532,13 @@ void bandmap_entry::calculate_mult_status(contest_rules& rules, running_statisti
   bool exchange_mult_is_possible { false };
 
   for (const auto& exch_mult_name : exch_mults)
-  { const vector<string> exchange_field_names       { rules.expanded_exchange_field_names(_canonical_prefix, _mode) };
+  { const vector<string> exchange_field_names       { rules.expanded_exchange_field_names(canonical_prefix(), _mode) };
     const bool           is_possible_exchange_field { contains(exchange_field_names, exch_mult_name) };
 
     if (is_possible_exchange_field)
     { exchange_mult_is_possible = true;
 
-      if (const string guess { rules.canonical_value(exch_mult_name, exchange_db.guess_value(_callsign, exch_mult_name)) }; !guess.empty())
+      if (const string guess { rules.canonical_value(exch_mult_name, exchange_db.guess_value(callsign(), exch_mult_name)) }; !guess.empty())
       { if ( statistics.is_needed_exchange_mult(exch_mult_name, guess, _band, _mode) )
           add_exchange_mult(exch_mult_name, guess);
 
@@ -351,6 +563,8 @@ void bandmap_entry::calculate_mult_status(contest_rules& rules, running_statisti
 
   if (!_mult_status_is_known and rules.exchange_mults_used() and _is_needed_exchange_mult.is_status_known())
     _mult_status_is_known = true;
+
+  mult_cache.insert(callsign(), _band, _mode, gen, { _is_needed_callsign_mult, _is_needed_country_mult, _is_needed_exchange_mult, _mult_status_is_known });
 }
 
 /*! \brief      Does this object match another bandmap_entry?
@@ -363,7 +577,7 @@ bool bandmap_entry::matches_bandmap_entry(const bandmap_entry& be) const
 { if ((be.is_my_marker()) or is_my_marker())       // mustn't delete a valid call if we're updating my QRG
     return (_callsign == be._callsign);
 
-  return ( (_callsign == be._callsign) or (_frequency_str == be._frequency_str) );  // neither bandmap_entry is at my QRG
+  return ( (_callsign == be._callsign) or same_frequency_str(be) );  // neither bandmap_entry is at my QRG
 }
 
 /*! \brief              Re-mark the need/mult status
@@ -380,9 +594,9 @@ bool bandmap_entry::remark(contest_rules& rules, const call_history& q_history,
 
 // if this contest allows only one QSO with a station (e.g., SS)
   if (!rules.work_if_different_band())
-    _is_needed = NONE_OF(rules.permitted_bands(), [this, &q_history] (const BAND b) { return q_history.worked(_callsign, b); } );
+    _is_needed = NONE_OF(rules.permitted_bands(), [this, &q_history] (const BAND b) { return q_history.worked(callsign(), b); } );
   else
-    _is_needed = !q_history.worked(_callsign, _band);
+    _is_needed = !q_history.worked(callsign(), _band);
 
 // multi-mode contests
   const bool original_is_needed_callsign_mult { is_needed_callsign_mult() };
@@ -426,17 +640,17 @@ bool bandmap_entry::matches_criteria(void) const
 
   { SAFELOCK(batch_messages);
 
-    if (batch_messages.contains(_callsign))
+    if (batch_messages.contains(callsign()))
       return false;             // skip any call with a batch message
   }
 
   if (is_all_time_first())
     return true;
 
-  if (olog.confirmed(_callsign, _band, _mode))
+  if (olog.confirmed(callsign(), _band, _mode))
     return true;
 
-  if (olog.n_qsls(_callsign) and (olog.n_qsos(_callsign, _band, _mode) <= max_qsos_without_qsl))
+  if (olog.n_qsls(callsign()) and (olog.n_qsos(callsign(), _band, _mode) <= max_qsos_without_qsl))
     return true;
 
   return false;
@@ -469,223 +683,1294 @@ ostream& operator<<(ostream& ost, const bandmap_entry& be)
   return ost;
 }
 
-// -----------  bandmap  ----------------
+// -----------  bandmap_entry_store  ----------------
 
-/*! \class  bandmap
-    \brief  A bandmap
+/*! \class  bandmap_entry_store
+    \brief  Storage for the entries in a bandmap
 */
 
-/*!  \brief                             Return the callsign closest to a particular frequency, if it is within the guard band
-     \param bme                         band map entries
-     \param target_frequency_in_khz     the target frequency, in kHz
-     \param guard_band_in_hz            how far from the target to search, in Hz
-     \return                            Callsign of a station within the guard band
+/*! \brief      Rebuild the index for all positions from a particular position onwards
+    \param  n   first position to re-index
+*/
+void bandmap_entry_store::_reindex(const size_t n)
+{ for (size_t posn { n }; posn < _entries.size(); ++posn)
+    _index[_entries[posn].callsign()] = posn;
+}
 
-     Returns the nearest station within the guard band, or the null string if no call is found.
-     As currently implemented, assumes that the entries are in order of monotonically increasing or decreasing frequency
+/*! \brief              Find the entry for a particular call
+    \param  callsign    call to find
+    \return             iterator to the entry for <i>callsign</i>; <i>end()</i> if <i>callsign</i> is not present
+*/
+bandmap_entry_store::const_iterator bandmap_entry_store::find(const string_view callsign) const
+{ const auto cit { _index.find(callsign) };
 
-     UNTESTED
+  return ( (cit == _index.cend()) ? _entries.cend() : (_entries.cbegin() + cit -> second) );
+}
+
+/*! \brief              Find the entry for a particular call
+    \param  callsign    call to find
+    \return             iterator to the entry for <i>callsign</i>; <i>end()</i> if <i>callsign</i> is not present
+
+    The callsign and frequency of the entry MUST NOT be changed through the returned iterator
 */
-string bandmap::_nearest_callsign(const BM_ENTRIES& bme, const frequency target_frequency, const frequency guard_band) const
-{ if ( !target_frequency.is_within_ham_band() )
-  { ost << "WARNING: bandmap::_nearest_callsign called with frequency = " << target_frequency << endl;
-    return string { };
-  }
+bandmap_entry_store::iterator bandmap_entry_store::find(const string_view callsign)
+{ const auto cit { _index.find(callsign) };
 
-  bool      finish_looking      { false };
-  frequency smallest_difference { 1_MHz };              // start with a big number
+  return ( (cit == _index.cend()) ? _entries.end() : (_entries.begin() + cit -> second) );
+}
 
-  string rv { };
+/*! \brief      Find the first entry whose frequency is not less than a particular frequency
+    \param  f   target frequency
+    \return     iterator to the first entry whose frequency is >= <i>f</i>
+*/
+bandmap_entry_store::const_iterator bandmap_entry_store::lower_bound(const frequency f) const
+  { return std::lower_bound(_entries.cbegin(), _entries.cend(), f, [] (const bandmap_entry& be, const frequency target) { return (be.freq() < target); }); }
 
-  for (BM_ENTRIES::const_iterator cit { bme.cbegin() }; ( !finish_looking and (cit != bme.cend()) ); ++cit)
-  { const frequency Δf { target_frequency.difference(cit -> freq()) };
+/*! \brief      Find the first entry whose frequency is greater than a particular frequency
+    \param  f   target frequency
+    \return     iterator to the first entry whose frequency is > <i>f</i>
+*/
+bandmap_entry_store::const_iterator bandmap_entry_store::upper_bound(const frequency f) const
+  { return std::upper_bound(_entries.cbegin(), _entries.cend(), f, [] (const frequency target, const bandmap_entry& be) { return (target < be.freq()); }); }
 
-    if ( (Δf <= guard_band) and (!(cit -> is_marker())) )
-    { if (Δf < smallest_difference)
-      { smallest_difference = Δf;
-        rv = cit -> callsign();
-      }
+/*! \brief      Insert an entry
+    \param  be  entry to insert
+
+    Any existing entry with the same callsign as <i>be</i> is replaced. <i>be</i> is placed after any
+    existing entries with the same frequency.
+*/
+void bandmap_entry_store::insert(const bandmap_entry& be)
+{ if (const auto it { find(be.callsign()) }; it != _entries.end())
+  { if (it -> freq() == be.freq())                   // replace in place
+    { *it = be;
+      return;
     }
 
-    if ( (cit -> freq() > target_frequency) and (Δf > guard_band) )  // no need to keep looking we if are past the allowed guard band
-      finish_looking = true;
+    erase(be.callsign());
   }
 
-  return rv;
-}
+  const size_t posn { static_cast<size_t>(upper_bound(be.freq()) - _entries.cbegin()) };
 
-/*!  \brief     Insert a bandmap_entry
-     \param be  entry to add
+  _entries.insert(_entries.begin() + posn, be);
+  _reindex(posn);
+}
 
-    If <i>be</i> is my marker, the frequency is slightly decreased so that it will always appear below any
-    other entries at the same QRG
+/*! \brief              Remove the entry for a particular call
+    \param  callsign    call to remove
+    \return             whether an entry was removed
 */
-void bandmap::_insert(const bandmap_entry& be)
-{ static bandmap_entry my_marker_copy;          // needed if be is my marker
- 
-  if (be.is_my_marker())
-  { my_marker_copy = be;
-    my_marker_copy.freq(my_marker_copy.freq() - MY_MARKER_BIAS);     // make it 1Hz less than actual value
-  }
-
-  const bandmap_entry& ber { be.is_my_marker() ? my_marker_copy : be };   // point to the right bandmap_entry object
-  
-  bool inserted { false };
+bool bandmap_entry_store::erase(const string_view callsign)
+{ const auto it { _index.find(callsign) };
 
-  SAFELOCK(_bandmap);
+  if (it == _index.end())
+    return false;
 
-// insert it in the right place in the list
-  for (BM_ENTRIES::iterator it { _entries.begin() }; (!inserted and (it != _entries.end())); ++it)
-  { if (it -> freq() > ber.freq())
-      inserted = ( _entries += { it, ber }, true );
-  }
+  const size_t posn { it -> second };
 
-  if (!inserted)
-    _entries += (ber);    // this frequency is higher than any currently in the bandmap
+  _index.erase(it);
+  _entries.erase(_entries.begin() + posn);
+  _reindex(posn);
 
-  _version++;
+  return true;
 }
 
-// a call will be marked as recent if:
-// its source is LOCAL or CLUSTER
-// or
-// its source is RBN and the call is already present in the bandmap
-// at the same QRG with this poster
-// ASCII art created with asciio
-/*
-                  .-----.
-                  | RBN |
-                  '-----'
-                     |
-                     |
-                     v
-             .----------------.             .-----------.
-             |                |             |           |
-             |  Call present? |      NO     |   POST    |
-             |                |------------>|           |
-             |                |             |           |
-             '----------------'             '-----------'
-                      | YES
-                      v
-                .-----------.               .-----------.          .-----------.
-                |           |               |           |          |           |
-                |QRG approx |        NO     |Delete old |          |    POST   |
-                |  same?    ---------------->   post    |--------->|           |
-                |           |               |           |          |           |
-                '-----------'               '-----------'          '-----------'
-                      | YES
-                      v
-                .---------------------.     .---------------.
-                | New expiration      |     | Add poster    |
-                | later than          |  NO | to posters    |
-                | current expiration? |---->|               |
-                |                     |     |               |
-                '---------------------'     '---------------'
-                        |
-                        | YES
-                        v
-                .--------------.
-                | Mark current |
-                |   as RBN     |
-                |              |
-                |              |
-                '--------------'
-                       |
-                       |
-                       v
-                .------------.
-                | Add poster |
-                | to posters |
-                |            |
-                |            |
-                '------------'
-                      |
-                      v
-                .---------------.
-                | POST with new |
-                | expiration    |
-                |               |
-                |               |
-                '---------------'
- */
-/*!  \brief     Mark a bandmap_entry as recent
-     \param be  entry to mark
+// -----------  expiry_wheel  ----------------
 
-    an entry will be marked as recent if:
-        its source is LOCAL or CLUSTER
-    or
-        its source is RBN and the call is already present in the bandmap at the same QRG with the poster of <i>be</i>
+/*! \class  expiry_wheel
+    \brief  A hashed timing wheel of callsigns, keyed by the time at which they expire
 */
-bool bandmap::_mark_as_recent(const bandmap_entry& be)
-{ if (_rbn_threshold == 1)
-    return true;
 
-  if ( (be.source() == BANDMAP_ENTRY_SOURCE::LOCAL) or (be.source() == BANDMAP_ENTRY_SOURCE::CLUSTER) )
-    return true;
+/*! \brief      Set the number of slots
+    \param  n   number of slots (i.e., seconds in one revolution)
 
-  if (be.is_marker())           // don't mark markers as recent, if somehow we got here with a marker as parameter (which should nevre happen)
-    return false;
+    Any items already in the wheel are rescheduled
+*/
+void expiry_wheel::n_slots(const size_t n)
+{ vector<vector<item>> old_slots { move(_slots) };
 
-  SAFELOCK(_bandmap);
+  _slots = vector<vector<item>>(max(n, static_cast<size_t>(1)));
 
-  const bandmap_entry& old_be { (*this)[be.callsign()] };
+  for (vector<item>& slot : old_slots)
+    for (item& it : slot)
+      _slots[static_cast<size_t>(it.fire_time) % _slots.size()] += move(it);
+}
 
-  if (!old_be.valid())    // not already present
-    return false;
+/*! \brief                      Schedule a callsign to expire
+    \param  callsign            callsign to schedule
+    \param  expiration_time     time (in seconds since the epoch) after which <i>callsign</i> expires
 
-  if (be.frequency_difference(old_be) > MAX_FREQUENCY_SKEW)       // treat anything within 250 Hz as the same frequency
-    return false;         // we're going to write a new entry
+    A callsign may be scheduled more than once; the caller is responsible for checking whether the
+    callsign has really expired when it is returned by expire()
+*/
+void expiry_wheel::add(const string_view callsign, const time_t expiration_time)
+{ constexpr size_t DEFAULT_N_SLOTS { 3600 };          // one hour
 
-  return false;    // should never get here
-}
+  if (_slots.empty())
+    n_slots(DEFAULT_N_SLOTS);
 
-/*!  \brief     Add a bandmap_entry
-     \param be  entry to add
+  if (_last_processed == 0)
+    _last_processed = NOW() - 1;
 
-     <i>_time_of_earlier_bandmap_entry</i> in <i>be</i> might be changed.
-     Could change this by copying the be inside +=.
+  const time_t fire_time { max(expiration_time + 1, _last_processed + 1) };     // an entry is pruned only when its expiration time is in the past
+
+  _slots[static_cast<size_t>(fire_time) % _slots.size()] += item { string { callsign }, fire_time };
+}
+
+/*! \brief          Remove and return all the callsigns that have expired
+    \param  now     current time (in seconds since the epoch)
+    \return         the callsigns whose expiration time is earlier than <i>now</i>
+*/
+vector<string> expiry_wheel::expire(const time_t now)
+{ vector<string> rv;
+
+  if (_slots.empty())
+  { _last_processed = now;
+    return rv;
+  }
+
+  const time_t n_slots { static_cast<time_t>(_slots.size()) };
+  const time_t first   { (_last_processed == 0) ? now : max(_last_processed + 1, now - n_slots + 1) };   // never process a slot more than once
+
+  for (time_t t { first }; t <= now; ++t)
+  { vector<item>& slot { _slots[static_cast<size_t>(t) % _slots.size()] };
+
+    for (const item& it : slot)
+      if (it.fire_time <= now)
+        rv += it.callsign;
+
+    erase_if(slot, [now] (const item& it) { return (it.fire_time <= now); });       // items for later revolutions remain
+  }
+
+  _last_processed = max(_last_processed, now);
+
+  return rv;
+}
+
+/// remove all the items
+void expiry_wheel::clear(void)
+{ FOR_ALL(_slots, [] (vector<item>& slot) { slot.clear(); });
+
+  _last_processed = 0;
+}
+
+// -----------  callsign_matcher  ----------------
+
+/*! \class  callsign_matcher
+    \brief  Matches a call against a set of exact calls and regexes
+*/
+
+using CHAR_SET = bitset<256>;                   ///< a set of bytes
+
+constexpr size_t MAX_REGEX_REPEAT { 64 };       ///< maximum count in a {m,n} quantifier that will be compiled into the DFA
+constexpr size_t MAX_NFA_STATES   { 20'000 };   ///< maximum number of NFA states for the compiled regexes
+constexpr size_t MAX_DFA_STATES   { 10'000 };   ///< maximum number of DFA states for the compiled regexes
+
+/// the lowest-valued character in a non-empty set
+inline unsigned char first_char(const CHAR_SET& cs)
+{ size_t rv { 0 };
+
+  while (!cs.test(rv))
+    rv++;
+
+  return static_cast<unsigned char>(rv);
+}
+
+/// a node in the parse tree of a regex
+struct regex_node
+{ enum class KIND { CHARS,                      ///< one character from a set
+                    SEQUENCE,                   ///< concatenation of the children
+                    ALTERNATIVES,               ///< any one of the children
+                    REPEAT                      ///< repeated child
+                  };
+
+  KIND               kind     { KIND::SEQUENCE };   ///< type of node
+  CHAR_SET           chars    { };                  ///< the characters matched by a CHARS node
+  vector<regex_node> children { };                  ///< children of a SEQUENCE, ALTERNATIVES or REPEAT node
+  size_t             min_n    { 0 };                ///< minimum count for a REPEAT node
+  optional<size_t>   max_n    { };                  ///< maximum count for a REPEAT node; no value => unbounded
+};
+
+/*! \class  regex_parser
+    \brief  Parse the subset of ECMAScript regex syntax that can be represented by a DFA
+
+    Anything outside the subset causes the parse to fail, in which case the regex has to be tested with std::regex
+*/
+
+class regex_parser
+{
+protected:
+
+  string_view _str;            ///< the regex being parsed
+  size_t      _posn  { 0 };    ///< current position in <i>_str</i>
+  bool        _ok    { true }; ///< whether the parse is still valid
+
+/// is there more to parse?
+  inline bool _more(void) const
+    { return (_posn < _str.size()); }
+
+/// the next character, without consuming it
+  inline char _peek(void) const
+    { return _str[_posn]; }
+
+/// mark the parse as having failed; always returns an empty node
+  inline regex_node _fail(void)
+  { _ok = false;
+    return regex_node { };
+  }
+
+/*! \brief      Parse an escape sequence into a set of characters
+    \param  cs  set to receive the characters
+    \return     whether the escape sequence could be parsed
+
+    The leading backslash has already been consumed
+*/
+  bool _escape(CHAR_SET& cs)
+  { if (!_more())
+      return false;
+
+    const char c { _str[_posn++] };
+
+    auto add_range { [&cs] (const char c1, const char c2) { for (int n { c1 }; n <= c2; ++n) cs.set(static_cast<unsigned char>(n)); } };
+
+    switch (c)
+    { case 'd' :
+      case 'D' :
+        add_range('0', '9');
+        break;
+
+      case 'w' :
+      case 'W' :
+        add_range('0', '9');
+        add_range('A', 'Z');
+        add_range('a', 'z');
+        cs.set('_');
+        break;
+
+      case 's' :
+      case 'S' :
+        for (const char ws : " \t\n\v\f\r"sv)
+          cs.set(static_cast<unsigned char>(ws));
+        break;
+
+      case 'n' :
+        cs.set('\n');
+        return true;
+
+      case 'r' :
+        cs.set('\r');
+        return true;
+
+      case 't' :
+        cs.set('\t');
+        return true;
+
+      case 'f' :
+        cs.set('\f');
+        return true;
+
+      case 'v' :
+        cs.set('\v');
+        return true;
+
+      default :
+        if (isalnum(static_cast<unsigned char>(c)))                 // back-references, \b, \x, \u, etc.
+          return false;
+
+        cs.set(static_cast<unsigned char>(c));                      // escaped punctuation
+        return true;
+    }
+
+    if (isupper(static_cast<unsigned char>(c)))                     // \D, \W, \S
+      cs.flip();
+
+    return true;
+  }
+
+/// parse a bracket expression; the opening bracket has already been consumed
+  regex_node _bracket(void)
+  { regex_node rv { regex_node::KIND::CHARS };
+
+    const bool negated { _more() and (_peek() == '^') };
+
+    if (negated)
+      _posn++;
+
+    if (_more() and (_peek() == ']'))                   // empty class; treat as unsupported
+      return _fail();
+
+    int last_single { -1 };                             // previous single character, for ranges; -1 => none
+
+    while (_more() and (_peek() != ']'))
+    { const char c { _str[_posn++] };
+
+      if (c == '[')                                     // [:alpha:] and friends
+        return _fail();
+
+      if ( (c == '-') and (last_single != -1) and _more() and (_peek() != ']') )    // a range
+      { unsigned char c2 { static_cast<unsigned char>(_str[_posn++]) };
+
+        if (c2 == '\\')
+        { CHAR_SET esc;
+
+          if (!_escape(esc) or (esc.count() != 1))
+            return _fail();
+
+          c2 = first_char(esc);
+        }
+        else if (c2 == '[')
+          return _fail();
+
+        if (c2 < last_single)
+          return _fail();
+
+        for (int n { last_single }; n <= c2; ++n)
+          rv.chars.set(static_cast<unsigned char>(n));
+
+        last_single = -1;
+        continue;
+      }
+
+      if (c == '\\')
+      { CHAR_SET esc;
+
+        if (!_escape(esc))
+          return _fail();
+
+        rv.chars |= esc;
+
+        if (esc.count() == 1)
+          last_single = first_char(esc);
+        else
+          last_single = -1;
+
+        continue;
+      }
+
+      rv.chars.set(static_cast<unsigned char>(c));
+      last_single = static_cast<unsigned char>(c);
+    }
+
+    if (!_more())                                       // no closing bracket
+      return _fail();
+
+    _posn++;                                            // skip the closing bracket
+
+    if (negated)
+      rv.chars.flip();
+
+    return rv;
+  }
+
+/// parse a single atom
+  regex_node _atom(void)
+  { const char c { _str[_posn++] };
+
+    switch (c)
+    { case '(' :
+      { if (_more() and (_peek() == '?'))               // only non-capturing groups are supported
+        { if ( (_posn + 1 < _str.size()) and (_str[_posn + 1] == ':') )
+            _posn += 2;
+          else
+            return _fail();
+        }
+
+        regex_node rv { _alternatives() };
+
+        if (!_more() or (_peek() != ')'))
+          return _fail();
+
+        _posn++;
+        return rv;
+      }
+
+      case '[' :
+        return _bracket();
+
+      case '.' :                                        // anything except a line terminator
+      { regex_node rv { regex_node::KIND::CHARS };
+
+        rv.chars.set();
+        rv.chars.reset('\n');
+        rv.chars.reset('\r');
+
+        return rv;
+      }
+
+      case '\\' :
+      { regex_node rv { regex_node::KIND::CHARS };
+
+        if (!_escape(rv.chars))
+          return _fail();
+
+        return rv;
+      }
+
+      case '^' :                                        // assertions and characters that are not legal as literals
+      case '$' :
+      case '*' :
+      case '+' :
+      case '?' :
+      case '{' :
+      case '}' :
+      case ']' :
+      case ')' :
+      case '|' :
+        return _fail();
+
+      default :
+      { regex_node rv { regex_node::KIND::CHARS };
+
+        rv.chars.set(static_cast<unsigned char>(c));
+        return rv;
+      }
+    }
+  }
+
+/*! \brief      Parse the count in a {m,n} quantifier
+    \return     the count, or no value if there is no count at this position
+*/
+  optional<size_t> _count(void)
+  { size_t rv        { 0 };
+    bool   found_one { false };
+
+    while (_more() and isdigit(static_cast<unsigned char>(_peek())))
+    { rv = (rv * 10) + static_cast<size_t>(_str[_posn++] - '0');
+      found_one = true;
+
+      if (rv > MAX_REGEX_REPEAT)
+        return nullopt;
+    }
+
+    return (found_one ? optional<size_t> { rv } : nullopt);
+  }
+
+/// parse a quantifier, if there is one, applying it to <i>node</i>
+  regex_node _quantified(regex_node&& node)
+  { if (!_more())
+      return move(node);
+
+    regex_node rv { regex_node::KIND::REPEAT };
+
+    switch (_peek())
+    { case '*' :
+        rv.min_n = 0;
+        _posn++;
+        break;
+
+      case '+' :
+        rv.min_n = 1;
+        _posn++;
+        break;
+
+      case '?' :
+        rv.min_n = 0;
+        rv.max_n = 1;
+        _posn++;
+        break;
+
+      case '{' :
+      { _posn++;
+
+        const optional<size_t> min_n { _count() };
+
+        if (!min_n)
+          return _fail();
+
+        rv.min_n = min_n.value();
+        rv.max_n = min_n;
+
+        if (_more() and (_peek() == ','))
+        { _posn++;
+          rv.max_n = _count();                          // no value => unbounded
+
+          if (rv.max_n and (rv.max_n.value() < rv.min_n))
+            return _fail();
+
+          if (!rv.max_n and _more() and isdigit(static_cast<unsigned char>(_peek())))      // count was too large
+            return _fail();
+        }
+
+        if (!_more() or (_peek() != '}'))
+          return _fail();
+
+        _posn++;
+        break;
+      }
+
+      default :
+        return move(node);
+    }
+
+    if (_more() and (_peek() == '?'))                   // lazy quantifier; irrelevant for a full match
+      _posn++;
+
+    if (_more() and ((_peek() == '*') or (_peek() == '+') or (_peek() == '?') or (_peek() == '{')))    // stacked quantifiers
+      return _fail();
+
+    rv.children += move(node);
+
+    return rv;
+  }
+
+/// parse a sequence of quantified atoms
+  regex_node _sequence(void)
+  { regex_node rv { regex_node::KIND::SEQUENCE };
+
+    while (_ok and _more() and (_peek() != '|') and (_peek() != ')'))
+      rv.children += _quantified(_atom());
+
+    return rv;
+  }
+
+/// parse a set of alternatives
+  regex_node _alternatives(void)
+  { regex_node rv { regex_node::KIND::ALTERNATIVES };
+
+    rv.children += _sequence();
+
+    while (_ok and _more() and (_peek() == '|'))
+    { _posn++;
+      rv.children += _sequence();
+    }
+
+    return rv;
+  }
+
+public:
+
+/*! \brief          Constructor
+    \param  str     regex to parse
+*/
+  explicit regex_parser(const string_view str) :
+    _str(str)
+  { }
+
+/*! \brief      Parse the regex
+    \return     the parse tree, or no value if the regex uses features that are not supported
+*/
+  optional<regex_node> parse(void)
+  { string_view body { _str };
+
+    if (body.starts_with('^'))                          // assertions at the ends are redundant for a full match
+      body.remove_prefix(1);
+
+    if (body.ends_with('$'))                            // unless the $ is escaped
+    { size_t n_backslashes { 0 };
+
+      while ( (n_backslashes + 2 <= body.size()) and (body[body.size() - 2 - n_backslashes] == '\\') )
+        n_backslashes++;
+
+      if (n_backslashes % 2 == 0)
+        body.remove_suffix(1);
+    }
+
+    _str = body;
+    _posn = 0;
+    _ok = true;
+
+    regex_node rv { _alternatives() };
+
+    if (!_ok or _more())
+      return nullopt;
+
+    return rv;
+  }
+};
+
+/*! \class  nfa_builder
+    \brief  Build a Thompson NFA from regex parse trees
+*/
+
+class nfa_builder
+{
+public:
+
+/// a state in the NFA
+  struct state
+  { vector<int> epsilon  { };     ///< targets of epsilon transitions
+    int         target   { -1 };  ///< target of the character transition, if any
+    int         set_nr   { -1 };  ///< index into <i>sets</i> of the characters that cause the character transition
+  };
+
+  vector<state>    states { };    ///< all the states
+  vector<CHAR_SET> sets   { };    ///< all the distinct character sets that appear in transitions
+
+/// add a new state, returning its index
+  inline int new_state(void)
+  { states += state { };
+    return static_cast<int>(states.size() - 1);
+  }
+
+/*! \brief          Add the NFA for a parse tree
+    \param  node    parse tree
+    \return         the start and end states of the NFA for <i>node</i>
+*/
+  pair<int, int> add(const regex_node& node)
+  { switch (node.kind)
+    { case regex_node::KIND::CHARS :
+      { const int start { new_state() };
+        const int end   { new_state() };
+
+        auto it { FIND_IF(sets, [&node] (const CHAR_SET& cs) { return (cs == node.chars); }) };
+
+        if (it == sets.end())
+        { sets += node.chars;
+          it = prev(sets.end());
+        }
+
+        states[start].target = end;
+        states[start].set_nr = static_cast<int>(distance(sets.begin(), it));
+
+        return { start, end };
+      }
+
+      case regex_node::KIND::SEQUENCE :
+      { const int start { new_state() };
+
+        int current { start };
+
+        for (const regex_node& child : node.children)
+        { const auto [ child_start, child_end ] { add(child) };
+
+          states[current].epsilon += child_start;
+          current = child_end;
+        }
+
+        return { start, current };
+      }
+
+      case regex_node::KIND::ALTERNATIVES :
+      { const int start { new_state() };
+        const int end   { new_state() };
+
+        for (const regex_node& child : node.children)
+        { const auto [ child_start, child_end ] { add(child) };
+
+          states[start].epsilon += child_start;
+          states[child_end].epsilon += end;
+        }
+
+        return { start, end };
+      }
+
+      case regex_node::KIND::REPEAT :
+      { const regex_node& child { node.children.front() };
+        const int         start { new_state() };
+
+        int current { start };
+
+        for (size_t n { 0 }; (n < node.min_n) and (states.size() <= MAX_NFA_STATES); ++n)         // mandatory copies
+        { const auto [ child_start, child_end ] { add(child) };
+
+          states[current].epsilon += child_start;
+          current = child_end;
+        }
+
+        if (!node.max_n)                                                                          // unbounded: loop
+        { const int loop { new_state() };
+          const auto [ child_start, child_end ] { add(child) };
+
+          states[current].epsilon += loop;
+          states[loop].epsilon += child_start;
+          states[child_end].epsilon += loop;
+
+          return { start, loop };
+        }
+
+        const int end { new_state() };
+
+        for (size_t n { node.min_n }; (n < node.max_n.value()) and (states.size() <= MAX_NFA_STATES); ++n)    // optional copies
+        { const auto [ child_start, child_end ] { add(child) };
+
+          states[current].epsilon += end;
+          states[current].epsilon += child_start;
+          current = child_end;
+        }
+
+        states[current].epsilon += end;
+
+        return { start, end };
+      }
+    }
+
+    return { new_state(), new_state() };      // keep the compiler happy
+  }
+};
+
+/*! \brief              Constructor
+    \param  calls       exact calls to match
+    \param  regexes     regexes to match; key = regex string, value = corresponding regex
+*/
+callsign_matcher::callsign_matcher(const UNORDERED_STRING_SET& calls, const STRING_MAP<regex>& regexes) :
+  _calls(calls)
+{ vector<regex_node> patterns;
+
+  for (const auto& [ regex_str, rgx ] : regexes)
+  { if (optional<regex_node> node { regex_parser(regex_str).parse() }; node)
+      patterns += move(node.value());
+    else
+      _fallback_regex += rgx;
+  }
+
+  if (patterns.empty())
+    return;
+
+// build the NFA and the DFA; if the regexes make the automaton too large, test them with std::regex instead
+  auto build { [this] (const vector<regex_node>& pats, const size_t n_nfa_limit, const size_t n_dfa_limit)
+                 { nfa_builder nfa;
+
+                   const int start  { nfa.new_state() };
+                   const int accept { nfa.new_state() };
+
+                   for (const regex_node& pat : pats)
+                   { const auto [ pat_start, pat_end ] { nfa.add(pat) };
+
+                     nfa.states[start].epsilon += pat_start;
+                     nfa.states[pat_end].epsilon += accept;
+
+                     if (nfa.states.size() > n_nfa_limit)
+                       return false;
+                   }
+
+// character classes: bytes that belong to exactly the same sets are equivalent
+                   map<vector<bool>, uint8_t> class_of_signature;
+                   array<uint8_t, 256>        representative { };       // a byte in each class
+
+                   for (size_t b { 0 }; b < 256; ++b)
+                   { vector<bool> signature;
+
+                     signature.reserve(nfa.sets.size());
+
+                     for (const CHAR_SET& cs : nfa.sets)
+                       signature += cs.test(b);
+
+                     const auto [ it, inserted ] { class_of_signature.emplace(move(signature), static_cast<uint8_t>(class_of_signature.size())) };
+
+                     if (inserted)
+                       representative[it -> second] = static_cast<uint8_t>(b);
+
+                     _class_of[b] = it -> second;
+                   }
+
+                   _n_classes = class_of_signature.size();
+
+// subset construction
+                   auto closure { [&nfa] (vector<int> ss)
+                                    { vector<bool> present(nfa.states.size(), false);
+                                      vector<int>  stack { ss };
+
+                                      for (const int s : ss)
+                                        present[s] = true;
+
+                                      while (!stack.empty())
+                                      { const int s { stack.back() };
+
+                                        stack.pop_back();
+
+                                        for (const int t : nfa.states[s].epsilon)
+                                          if (!present[t])
+                                          { present[t] = true;
+                                            ss += t;
+                                            stack += t;
+                                          }
+                                      }
+
+                                      SR::sort(ss);
+                                      return ss;
+                                    }
+                                };
+
+                   map<vector<int>, int> dfa_state_of;
+                   vector<vector<int>>   nfa_states_of { closure( { start } ) };
+
+                   dfa_state_of.emplace(nfa_states_of.front(), 0);
+                   _transitions.clear();
+                   _accepting.clear();
+
+                   for (size_t dfa_state { 0 }; dfa_state < nfa_states_of.size(); ++dfa_state)
+                   { if (nfa_states_of.size() > n_dfa_limit)
+                       return false;
+
+                     const vector<int> current { nfa_states_of[dfa_state] };      // copy, as nfa_states_of may grow
+
+                     _accepting += SR::binary_search(current, accept);
+
+                     for (size_t cl { 0 }; cl < _n_classes; ++cl)
+                     { vector<int> next;
+
+                       for (const int s : current)
+                       { const nfa_builder::state& st { nfa.states[s] };
+
+                         if ( (st.target != -1) and nfa.sets[st.set_nr].test(representative[cl]) )
+                           next += st.target;
+                       }
+
+                       if (next.empty())
+                       { _transitions += -1;
+                         continue;
+                       }
+
+                       next = closure(move(next));
+
+                       const auto [ it, inserted ] { dfa_state_of.emplace(next, static_cast<int>(nfa_states_of.size())) };
+
+                       if (inserted)
+                         nfa_states_of += move(next);
+
+                       _transitions += it -> second;
+                     }
+                   }
+
+                   return true;
+                 }
+             };
+
+  if (!build(patterns, MAX_NFA_STATES, MAX_DFA_STATES))
+  { _transitions.clear();
+    _accepting.clear();
+
+    _fallback_regex.clear();                    // test all the regexes with std::regex, in their original order
+    FOR_ALL(regexes, [this] (const auto& pr) { _fallback_regex += pr.second; });
+  }
+}
+
+/*! \brief              Does a call match any of the exact calls or regexes?
+    \param  callsign    call to test
+    \return             whether <i>callsign</i> matches any of the calls or regexes
+*/
+bool callsign_matcher::matches(const string_view callsign) const
+{ if (_calls.contains(callsign))
+    return true;
+
+  if (!_accepting.empty())
+  { int state { 0 };
+
+    for (const char c : callsign)
+    { state = _transitions[(static_cast<size_t>(state) * _n_classes) + _class_of[static_cast<unsigned char>(c)]];
+
+      if (state == -1)
+        break;
+    }
+
+    if ( (state != -1) and _accepting[state] )
+      return true;
+  }
+
+  return ANY_OF(_fallback_regex, [callsign] (const regex& rgx) { return regex_match(callsign.begin(), callsign.end(), rgx); });
+}
+
+// -----------  bandmap  ----------------
+
+/*! \class  bandmap
+    \brief  A bandmap
+*/
+
+/*!  \brief                             Return the callsign closest to a particular frequency, if it is within the guard band
+     \param bme                         band map entries
+     \param target_frequency_in_khz     the target frequency, in kHz
+     \param guard_band_in_hz            how far from the target to search, in Hz
+     \return                            Callsign of a station within the guard band
+
+     Returns the nearest station within the guard band, or the null string if no call is found.
+     Assumes that the entries are in order of increasing frequency, so that only the entries within the guard band need be examined
+
+     UNTESTED
+*/
+string bandmap::_nearest_callsign(const BM_ENTRIES& bme, const frequency target_frequency, const frequency guard_band) const
+{ if ( !target_frequency.is_within_ham_band() )
+  { ost << "WARNING: bandmap::_nearest_callsign called with frequency = " << target_frequency << endl;
+    return string { };
+  }
+
+  frequency smallest_difference { 1_MHz };              // start with a big number
+
+  string rv { };
+
+  const frequency lowest { (target_frequency > guard_band) ? (target_frequency - guard_band) : frequency { } };
+
+// binary search to the bottom of the guard band, then look only within it
+  for (auto cit { SR::lower_bound(bme, lowest, SR::less { }, [] (const bandmap_entry& be) { return be.freq(); }) }; (cit != bme.cend()) and (cit -> freq() <= (target_frequency + guard_band)); ++cit)
+  { if (!(cit -> is_marker()))
+    { if (const frequency Δf { target_frequency.difference(cit -> freq()) }; Δf < smallest_difference)
+      { smallest_difference = Δf;
+        rv = cit -> callsign();
+      }
+    }
+  }
+
+  return rv;
+}
+
+/*!  \brief     Insert a bandmap_entry
+     \param be  entry to add
+
+    If <i>be</i> is my marker, the frequency is slightly decreased so that it will always appear below any
+    other entries at the same QRG
+*/
+void bandmap::_insert(const bandmap_entry& be)
+{ static bandmap_entry my_marker_copy;          // needed if be is my marker
+ 
+  if (be.is_my_marker())
+  { my_marker_copy = be;
+    my_marker_copy.freq(my_marker_copy.freq() - MY_MARKER_BIAS);     // make it 1Hz less than actual value
+  }
 
-     Does not add if the frequency is outside the ham bands.
+  const bandmap_entry& ber { be.is_my_marker() ? my_marker_copy : be };   // point to the right bandmap_entry object
+
+  SAFELOCK(_bandmap);
+
+  _entries.insert(ber);     // inserts it in the right place, after any other entries at the same QRG
+  _update_views(ber);
+  _schedule_expiry(ber);
+  _index_mult_keys(ber);
+  _increment_version();
+}
+
+/*!  \brief     All the mult keys on which the need/mult status of a bandmap_entry depends
+     \param be  entry
+     \return    keys for the country, the callsign mult values and the exchange mult values of <i>be</i>
+
+     Mirrors bandmap_entry::calculate_mult_status()
 */
-void bandmap::operator+=(bandmap_entry& be)
-{ SAFELOCK(_bandmap);
+vector<string> bandmap::_mult_keys(const bandmap_entry& be) const
+{ const string& callsign { be.callsign() };
 
-  const bool    mode_marker_is_present { (_mode_marker_frequency.hz() != 0) };
-  const string& callsign               { be.callsign() };
+  vector<string> rv { country_mult_key(be.canonical_prefix()) };
 
-  bool add_it { true };  
+  for (const string& callsign_mult_name : rules.callsign_mults())
+    if (const string callsign_mult_val { callsign_mult_value(callsign_mult_name, callsign) }; !callsign_mult_val.empty())
+      rv += callsign_mult_key(callsign_mult_name, callsign_mult_val);
 
-// do not add if it's already been done recently, or matches several other conditions
-  { add_it = !(_do_not_add.contains(callsign));
+  if (const vector<string> exch_mults { rules.expanded_exchange_mults() }; !exch_mults.empty())
+  { const vector<string> exchange_field_names { rules.expanded_exchange_field_names(be.canonical_prefix(), be.mode()) };
+
+    for (const string& exch_mult_name : exch_mults)
+      if (contains(exchange_field_names, exch_mult_name))
+        if (const string guess { rules.canonical_value(exch_mult_name, exchange_db.guess_value(callsign, exch_mult_name)) }; !guess.empty())
+          rv += exchange_mult_key(exch_mult_name, guess);
+  }
+
+  return rv;
+}
 
-    if (add_it)           // handle regex do-not-match conditions
-    { smatch base_match;
+/*!  \brief     Add a bandmap_entry to the reverse mult index
+     \param be  entry to add
 
-      bool found_match { false };
+     The keys for a call are calculated only once while it remains in the bandmap; thereafter only newly-needed exchange mult values are added
+*/
+void bandmap::_index_mult_keys(const bandmap_entry& be)
+{ if (be.is_marker())
+    return;
 
-      for ( auto it { _do_not_add_regex.begin() }; !found_match and (it != _do_not_add_regex.end()); ++it)
-      { const regex& rgx { it -> second };
+  const string& callsign { be.callsign() };
 
-        found_match = regex_match(callsign, base_match, rgx);
-      }
+  auto it { _mult_keys_of_call.find(callsign) };
 
-      add_it = !found_match;
+  if (it == _mult_keys_of_call.end())
+  { it = _mult_keys_of_call.emplace(callsign, UNORDERED_STRING_SET { }).first;
+
+    for (const string& key : _mult_keys(be))
+    { _dependent_calls[key] += callsign;
+      it -> second += key;
     }
+  }
 
-    if (add_it)
-      add_it = be.freq().is_within_ham_band();
+  const auto needed_exchange_mults { be.is_needed_exchange_mult_details() };
 
-    if (add_it)
-      add_it = !((be.source() != BANDMAP_ENTRY_SOURCE::LOCAL) and is_recent_call(callsign));
+  for (const auto& [ exch_mult_name, exch_mult_value ] : needed_exchange_mults.values())     // the guess may have changed since the keys were calculated
+  { const string key { exchange_mult_key(exch_mult_name, exch_mult_value) };
 
-// could make this more efficient by having a global container of the mode-marker bandmap entries
-    if (add_it and mode_marker_is_present)
-    { const bandmap_entry mode_marker_be { (*this)[MODE_MARKER] };    // assumes only one mode marker
+    _dependent_calls[key] += callsign;
+    it -> second += key;
+  }
+}
+
+/*!  \brief             Remove a call from the reverse mult index
+     \param callsign    call to remove
+
+     Does nothing if <i>callsign</i> is not in the index
+*/
+void bandmap::_unindex_mult_keys(const string_view callsign)
+{ const auto it { _mult_keys_of_call.find(callsign) };
+
+  if (it == _mult_keys_of_call.end())
+    return;
+
+  for (const string& key : it -> second)
+  { if (auto dit { _dependent_calls.find(key) }; dit != _dependent_calls.end())
+    { dit -> second.erase(it -> first);
+
+      if (dit -> second.empty())
+        _dependent_calls.erase(dit);
+    }
+  }
+
+  _mult_keys_of_call.erase(it);
+}
+
+/*!  \brief     All the calls in the bandmap whose status may depend on a mult key
+     \param key mult key
+     \return    the calls that are present in the bandmap and whose status may depend on <i>key</i>
+
+     Calls that are no longer present are removed from the index
+*/
+UNORDERED_STRING_SET bandmap::_dependent_calls_of(const string_view key)
+{ UNORDERED_STRING_SET rv;
+  vector<string>       stale_calls;                   // calls whose entries have gone without being removed from the index
+
+  if (const auto it { _dependent_calls.find(key) }; it != _dependent_calls.end())
+    for (const string& callsign : it -> second)
+    { if (_entries.contains(callsign))
+        rv += callsign;
+      else
+        stale_calls += callsign;
+    }
+
+  FOR_ALL(stale_calls, [this] (const string& callsign) { _unindex_mult_keys(callsign); });   // their keys will be recalculated if they return
+
+  return rv;
+}
+
+/*!  \brief     Schedule the expiry of a bandmap_entry
+     \param be  entry whose expiry is to be scheduled
+
+     Markers never expire, so are not scheduled
+*/
+void bandmap::_schedule_expiry(const bandmap_entry& be)
+{ if (be.is_marker())
+    return;
+
+  if (_expiry_wheel.n_slots() == 0)     // one revolution covers the longest decay time
+    _expiry_wheel.n_slots(60 * (max( { context.bandmap_decay_time_local(), context.bandmap_decay_time_cluster(), context.bandmap_decay_time_rbn() } ) + 1));
+
+  _expiry_wheel.add(be.callsign(), be.expiration_time());
+}
+
+/*!  \brief     Does a bandmap_entry pass the filter?
+     \param be  entry to test
+     \return    whether <i>be</i> should appear in the filtered entries
+*/
+bool bandmap::_passes_filter(const bandmap_entry& be) const
+{ if (!filter_enabled() or be.is_marker())
+    return true;
+
+  const bool display_this_entry { (_filter_p -> continents()).contains(be.continent()) or (_filter_p -> prefixes()).contains(be.canonical_prefix()) };
+
+  return filter_hide() ? !display_this_entry : display_this_entry;
+}
+
+/*!  \brief     Does a bandmap_entry pass the cull function?
+     \param be  entry to test
+     \return    whether <i>be</i> should appear in the culled entries, given that it has passed the filter
+*/
+bool bandmap::_passes_cull(const bandmap_entry& be) const
+{ if (be.is_marker())
+    return true;
+
+  switch (_cull_function)
+  { default :
+    case 0 :
+      return true;
+
+    case 1 :                                    // N7DR criteria
+      return be.matches_criteria();
+
+    case 2 :                                    // new on this band+mode
+      return be.is_all_time_first_and_needed_qso();
+
+    case 3 :                                    // never worked anywhere
+      return (olog.n_qsos(be.callsign()) == 0);
+  }
+}
+
+/// rebuild the filtered and culled views from <i>_entries</i>
+void bandmap::_rebuild_views(void)
+{ _filtered_entries.clear();
+  _rbn_threshold_filtered_and_culled_entries.clear();
 
-      add_it = (be.frequency_difference(mode_marker_be) > MAX_FREQUENCY_SKEW);
+  for (const bandmap_entry& be : _entries)          // in order of frequency, so each insertion is at the end of the view
+  { if (_passes_filter(be))
+    { _filtered_entries.insert(be);
+
+      if (_passes_cull(be))
+        _rbn_threshold_filtered_and_culled_entries.insert(be);
     }
   }
 
+  _views_filter_generation = _filter_p -> generation();
+  _views_version = _version;
+}
+
+/*!  \brief     Bring the filtered and culled views up to date for a single entry
+     \param be  the entry as it now appears in <i>_entries</i>
+*/
+void bandmap::_update_views(const bandmap_entry& be)
+{ if (_views_version == -1)                         // views will be rebuilt before they are next used
+    return;
+
+  if (_passes_filter(be))
+  { _filtered_entries.insert(be);
+
+    if (_passes_cull(be))
+      _rbn_threshold_filtered_and_culled_entries.insert(be);
+    else
+      _rbn_threshold_filtered_and_culled_entries.erase(be.callsign());
+  }
+  else
+  { _filtered_entries.erase(be.callsign());
+    _rbn_threshold_filtered_and_culled_entries.erase(be.callsign());
+  }
+}
+
+/*!  \brief             Remove a call from the bandmap and from the views
+     \param callsign    call to remove
+     \return            whether <i>callsign</i> was present
+*/
+bool bandmap::_erase(const string_view callsign)
+{ if (!_entries.erase(callsign))
+    return false;
+
+  _filtered_entries.erase(callsign);
+  _rbn_threshold_filtered_and_culled_entries.erase(callsign);
+
+  return true;
+}
+
+// a call will be marked as recent if:
+// its source is LOCAL or CLUSTER
+// or
+// its source is RBN and the call is already present in the bandmap
+// at the same QRG with this poster
+// ASCII art created with asciio
+/*
+                  .-----.
+                  | RBN |
+                  '-----'
+                     |
+                     |
+                     v
+             .----------------.             .-----------.
+             |                |             |           |
+             |  Call present? |      NO     |   POST    |
+             |                |------------>|           |
+             |                |             |           |
+             '----------------'             '-----------'
+                      | YES
+                      v
+                .-----------.               .-----------.          .-----------.
+                |           |               |           |          |           |
+                |QRG approx |        NO     |Delete old |          |    POST   |
+                |  same?    ---------------->   post    |--------->|           |
+                |           |               |           |          |           |
+                '-----------'               '-----------'          '-----------'
+                      | YES
+                      v
+                .---------------------.     .---------------.
+                | New expiration      |     | Add poster    |
+                | later than          |  NO | to posters    |
+                | current expiration? |---->|               |
+                |                     |     |               |
+                '---------------------'     '---------------'
+                        |
+                        | YES
+                        v
+                .--------------.
+                | Mark current |
+                |   as RBN     |
+                |              |
+                |              |
+                '--------------'
+                       |
+                       |
+                       v
+                .------------.
+                | Add poster |
+                | to posters |
+                |            |
+                |            |
+                '------------'
+                      |
+                      v
+                .---------------.
+                | POST with new |
+                | expiration    |
+                |               |
+                |               |
+                '---------------'
+ */
+/*!  \brief     Mark a bandmap_entry as recent
+     \param be  entry to mark
+
+    an entry will be marked as recent if:
+        its source is LOCAL or CLUSTER
+    or
+        its source is RBN and the call is already present in the bandmap at the same QRG with the poster of <i>be</i>
+*/
+bool bandmap::_mark_as_recent(const bandmap_entry& be)
+{ if (_rbn_threshold == 1)
+    return true;
+
+  if ( (be.source() == BANDMAP_ENTRY_SOURCE::LOCAL) or (be.source() == BANDMAP_ENTRY_SOURCE::CLUSTER) )
+    return true;
+
+  if (be.is_marker())           // don't mark markers as recent, if somehow we got here with a marker as parameter (which should nevre happen)
+    return false;
+
+  SAFELOCK(_bandmap);
+
+  const bandmap_entry& old_be { (*this)[be.callsign()] };
+
+  if (!old_be.valid())    // not already present
+    return false;
+
+  if (be.frequency_difference(old_be) > MAX_FREQUENCY_SKEW)       // treat anything within 250 Hz as the same frequency
+    return false;         // we're going to write a new entry
+
+  return false;    // should never get here
+}
+
+/*!  \brief     Add a bandmap_entry
+     \param be  entry to add
+
+     <i>_time_of_earlier_bandmap_entry</i> in <i>be</i> might be changed.
+     Could change this by copying the be inside +=.
+
+     Does not add if the frequency is outside the ham bands.
+*/
+/*!  \brief     Is it permissible to add a bandmap_entry?
+     \param be  entry to test
+     \return    whether <i>be</i> passes all the do-not-add, band, recent-call and mode-marker tests
+*/
+bool bandmap::_permitted(const bandmap_entry& be)
+{ const string& callsign { be.callsign() };
+
+  bool add_it { !_do_not_add_matcher.matches(callsign) };      // exact calls, then regexes in a single pass
+
+  if (add_it)
+    add_it = be.freq().is_within_ham_band();
+
+  if (add_it)
+    add_it = !((be.source() != BANDMAP_ENTRY_SOURCE::LOCAL) and is_recent_call(callsign));
+
+// could make this more efficient by having a global container of the mode-marker bandmap entries
+  if (add_it and (_mode_marker_frequency.hz() != 0))
+  { const bandmap_entry mode_marker_be { (*this)[MODE_MARKER] };    // assumes only one mode marker
+
+    add_it = (be.frequency_difference(mode_marker_be) > MAX_FREQUENCY_SKEW);
+  }
+
+  return add_it;
+}
+
+void bandmap::operator+=(bandmap_entry& be)
+{ SAFELOCK(_bandmap);
+
+  const bool    mode_marker_is_present { (_mode_marker_frequency.hz() != 0) };
+  const string& callsign               { be.callsign() };
+
+// do not add if it's already been done recently, or matches several other conditions
+  const bool add_it { _permitted(be) };
+
   if (add_it)                                           // actually add the entry
   { const bool mark_as_recent { _mark_as_recent(be) };  // keep track of whether we're going to mark this as a recent call
 
@@ -696,19 +1981,19 @@ void bandmap::operator+=(bandmap_entry& be)
 
       if (old_be.valid())
       { if (be.frequency_difference(old_be) > MAX_FREQUENCY_SKEW)  // add only if more than 250 Hz away
-        { (*this) -= callsign;
+        { _erase(callsign);                   // not -=, so that the mult keys of the call remain indexed
           _insert(be);
         }
         else    // ~same frequency
         { if (old_be.expiration_time() >= be.expiration_time())
-          { (*this) -= callsign;
+          { _erase(callsign);
             _insert(old_be);
           }
           else    // new expiration is later
           { old_be.source(BANDMAP_ENTRY_SOURCE::RBN);
             old_be.expiration_time(be.expiration_time()); // NB: don't change time(); this line causes duration to change, which means that we can't use value_maps for colour
 
-            (*this) -= callsign;
+            _erase(callsign);
             be.time_of_earlier_bandmap_entry(old_be);    // could change be
 
             _insert(old_be);
@@ -716,7 +2001,7 @@ void bandmap::operator+=(bandmap_entry& be)
         }
       }
       else    // this call is not currently present
-      { _entries.remove_if( [&be] (bandmap_entry& bme) { return ((bme.frequency_str() == be.frequency_str()) and (bme.is_not_marker())); } );  // remove any real entries at this QRG
+      { _erase_if( [&be] (const bandmap_entry& bme) { return (bme.same_frequency_str(be) and (bme.is_not_marker())); } );  // remove any real entries at this QRG
         _insert(be);
       }
 
@@ -724,43 +2009,114 @@ void bandmap::operator+=(bandmap_entry& be)
       if (be.is_not_marker())
       { const bandmap_entry current_be { (*this)[callsign] };  // the entry in the updated bandmap
 
-        { _entries.remove_if( [&current_be] (bandmap_entry& bme) { bool rv { bme.is_not_marker() };
+        { _erase_if( [&current_be] (const bandmap_entry& bme) { bool rv { bme.is_not_marker() };
+
+                                                                 if (rv)
+                                                                 { rv = (bme.callsign() != current_be.callsign());
+
+                                                                   if (rv)
+                                                                     rv = bme.same_frequency_str(current_be);
+                                                                 }
+
+                                                                 return rv;
+                                                               } );
+        }
+      }
+    }
+    else    // not RBN
+    { _erase_if( [&be] (const bandmap_entry& bme) { return bme.matches_bandmap_entry(be); } );
+      _insert(be);
+    }
+
+    if (be.is_not_marker() and mark_as_recent)
+      _recent_calls += callsign;
+
+// don't think I need to increment the version manually
+  }
+
+  if (mode_marker_is_present and !is_present(MODE_MARKER))
+    ost << "*** ERROR: MODE MARKER HAS BEEN REMOVED BY BANDMAP_ENTRY: " << be << endl;
+}
+
+/*! \brief              Re-mark the need/mult status of the entries that might be affected by some QSOs
+    \param  qsos        QSOs that have been added to, or removed from, the log
+    \param  rules       rules for the contest
+    \param  q_history   history of all the QSOs
+    \param  statistics  statistics for the contest so far
+    \return             whether the status of any entry changed
+
+    Only the entries for the calls in <i>qsos</i>, and those that share a country, callsign mult value or
+    exchange mult value with any of the QSOs, are re-marked. <i>statistics</i> and <i>q_history</i> must
+    be up to date before this is called.
+*/
+bool bandmap::remark(const vector<QSO>& qsos, contest_rules& rules, const call_history& q_history, running_statistics& statistics)
+{ SAFELOCK(_bandmap);
+
+  UNORDERED_STRING_SET affected_calls;
+
+  for (const QSO& qso : qsos)
+  { const string callsign { qso.callsign() };
+
+    affected_calls += callsign;
+    affected_calls += _dependent_calls_of(country_mult_key(location_db.canonical_prefix(callsign)));
+
+    for (const string& callsign_mult_name : rules.callsign_mults())
+      if (const string callsign_mult_val { callsign_mult_value(callsign_mult_name, callsign) }; !callsign_mult_val.empty())
+        affected_calls += _dependent_calls_of(callsign_mult_key(callsign_mult_name, callsign_mult_val));
+
+    for (const received_field& field : qso.received_exchange())
+      affected_calls += _dependent_calls_of(exchange_mult_key(field.name(), rules.canonical_value(field.name(), field.value())));
+  }
+
+  bool changed { false };
+
+  for (const string& callsign : affected_calls)
+  { if (auto it { _entries.find(callsign) }; (it != _entries.end()) and it -> remark(rules, q_history, statistics))
+    { _index_mult_keys(*it);
+      _update_views(*it);
+      changed = true;
+    }
+  }
 
-                                                                   if (rv)
-                                                                   { rv = (bme.callsign() != current_be.callsign());
+  if (changed)
+    _increment_version();
 
-                                                                     if (rv)
-                                                                       rv = bme.frequency_str() == current_be.frequency_str();
-                                                                   }
+  return changed;
+}
 
-                                                                   return rv;
-                                                                 } );
-        }
-      }
-    }
-    else    // not RBN
-    { _entries.remove_if( [&be] (bandmap_entry& bme) { return bme.matches_bandmap_entry(be); } );
-      _insert(be);
-    }
+/*! \brief      Prune the bandmap, removing any entries that have expired
+    \return     whether any entries were removed
 
-    if (be.is_not_marker() and mark_as_recent)
-      _recent_calls += callsign;
+    Uses <i>_expiry_wheel</i>, so the cost is proportional to the number of expired entries, not to the
+    number of entries in the bandmap. Intended to be called once per second. The recent calls are
+    cleared the first time that this is called in each minute.
+*/
+bool bandmap::prune(void)
+{ SAFELOCK(_bandmap);
 
-// don't think I need to increment the version manually
+  const time_t now { NOW() };
+
+  if (const time_t this_minute { now / 60 }; this_minute != _recent_calls_minute)
+  { _recent_calls.clear();                                            // empty the container of recent calls
+    _recent_calls_minute = this_minute;
+    _increment_version();                                             // the colours of the entries fade with age, so the display must be rewritten
   }
 
-  if (mode_marker_is_present and !is_present(MODE_MARKER))
-    ost << "*** ERROR: MODE MARKER HAS BEEN REMOVED BY BANDMAP_ENTRY: " << be << endl;
-}
+  bool rv { false };
 
-/// prune the bandmap
-void bandmap::prune(void)
-{ SAFELOCK(_bandmap);                                   // hold the lock for the entire process
+  for (const string& callsign : _expiry_wheel.expire(now))
+  { const auto cit { _entries.find(callsign) };
+
+    if ( (cit != _entries.cend()) and cit -> should_prune(now) and _erase(callsign) )     // the entry may have been removed or refreshed since it was scheduled
+    { _unindex_mult_keys(callsign);
+      rv = true;
+    }
+  }
 
-  erase_if(_entries, [now = NOW()] (const bandmap_entry& be) { return (be.should_prune(now)); } );
+  if (rv)
+    _increment_version();
 
-  _recent_calls.clear();                       // empty the container of recent calls
-  _version++;
+  return rv;
 }
 
 /*! \brief              Return the entry for a particular call
@@ -772,7 +2128,9 @@ void bandmap::prune(void)
 bandmap_entry bandmap::operator[](const string_view str) const
 { SAFELOCK(_bandmap);
 
-  return VALUE_IF(_entries, [&str] (const bandmap_entry& be) { return (be.callsign() == str); });
+  const auto cit { _entries.find(str) };
+
+  return ( (cit == _entries.cend()) ? bandmap_entry { } : *cit );
 }
 
 /*! \brief          Return the first entry for a partial call
@@ -784,7 +2142,9 @@ bandmap_entry bandmap::operator[](const string_view str) const
 bandmap_entry bandmap::substr(const string_view pcall) const
 { SAFELOCK(_bandmap);
 
-  return VALUE_IF(_entries, [&pcall] (const bandmap_entry& be) { return be.callsign().contains(pcall); });
+  const auto cit { FIND_IF(_entries.entries(), [&pcall] (const bandmap_entry& be) { return be.callsign().contains(pcall); }) };
+
+  return ( (cit == _entries.cend()) ? bandmap_entry { } : *cit );
 }
 
 /*! \brief              Remove a call from the bandmap
@@ -798,12 +2158,10 @@ void bandmap::operator-=(const string_view callsign)
   if (_is_regex(callsign))
     FOR_ALL(regex_matches(callsign), [this] (const string& matched_call) { *this -= matched_call; });   // sets dirty_entries and augments _version (perhaps multiple times) if executed
   else
-  { const size_t initial_size { _entries.size() };
-
-    erase_if(_entries, [callsign] (const bandmap_entry& be) { return (be.callsign() == callsign); } );
-
-    if (_entries.size() != initial_size)  // mark as dirty if we removed any
-      _version++;
+  { if (_erase(callsign))            // mark as dirty if we removed it
+    { _unindex_mult_keys(callsign);
+      _increment_version();
+    }
   }
 }
 
@@ -833,10 +2191,17 @@ void bandmap::not_needed_country_mult(const string_view canonical_prefix)
 
   bool changed { false };
 
-  FOR_ALL(_entries, [&canonical_prefix, &changed] (decltype(*_entries.begin())& be) { changed = ( be.remove_country_mult(canonical_prefix) or changed); } );
+  for (const string& callsign : _dependent_calls_of(country_mult_key(canonical_prefix)))
+  { bandmap_entry& be { *_entries.find(callsign) };
+
+    if (be.remove_country_mult(canonical_prefix))
+    { _update_views(be);
+      changed = true;
+    }
+  }
 
   if (changed)
-    _version++;
+    _increment_version();
 }
 
 /*! \brief                      Set the needed country mult status of all calls in a particular country and on a particular mode to false
@@ -848,9 +2213,19 @@ void bandmap::not_needed_country_mult(const string_view canonical_prefix)
 void bandmap::not_needed_country_mult(const string_view canonical_prefix, const MODE m)
 { SAFELOCK(_bandmap);
 
-  FOR_ALL(_entries, [m, &canonical_prefix] (decltype(*_entries.begin())& be) { if (be.mode() == m)
-                                                                                 be.remove_country_mult(canonical_prefix);
-                                                                             } );
+  bool changed { false };
+
+  for (const string& callsign : _dependent_calls_of(country_mult_key(canonical_prefix)))
+  { bandmap_entry& be { *_entries.find(callsign) };
+
+    if ( (be.mode() == m) and be.remove_country_mult(canonical_prefix) )
+    { _update_views(be);
+      changed = true;
+    }
+  }
+
+  if (changed)
+    _increment_version();
 }
 
 /*! \brief                          Set the needed callsign mult status of all matching callsign mults to <i>false</i>
@@ -869,18 +2244,22 @@ void bandmap::not_needed_callsign_mult(string (*pf)(const string_view /* e.g. "W
   bool changed { false };   // have we changed anything?
 
 // change status for all entries with this particular callsign mult
-  for (auto& be : _entries)
-  { if (be.is_needed_callsign_mult())
+  for (const string& dependent_call : _dependent_calls_of(callsign_mult_key(mult_type, callsign_mult_string)))
+  { bandmap_entry& be { *_entries.find(dependent_call) };
+
+    if (be.is_needed_callsign_mult())
     { const string& callsign           { be.callsign() };
       const string  this_callsign_mult { (*pf)(mult_type, callsign) };
 
-      if (this_callsign_mult == callsign_mult_string)
-        changed |= be.remove_callsign_mult(mult_type, callsign_mult_string);
+      if ( (this_callsign_mult == callsign_mult_string) and be.remove_callsign_mult(mult_type, callsign_mult_string) )
+      { _update_views(be);
+        changed = true;
+      }
     }
   }
 
   if (changed)
-    _version++;
+    _increment_version();
 }
 
 /*! \brief              Set the needed exchange mult status of a particular exchange mult to <i>false</i>
@@ -895,10 +2274,112 @@ void bandmap::not_needed_exchange_mult(const string_view mult_name, const string
 
   SAFELOCK(_bandmap);
 
-  FOR_ALL(_entries, [mult_name, mult_value, &changed] (bandmap_entry& be) { changed |= be.remove_exchange_mult(mult_name, mult_value); } );
+  for (const string& callsign : _dependent_calls_of(exchange_mult_key(mult_name, mult_value)))
+  { bandmap_entry& be { *_entries.find(callsign) };
+
+    if (be.remove_exchange_mult(mult_name, mult_value))
+    { _update_views(be);
+      changed = true;
+    }
+  }
 
   if (changed)
-    _version++;
+    _increment_version();
+}
+
+/*!  \brief     Publish a new snapshot of the displayed entries
+
+     <i>_bandmap_mutex</i> must be held by the caller
+*/
+void bandmap::_publish_snapshot(void)
+{ auto snapshot { make_shared<displayed_snapshot>() };
+
+  snapshot -> entries = _displayed_entries();
+  snapshot -> filter_generation = _filter_p -> generation();
+
+  if (const auto cit { FIND_IF(snapshot -> entries, [] (const bandmap_entry& be) { return be.is_my_marker(); }) }; cit != snapshot -> entries.cend())
+    snapshot -> my_marker_frequency = cit -> freq();
+
+  _snapshot.store(move(snapshot));
+  _snapshot_is_stale = false;
+}
+
+/*!  \brief     The current snapshot of the displayed entries
+     \return    the most recently published snapshot
+
+     Does not lock <i>_bandmap_mutex</i> unless the snapshot is missing or stale, or the (shared) filter has changed since it was published
+*/
+shared_ptr<const bandmap::displayed_snapshot> bandmap::_current_snapshot(void)
+{ const auto is_current { [this] (const shared_ptr<const displayed_snapshot>& snapshot)
+                            { return (snapshot and (snapshot -> filter_generation == _filter_p -> generation())); } };   // the filter may have been changed through another bandmap
+
+  shared_ptr<const displayed_snapshot> rv { _snapshot_is_stale ? nullptr : _snapshot.load() };    // _publish_snapshot() clears the flag only after storing the snapshot
+
+  if (!is_current(rv))
+  { SAFELOCK(_bandmap);
+
+    rv = _snapshot.load();
+
+    if (_snapshot_is_stale or !is_current(rv))         // another reader may have published a snapshot while we waited for the lock
+    { _publish_snapshot();
+      rv = _snapshot.load();
+    }
+  }
+
+  return rv;
+}
+
+/*!  \brief     Build the navigation indices of a snapshot, if they have not already been built
+
+     Each non-marker entry is reduced to one bit per indexed predicate, and the bits are then
+     distributed into ascending lists of positions, one per predicate
+*/
+void bandmap::displayed_snapshot::build_index(void) const
+{ call_once(index_flag, [this] (void)
+    { static_assert(INDEXED_PREDICATES.size() <= 8, "too many indexed predicates for the per-entry bits");
+
+      for (uint32_t posn { 0 }; posn < entries.size(); ++posn)
+      { const bandmap_entry& be { entries[posn] };
+
+        if (be.is_marker())
+          continue;
+
+        non_markers += posn;
+
+        uint8_t bits { 0 };
+
+        for (size_t n { 0 }; n < INDEXED_PREDICATES.size(); ++n)
+          if ((be.*INDEXED_PREDICATES[n])())
+            bits |= (1 << n);
+
+        for (size_t n { 0 }; n < INDEXED_PREDICATES.size(); ++n)
+          if (bits & (1 << n))
+            predicate_positions[n] += posn;
+      }
+    } );
+}
+
+/*!  \brief         Positions of the non-marker entries that satisfy a predicate
+     \param fp      predicate
+     \param buffer  storage for the result if <i>fp</i> is not indexed
+     \return        ascending positions in <i>entries</i> of the non-marker entries for which <i>fp</i> is true
+
+     Returns the index if <i>fp</i> is one of the indexed predicates; otherwise tests every entry, placing the result in <i>buffer</i>
+*/
+const vector<uint32_t>& bandmap::displayed_snapshot::positions(PREDICATE_FUN_P fp, vector<uint32_t>& buffer) const
+{ build_index();
+
+  for (size_t n { 0 }; n < INDEXED_PREDICATES.size(); ++n)
+    if (INDEXED_PREDICATES[n] == fp)
+      return predicate_positions[n];
+
+  buffer.clear();
+
+  FOR_ALL(non_markers, [fp, &buffer, this] (const uint32_t posn) { if ((entries[posn].*fp)())
+                                                                     buffer += posn;
+                                                                 } );
+
+  return buffer;
 }
 
 /*! \brief          Enable or disable the filter
@@ -911,7 +2392,7 @@ void bandmap::filter_enabled(const bool torf)
   { SAFELOCK(_bandmap);
 
     _filter_p->enabled(torf);
-    _version++;
+    _increment_version();
   }
 }
 
@@ -927,7 +2408,7 @@ void bandmap::filter_add_or_subtract(const string_view str)
   { SAFELOCK(_bandmap);
 
     _filter_p -> add_or_subtract(str);
-    _version++;
+    _increment_version();
   }
 }
 
@@ -939,7 +2420,7 @@ void bandmap::filter_hide(const bool torf)
   { SAFELOCK(_bandmap);
 
     _filter_p -> hide(torf);
-    _version++;
+    _increment_version();
   }
 }
 
@@ -951,69 +2432,49 @@ void bandmap::filter_show(const bool torf)
   { SAFELOCK(_bandmap);
 
     _filter_p -> hide(!torf);
-    _version++;
+    _increment_version();
   }
 }
 
-/// all the entries, after filtering has been applied
-BM_ENTRIES bandmap::filtered_entries(void)
-{ if (!filter_enabled())
-    return entries();
-
-  SAFELOCK(_bandmap);
-
-// whether to include a particular bandmap entry
-  auto include_be { [this] (const bandmap_entry& be) { if (be.is_marker())
-                                                         return true;
-
-                                                       const bool display_this_entry { (_filter_p -> continents()).contains(be.continent()) or (_filter_p -> prefixes()).contains(be.canonical_prefix()) };
+/*!  \brief     Set the cull function
+     \param n   number of the cull function to apply
+*/
+void bandmap::cull_function(const int n)
+{ SAFELOCK(_bandmap);
 
-                                                       return filter_hide() ? !display_this_entry : display_this_entry;
-                                                     }
-                  };
+  if (n != _cull_function)
+  { _cull_function = n;
+    _views_version = -1;                        // rebuild the views when they are next needed
+    _increment_version();
+  }
+}
 
-  _filtered_entries = to<BM_ENTRIES> (_entries | SRV::filter(include_be));
+/// all the entries, after filtering has been applied
+BM_ENTRIES bandmap::filtered_entries(void)
+{ SAFELOCK(_bandmap);
 
-// is it correct that we don't increment _version?
+  _refresh_views();
 
-  return _filtered_entries;
+  return _filtered_entries.entries();
 }
 
 /// all the entries, after the RBN threshold and filtering have been applied
 // threshold is now applied before an entry is put into _entries, so this is the same as just the filtered entries
 BM_ENTRIES bandmap::rbn_threshold_and_filtered_entries(void)
-{ SAFELOCK(_bandmap);
-
-  _rbn_threshold_and_filtered_entries = filtered_entries();
-
-  return _rbn_threshold_and_filtered_entries;
-}
+  { return filtered_entries(); }
 
 /// all the entries, after the RBN threshold, filtering and culling have been applied
 BM_ENTRIES bandmap::rbn_threshold_filtered_and_culled_entries(void)
 { SAFELOCK (_bandmap);
 
-  switch (_cull_function)
-  { default :
-    case 0 :
-      return rbn_threshold_and_filtered_entries();
-
-    case 1 :                                                        // N7DR criteria
-      return SR::to<BM_ENTRIES> ( rbn_threshold_and_filtered_entries() | SRV::filter([] (const bandmap_entry& be) { return (be.is_marker() or be.matches_criteria()); }) );
-
-    case 2 :                                                        // new on this band+mode
-      return SR::to<BM_ENTRIES> ( rbn_threshold_and_filtered_entries() | SRV::filter([] (const bandmap_entry& be) { return (be.is_marker() or be.is_all_time_first_and_needed_qso()); }));
-
-    case 3 :                                                        // never worked anywhere
-      return SR::to<BM_ENTRIES> ( rbn_threshold_and_filtered_entries() | SRV::filter([] (const bandmap_entry& be) { return (be.is_marker() or (olog.n_qsos(be.callsign()) == 0)); }));
-  }
+  return _displayed_entries();
 }
 
 /// the displayed calls, without any markers
 BM_ENTRIES bandmap::displayed_entries_no_markers(void)
 { SAFELOCK (_bandmap);
 
-  return SR::to<BM_ENTRIES> ( displayed_entries() | SRV::filter([] (const bandmap_entry& be) { return !be.is_marker(); }) );
+  return SR::to<BM_ENTRIES> ( _displayed_entries() | SRV::filter([] (const bandmap_entry& be) { return !be.is_marker(); }) );
 }
 
 /// return the number of displayed calls, not counting markers
@@ -1022,9 +2483,9 @@ size_t bandmap::count_displayed_entries_no_markers(void)
 
   size_t rv { 0 };
 
-  FOR_ALL(displayed_entries(), [&rv] (const bandmap_entry& be) { if (!be.is_marker())
-                                                                   rv++;
-                                                               } );
+  FOR_ALL(_displayed_entries(), [&rv] (const bandmap_entry& be) { if (!be.is_marker())
+                                                                    rv++;
+                                                                } );
 
   return rv;
 }
@@ -1038,94 +2499,65 @@ size_t bandmap::count_displayed_entries_no_markers(void)
 
      The return value can be tested with .empty() to see if a station was found.
      Applies filtering and the RBN threshold before searching for the next station.
-     Assumes that the current location is correctly marked with MY_MARKER in the bandmap
+     Assumes that the current location is correctly marked with MY_MARKER in the bandmap.
+     Binary searches to the current location, then steps through the (ascending) positions of the stations for which <i>fp</i> is true
 
      Should perhaps use guard band instead of MAX_FREQUENCY_SKEW
 */
 bandmap_entry bandmap::needed(PREDICATE_FUN_P fp, const frequency f, const enum BANDMAP_DIRECTION dirn, const int16_t nskip)
 { constexpr frequency MAX_PERMITTED_SKEW { 95_Hz };
 
-  SAFELOCK(_bandmap);    // hold the lock so nothing changes while we scan the bandmap
+  shared_ptr<const displayed_snapshot> snapshot { _current_snapshot() };      // scan a snapshot, so that we don't wait for writers
 
-  bandmap_entry mbe_copy { my_bandmap_entry() };
-
-  if (mbe_copy.freq() != (f - MY_MARKER_BIAS))
-  {  mbe_copy.freq(f);
-    (*this) += mbe_copy;      // NB this might change the bandmap; bias automatically applied during insertion
-  }
-
-  const BM_ENTRIES fe { displayed_entries() };
-
-// why can't this be const?
-  auto marker_it { FIND_IF(fe, [] (const bandmap_entry& be) { return (be.is_my_marker()); } ) };  // find myself
-
-  if (marker_it == fe.cend())             // should never be true
-    return bandmap_entry { };
-
-  const frequency target_freq { f };
+  if (snapshot -> my_marker_frequency != (f - MY_MARKER_BIAS))                // only if my marker has to move do we need the lock
+  { SAFELOCK(_bandmap);
 
-/*! \brief          From a starting iterator, move in a direction and find the first iterator that meets a condition, after skipping <i>nskip</i> iterators
-    \param  it1     starting iterator
-    \param  it2     one-past-the-end iterator
-    \param  nskip   number of iterators to skip
-    \return         iterator
-*/
-  auto get_be = [fp, &fe, &target_freq] (const auto it1, const auto it2, const auto nskip)                  // this returns a range containing one element
-    { return SR::subrange(it1, it2) |
-               SRV::filter([fp] (const bandmap_entry& be) { return (!be.is_marker() and (be.*fp)()); }) |
-               SRV::drop(nskip) |
-               SRV::take(1);
-    };
+    bandmap_entry mbe_copy { my_bandmap_entry() };
 
-/*! \brief          From a starting iterator, move down and find the first iterator that meets a condition, after skipping <i>nskip</i> iterators
-    \param  foit    starting forward iterator
-    \param  nskip   number of iterators to skip
-    \return         iterator
-*/
-  auto gnd_r = [fp, &fe, &get_be, &target_freq] (auto foit, const auto nskip)
-  { auto v { get_be(REVERSE_IT(foit), fe.crend(), nskip) };                   // can't be const, because can't use begin() on a constant range, and there is not yet a cbegin()
+    if (mbe_copy.freq() != (f - MY_MARKER_BIAS))
+    {  mbe_copy.freq(f);
+      (*this) += mbe_copy;      // NB this might change the bandmap; bias automatically applied during insertion
+    }
 
-    if (!v.empty())
-      return *(v.begin());
+    snapshot = _current_snapshot();
+  }
 
-// get lowest non-marker
-    for (auto it { fe.begin() }; it != fe.end(); ++it)
-      if (!(it->is_marker()))
-        return *it;
+  const BM_ENTRIES& fe { snapshot -> entries };
 
+  if (fe.empty())
     return bandmap_entry { };
-  };
 
-/*! \brief          From a starting iterator, move up and find the first iterator that meets a condition, after skipping <i>nskip</i> iterators
-    \param  foit    starting forward iterator
-    \param  nskip   number of iterators to skip
-    \return         iterator
-*/
-  auto gnu_r = [fp, get_be, &fe, &target_freq] (auto foit, const auto nskip)
-  { const auto cit2 { find_if(foit, fe.cend(), [target_freq] (const bandmap_entry& be) { return (be.freq() > (target_freq + MAX_PERMITTED_SKEW) ); }) }; // move away from my frequency, in upwards direction
+  const auto by_freq { [] (const bandmap_entry& be) { return be.freq(); } };
 
-    auto v { get_be(cit2, fe.cend(), nskip) };
+  const auto marker_range { SR::equal_range(fe, snapshot -> my_marker_frequency, SR::less { }, by_freq) };  // binary search to my frequency
+  const auto marker_it    { SR::find_if(marker_range, [] (const bandmap_entry& be) { return be.is_my_marker(); }) };
 
-    if (!v.empty())
-      return *(v.begin());
+  if (marker_it == marker_range.end())    // should never be true
+    return bandmap_entry { };
 
-// get highest non-marker
-    for (auto it { prev(fe.end()) }; it != fe.begin(); --it)
-      if (!(it->is_marker()))
-        return *it;
+  const uint32_t marker_posn { static_cast<uint32_t>(distance(fe.begin(), marker_it)) };
 
-    if (!fe.front().is_marker())
-      return fe.front();
+  vector<uint32_t>        buffer;
+  const vector<uint32_t>& matches { snapshot -> positions(fp, buffer) };            // ascending positions of the stations that meet the condition
+  const vector<uint32_t>& stns    { snapshot -> non_markers };                      // ascending positions of all the stations
 
+  if (stns.empty())
     return bandmap_entry { };
-  };
 
   switch (dirn)
   { case DOWN :
-      return gnd_r(marker_it, nskip);
+    { const size_t n_below { static_cast<size_t>(distance(matches.begin(), SR::lower_bound(matches, marker_posn))) };
+
+      return ( (n_below > static_cast<size_t>(nskip)) ? fe[matches[n_below - 1 - nskip]] : fe[stns.front()] );  // if no match, the lowest station
+    }
 
     case UP :
-      return gnu_r(marker_it, nskip);
+    { const auto     first_it   { SR::upper_bound(marker_it, fe.end(), f + MAX_PERMITTED_SKEW, SR::less { }, by_freq) };  // move away from my frequency, in upwards direction
+      const uint32_t first_posn { static_cast<uint32_t>(distance(fe.begin(), first_it)) };
+      const size_t   n_below    { static_cast<size_t>(distance(matches.begin(), SR::lower_bound(matches, first_posn))) };
+
+      return ( ((n_below + nskip) < matches.size()) ? fe[matches[n_below + nskip]] : fe[stns.back()] );        // if no match, the highest station
+    }
 
     default :                       // needed to keep the compiler happy
       return bandmap_entry { };
@@ -1139,55 +2571,48 @@ bandmap_entry bandmap::needed(PREDICATE_FUN_P fp, const frequency f, const enum
 
     The return value can be tested with .empty() to see if a station was found.
     Applies filtering and the RBN threshold before searching for the next station.
-    As currently implemented, assumes that entries are in increasing order of frequency.
+    Binary searches to <i>f</i> within the (ascending) positions of the stations in the current snapshot.
 */
 bandmap_entry bandmap::next_displayed_be(const frequency f, const enum BANDMAP_DIRECTION dirn, const int16_t nskip, const frequency max_skew)
 { const string dirn_str { (dirn == UP) ? "UP"s : "DOWN"s };
 
   bandmap_entry rv { };
 
-  const BM_ENTRIES fe { displayed_entries_no_markers() };
+  const shared_ptr<const displayed_snapshot> snapshot { _current_snapshot() };     // no lock needed
 
-  if (fe.empty())
+  snapshot -> build_index();
+
+  const BM_ENTRIES&       fe   { snapshot -> entries };
+  const vector<uint32_t>& stns { snapshot -> non_markers };   // ascending positions of the stations
+
+  if (stns.empty())
     return rv;
 
 // are we at the lowest or highest frequency already?
-  if ( ((dirn == DOWN) and (f <= (fe.front().freq() + max_skew) )) or ((dirn == UP) and (f >= (fe.back().freq() - max_skew))) )
+  if ( ((dirn == DOWN) and (f <= (fe[stns.front()].freq() + max_skew) )) or ((dirn == UP) and (f >= (fe[stns.back()].freq() - max_skew))) )
     return rv;
 
   switch (dirn)
-  { case UP :
-    { for (BM_ENTRIES::const_iterator cit { fe.cbegin() }; cit != fe.cend(); ++cit)
-      { if ( ( (cit -> freq()) - max_skew) >= f)                 // stn
-        { for (int16_t skip { 0 }; skip < nskip; ++skip)
-          { ++cit;
-
-            if (cit == fe.cend())
-              return *(prev(cit));  // return highest-frequency be
-          }
+  { case UP :                                                                                           // first station at or above f + max_skew
+    { const auto it { SR::partition_point(stns, [&fe, f, max_skew] (const uint32_t posn) { return ((fe[posn].freq() - max_skew) < f); }) };
 
-          return *cit;
-        }
-      }
+      if (it == stns.end())
+        return rv;    // no frequency match, including nskip
 
-      return rv;    // no frequency match, including nskip
+      const size_t n { static_cast<size_t>(distance(stns.begin(), it)) + nskip };
+
+      return fe[stns[min(n, stns.size() - 1)]];  // if we run out, return highest-frequency be
     }
 
-    case DOWN :
-    { for (BM_ENTRIES::const_reverse_iterator crit { fe.crbegin() }; crit != fe.crend(); ++crit)
-      { if ( ((crit -> freq()) + max_skew) <= f)
-        { for (int16_t skip { 0 }; skip < nskip; ++skip)
-          { ++crit;
+    case DOWN :                                                                                         // last station at or below f - max_skew
+    { const auto it { SR::partition_point(stns, [&fe, f, max_skew] (const uint32_t posn) { return ((fe[posn].freq() + max_skew) <= f); }) };
 
-            if (crit == fe.crend())
-              return *(prev(crit));  // return lowest-frequency be
-          }
+      if (it == stns.begin())
+        return rv;    // no frequency match, including nskip
 
-          return *crit;
-        }
-      }
+      const size_t n_at_or_below { static_cast<size_t>(distance(stns.begin(), it)) };
 
-      return rv;    // no frequency match, including nskip
+      return fe[stns[(n_at_or_below > static_cast<size_t>(nskip)) ? (n_at_or_below - 1 - nskip) : 0]];  // if we run out, return lowest-frequency be
     }
   }
 
@@ -1218,6 +2643,26 @@ frequency bandmap::highest_frequency(void)
   return (bme.empty() ? frequency { } : bme.back().freq());
 }
 
+/*! \brief      Average memory used by each entry
+    \return     the average number of bytes used by each entry in the bandmap, including its share of the call index
+
+    Interned strings are shared between all bandmaps, and are not included
+*/
+size_t bandmap::memory_per_entry(void)
+{ SAFELOCK(_bandmap);
+
+  if (_entries.empty())
+    return 0;
+
+  size_t total { 0 };
+
+  FOR_ALL(_entries.entries(), [&total] (const bandmap_entry& be) { total += be.memory_usage(); });
+
+  total += _entries.size() * (sizeof(string) + sizeof(size_t));     // the call index; calls fit in the short-string buffer
+
+  return (total / _entries.size());
+}
+
 /// convert to a printable string
 string bandmap::to_str(void)
 { string     rv;
@@ -1239,6 +2684,7 @@ string bandmap::to_str(void)
   }
 
   rv += "bandmap version " + ::to_string(ver) + EOL;
+  rv += "memory per entry = "s + ::to_string(memory_per_entry()) + " bytes"s + EOL;
 
   rv += "RAW bandmap:"s + EOL;
   rv += "number of entries = "s + to_string(raw.size());
@@ -1277,29 +2723,171 @@ string bandmap::to_str(void)
 bool bandmap::is_present(const string_view target_callsign) const
 { SAFELOCK(_bandmap);
 
-  return ANY_OF(_entries, [&target_callsign] (const bandmap_entry& be) { return (be.callsign() == target_callsign); });
+  return _entries.contains(target_callsign);
 }
 
 /*! \brief         Process an insertion queue, adding the elements to the bandmap
     \param biq     insertion queue to process
     \return        whether any processing actually took place (i.e., was <i>biq</i> non-empty?)
 
-    <i>biq</i> changes (is emptied) by this routine
-    other threads MUST NOT access biq while this is executing
+    <i>biq</i> changes (is emptied) by this routine; the entire queue is drained at once and merged
+    into the bandmap at once, with a single increment of the version
 */
 bool bandmap::process_insertion_queue(BANDMAP_INSERTION_QUEUE& biq)
+{ vector<bandmap_entry> batch { biq.pop_all() };       // take everything at once, so that the queue's lock is held only briefly
+
+  if (batch.empty())
+    return false;
+
+  SAFELOCK(_bandmap);
+
+  _merge(move(batch));                                  // sets _version
+
+  return true;
+}
+
+/*!  \brief         Add a batch of bandmap_entry objects
+     \param batch   entries to add, in order of arrival
+
+     The result is the same as adding the elements of <i>batch</i> one at a time with +=, except that if
+     more than one element refers to the same call between markers or local entries, the last one wins (unless
+     the call is marked as recent, in which case subsequent elements are ignored, as they would be by +=).
+     Markers and local entries are added with += in their place in the batch; each run of other entries between
+     them is merged in a single pass. The version is incremented once.
+*/
+void bandmap::_merge(vector<bandmap_entry>&& batch)
 { SAFELOCK(_bandmap);
 
-  if (!biq.empty())
-  { optional<bandmap_entry> obe { };
+  vector<bandmap_entry> run;                        // entries since the last marker or local entry
 
-    while (obe = biq.pop(), obe)
-      *this += obe.value();         // sets dirty_entries() and _version
+  _version_deferred = true;
 
-    return true;
+  for (bandmap_entry& be : batch)
+  { if (be.is_marker() or (be.source() == BANDMAP_ENTRY_SOURCE::LOCAL))
+    { _merge_run(move(run));
+      run.clear();
+
+      (*this) += be;
+    }
+    else
+      run += move(be);
   }
 
-  return false;
+  _merge_run(move(run));
+
+  _version_deferred = false;
+  _increment_version();
+}
+
+/*!  \brief         Add a run of bandmap_entry objects in a single pass
+     \param run     entries to add, in order of arrival; none is a marker or a local entry
+
+     If more than one element refers to the same call, the last one wins (unless the call is marked as recent,
+     in which case subsequent elements are ignored, as they would be by +=). Does not change the version.
+*/
+void bandmap::_merge_run(vector<bandmap_entry>&& run)
+{ if (run.empty())
+    return;
+
+  struct accepted_entry
+  { bandmap_entry be;           ///< the entry
+    size_t        arrival;      ///< position in the run
+  };
+
+  vector<accepted_entry>       accepted;            // entries that will be added
+  UNORDERED_STRING_MAP<size_t> posn_of_call;        // position of each call in <i>accepted</i>
+  UNORDERED_STRING_SET         recent_in_run;       // calls marked as recent by this run
+
+// pass 1: acceptance, in order of arrival
+  for (size_t n { 0 }; n < run.size(); ++n)
+  { bandmap_entry& be { run[n] };
+
+    const string& callsign { be.callsign() };
+
+    if (recent_in_run.contains(callsign) or !_permitted(be))
+      continue;
+
+    if (_mark_as_recent(be))
+      recent_in_run += callsign;
+
+    if (const auto it { posn_of_call.find(callsign) }; it != posn_of_call.end())
+      accepted[it -> second] = { move(be), n };       // last write wins
+    else
+    { posn_of_call.emplace(callsign, accepted.size());
+      accepted += accepted_entry { move(be), n };
+    }
+  }
+
+// pass 2: resolve each accepted entry against any existing entry for the same call, exactly as += does
+  for (accepted_entry& ae : accepted)
+  { bandmap_entry& be { ae.be };
+
+    if (be.source() != BANDMAP_ENTRY_SOURCE::RBN)
+      continue;
+
+    if (const auto cit { _entries.find(be.callsign()) }; cit != _entries.cend())
+    { if (be.frequency_difference(*cit) <= MAX_FREQUENCY_SKEW)      // ~same frequency; keep the old entry
+      { bandmap_entry old_be { *cit };
+
+        if (old_be.expiration_time() < be.expiration_time())     // new expiration is later
+        { old_be.source(BANDMAP_ENTRY_SOURCE::RBN);
+          old_be.expiration_time(be.expiration_time());         // NB: don't change time()
+        }
+
+        be = move(old_be);
+      }
+    }
+  }
+
+// pass 3: only one real entry may exist at a given QRG; the most recent arrival wins
+  UNORDERED_STRING_MAP<size_t> arrival_at_qrg;      // key = frequency_str; value = latest arrival at that QRG
+
+  for (const accepted_entry& ae : accepted)
+  { if (const auto it { arrival_at_qrg.find(ae.be.frequency_str()) }; it != arrival_at_qrg.end())
+      it -> second = max(it -> second, ae.arrival);
+    else
+      arrival_at_qrg.emplace(ae.be.frequency_str(), ae.arrival);
+  }
+
+  BM_ENTRIES     new_entries;
+  vector<string> removed_calls;                     // calls whose entries are removed by the run without being replaced
+
+  new_entries.reserve(accepted.size());
+
+  for (accepted_entry& ae : accepted)
+  { if (arrival_at_qrg.at(ae.be.frequency_str()) == ae.arrival)
+      new_entries += move(ae.be);
+    else
+      removed_calls += ae.be.callsign();
+  }
+
+  SR::stable_sort(new_entries, [] (const bandmap_entry& be1, const bandmap_entry& be2) { return be1.less_by_frequency(be2); });
+
+  FOR_ALL(new_entries, [this] (const bandmap_entry& be) { _schedule_expiry(be);
+                                                          _index_mult_keys(be);
+                                                        });
+
+// pass 4: merge with the existing entries, removing any existing entry for a call in the batch, and any real entry at a QRG in the batch
+  auto superseded { [&arrival_at_qrg, &posn_of_call, &removed_calls] (const bandmap_entry& be) { if (posn_of_call.contains(be.callsign()))
+                                                                                                     return true;
+
+                                                                                                   const bool displaced { be.is_not_marker() and arrival_at_qrg.contains(be.frequency_str()) };
+
+                                                                                                   if (displaced)
+                                                                                                     removed_calls += be.callsign();
+
+                                                                                                   return displaced;
+                                                                                                 } };
+
+  if (!new_entries.empty())
+  { _entries.merge(move(new_entries), superseded);
+    _views_version = -1;                            // one pass over the merged entries is cheaper than updating the views entry by entry
+  }
+
+  FOR_ALL(removed_calls, [this] (const string& callsign) { _unindex_mult_keys(callsign); });
+
+  for (const string& callsign : recent_in_run)
+    _recent_calls += callsign;
 }
 
 /*! \brief          Process an insertion queue, adding the elements to the bandmap, and writing to a window
@@ -1323,6 +2911,9 @@ void bandmap::process_insertion_queue(BANDMAP_INSERTION_QUEUE& biq, window& w)
 /*! \brief          Write a <i>bandmap</i> object to a window
     \param  win     window to which to write
     \return         the window
+
+    Only the cells that differ from those that this bandmap last wrote to <i>win</i> are rewritten.
+    The whole window is redrawn if it has been resized or if another bandmap has written to it since.
 */
 window& bandmap::write_to_window(window& win)
 { using enum WINDOW_ATTRIBUTES;
@@ -1346,10 +2937,10 @@ window& bandmap::write_to_window(window& win)
 
 // we are a more recent version, so display it
   const size_t     maximum_number_of_displayable_entries { (win.width() / COLUMN_WIDTH) * win.height() };
-  const BM_ENTRIES entries                               { displayed_entries() };    // automatically filter
+  const BM_ENTRIES& entries                              { _displayed_entries() };   // automatically filter
   const size_t     start_entry                           { (entries.size() > maximum_number_of_displayable_entries) ? column_offset() * win.height() : 0u };
 
-  win < WINDOW_CLEAR < (bandmap_frequency_up ? CURSOR_BOTTOM_LEFT : CURSOR_TOP_LEFT);
+  vector<drawn_cell> cells(maximum_number_of_displayable_entries);     // what the window should contain, in display order; default is blank
 
   size_t index { 0 };    // keep track of where we are in the bandmap
 
@@ -1358,10 +2949,7 @@ window& bandmap::write_to_window(window& win)
 
   for (const auto& be : entries)
   { if ( (index >= start_entry) and (index < (start_entry + maximum_number_of_displayable_entries) ) )
-    { const string      entry_str     { pad_right(pad_left(be.frequency_str(), 7) + SPACE + substring <string> (be.callsign(), 0, MAX_CALLSIGN_WIDTH), COLUMN_WIDTH) };
-      const string_view frequency_str { substring <string_view> (entry_str, 0, 7) };
-      const string_view callsign_str  { substring <string_view> (entry_str, 8) };
-      const bool        is_marker     { be.is_marker() };
+    { const bool is_marker { be.is_marker() };
 
       if (!found_my_marker and be.is_my_marker())
       { found_my_marker = true;
@@ -1402,17 +2990,6 @@ window& bandmap::write_to_window(window& win)
       if (is_marker)
         cpu = colours.add(COLOUR_WHITE, COLOUR_BLACK);    // colours for markers
 
-// work out where to start the display of this call
-      const unsigned int x { static_cast<unsigned int>( ( (index  - start_entry) / win.height()) * COLUMN_WIDTH ) };
-    
-// check that there's room to display the entire entry
-      if ((win.width() - x) < COLUMN_WIDTH)
-        break;
-
-// get the right y ordinate
-      const unsigned int y { static_cast<unsigned int>( (bandmap_frequency_up ? 0 + (index - start_entry) % win.height()
-                                                                              : (win.height() - 1) - (index - start_entry) % win.height() ) ) };
-
 // now work out the status colour
       PAIR_NUMBER_TYPE status_colour { colours.add(NOT_NEEDED_COLOUR, NOT_NEEDED_COLOUR) };                      // default
 
@@ -1432,24 +3009,89 @@ window& bandmap::write_to_window(window& win)
       const bool is_marked_entry { bandmap_show_marked_frequencies and is_marked_frequency(marked_frequency_ranges, be.mode(), be.freq()) };
 
 // switch to red if this is a marked frequency and we are showing marked frequencies
-      win < cursor(x, y) < colour_pair( is_marked_entry ? colours.add(MARKED_FG_COLOUR, MARKED_BG_COLOUR) : cpu );
+      cells[index - start_entry] = { pad_right(pad_left(be.frequency_str(), 7) + SPACE + substring <string> (be.callsign(), 0, MAX_CALLSIGN_WIDTH), COLUMN_WIDTH),
+                                     (is_marked_entry ? colours.add(MARKED_FG_COLOUR, MARKED_BG_COLOUR) : cpu),
+                                     status_colour,
+                                     cpu,
+                                     reverse
+                                   };
+    }
+
+    index++;
+  }
+
+// redraw everything if the layout has changed, or if some other bandmap has written to the window since we did
+  bool redraw_all { (_drawn_window != &win) or (_drawn_width != win.width()) or (_drawn_height != win.height()) or
+                    (_drawn_frequency_up != bandmap_frequency_up) or (_drawn_cells.size() != cells.size()) };
 
-      if (reverse)
+  { SAFELOCK(bandmap_window_owner);
+
+    const bandmap*& owner { bandmap_window_owner[&win] };
+
+    if (owner != this)
+    { owner = this;
+      redraw_all = true;
+    }
+  }
+
+  const PAIR_NUMBER_TYPE blank_colour { colours.add(win.fg(), win.bg()) };
+  const string           blank_str    (COLUMN_WIDTH, SPACE);
+
+  if (redraw_all)
+    win < WINDOW_CLEAR;
+
+  bool written { redraw_all };
+
+  for (size_t n { 0 }; n < cells.size(); ++n)
+  { const drawn_cell& cell { cells[n] };
+
+    if (redraw_all ? cell.text.empty() : (cell == _drawn_cells[n]))      // after a clear, blank cells need no output
+      continue;
+
+// work out where to start the display of this cell
+    const unsigned int x { static_cast<unsigned int>( (n / win.height()) * COLUMN_WIDTH ) };
+    
+// check that there's room to display the entire entry
+    if ((win.width() - x) < COLUMN_WIDTH)
+      break;
+
+// get the right y ordinate
+    const unsigned int y { static_cast<unsigned int>( (bandmap_frequency_up ? 0 + n % win.height()
+                                                                           : (win.height() - 1) - n % win.height() ) ) };
+
+    win < cursor(x, y);
+
+    if (cell.text.empty())                                      // an entry has gone from this cell
+      win < colour_pair(blank_colour) < blank_str;
+    else
+    { const string_view frequency_str { substring <string_view> (cell.text, 0, 7) };
+      const string_view callsign_str  { substring <string_view> (cell.text, 8) };
+
+      win < colour_pair(cell.frequency_colour);
+
+      if (cell.reverse)
         win < WINDOW_REVERSE;
 
       win < frequency_str;
 
-      if (reverse)
+      if (cell.reverse)
         win < WINDOW_NORMAL;
 
-      win < colour_pair(status_colour) < SPACE
-          < colour_pair(cpu) < callsign_str;
+      win < colour_pair(cell.status_colour) < SPACE
+          < colour_pair(cell.callsign_colour) < callsign_str;
     }
 
-    index++;
+    written = true;
   }
 
-  win.refresh();    // force the visual update ... do we really want this?
+  if (written)
+    win.refresh();
+
+  _drawn_cells        = move(cells);
+  _drawn_frequency_up = bandmap_frequency_up;
+  _drawn_height       = win.height();
+  _drawn_window       = &win;
+  _drawn_width        = win.width();
 
   _last_displayed_version = static_cast<int>(_version);    // operator= is deleted
 
@@ -1458,6 +3100,16 @@ window& bandmap::write_to_window(window& win)
   return win;
 }
 
+/*!  \brief             Add a call to the do-not-add list, without rebuilding the matcher
+     \param callsign    callsign or regex to add
+*/
+void bandmap::_add_to_do_not_add(const string_view callsign)
+{ if (_is_regex(callsign))
+    _do_not_add_regex += { callsign, regex( string { callsign } ) };
+  else
+    _do_not_add += callsign;
+}
+
 /*!  \brief             Add a call to the do-not-add list
      \param callsign    callsign or regex to add
 
@@ -1466,10 +3118,8 @@ window& bandmap::write_to_window(window& win)
 void bandmap::do_not_add(const string_view callsign)
 { SAFELOCK(_bandmap);
 
-  if (_is_regex(callsign))
-    _do_not_add_regex += { callsign, regex( string { callsign } ) };
-  else
-    _do_not_add += callsign;
+  _add_to_do_not_add(callsign);
+  _rebuild_do_not_add_matcher();
 
 // technically, we have changed the bandmap object; but we haven't changed anything visible, so don't mark dirty_entries() or _version
 }
@@ -1487,6 +3137,8 @@ void bandmap::remove_from_do_not_add(const string_view callsign)
   else
     _do_not_add -= callsign;
 
+  _rebuild_do_not_add_matcher();
+
 // technically, we have changed the bandmap object; but we haven't changed anything visible, so don't mark dirty_entries() or _version
 }
 
@@ -18,11 +18,15 @@
 #include "string_functions.h"
 
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <queue>
 #include <thread>
 
 #include <netinet/tcp.h>
+#include <poll.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace   chrono;           // std::chrono
@@ -32,8 +36,8 @@ using namespace   this_thread;      // std::this_thread
 extern bool           exiting;              ///< is the program exiting?
 extern message_stream ost;                  ///< for debugging and logging
 extern pt_mutex       thread_check_mutex;   ///< mutex for controlling threads
-extern int            type_1_post_counter;          ///< counter for type 1 posts
-extern int            type_2_post_counter;          ///< counter for type 1 posts
+extern atomic<int>    type_1_post_counter;          ///< counter for type 1 posts
+extern atomic<int>    type_2_post_counter;          ///< counter for type 2 posts
 
 pt_mutex monitored_posts_mutex { "MONITORED POSTS"s };         ///< mutex for the monitored posts
 pt_mutex rbn_buffer_mutex      { "RBN BUFFER"s };              ///< mutex for the RBN buffer
@@ -147,18 +151,39 @@ reconnect:
   _time_last_data_received = NOW_TP();  // reset the reception timer
 }
 
+/// wake the processing thread, which belongs to the parent if there is one
+void dx_cluster::_notify_new_lines(void)
+{ dx_cluster& target { _parent_p ? *_parent_p : *this };
+
+  { lock_guard<mutex> lg(target._new_lines_mtx);
+
+    target._new_lines = true;
+  }
+
+  target._new_lines_cv.notify_one();
+}
+
 /*! \brief              Constructor
     \param  context     the drlog context
     \param  src         whether this is a real DX cluster or the RBN
 */
 dx_cluster::dx_cluster(const drlog_context& context, const POSTING_SOURCE src) :
-  _connection(src == POSTING_SOURCE::CLUSTER ? context.cluster_server() : context.rbn_server(),     // create the connection
-              src == POSTING_SOURCE::CLUSTER ? context.cluster_port()   : context.rbn_port(),
-              context.my_ip()),
+  dx_cluster(context, src, (src == POSTING_SOURCE::CLUSTER ? context.cluster_server() : context.rbn_server()),
+                           (src == POSTING_SOURCE::CLUSTER ? context.cluster_port()   : context.rbn_port()))
+{ }
+
+/*! \brief              Constructor for a server other than the one in the context
+    \param  context     the drlog context
+    \param  src         whether this is a real DX cluster or the RBN
+    \param  server      name or IP address of the server
+    \param  port        server port
+*/
+dx_cluster::dx_cluster(const drlog_context& context, const POSTING_SOURCE src, const string& server, const unsigned int port) :
+  _connection(server, port, context.my_ip()),                                                       // create the connection
   _login_id(src == POSTING_SOURCE::CLUSTER ? context.cluster_username() : context.rbn_username()),  // choose the correct login name
   _my_ip(context.my_ip()),                                                                          // set my IP address
-  _port(src == POSTING_SOURCE::CLUSTER ? context.cluster_port() : context.rbn_port()),              // choose the correct port
-  _server(src == POSTING_SOURCE::CLUSTER ? context.cluster_server() : context.rbn_server()),        // choose the correct server
+  _port(port),
+  _server(server),
   _source(src),                                                                                     // set the source
   _timeout(CLUSTER_TIMEOUT)                                                                         // two-second timeout
 { 
@@ -175,9 +200,7 @@ dx_cluster::dx_cluster(const drlog_context& context, const POSTING_SOURCE src) :
     { buf = _connection.read(_timeout);
 
       if (!buf.empty())
-      { SAFELOCK(rbn_buffer);
-        _unprocessed_input += buf;
-      }
+        _input.append(buf);
       else
         sleep_for(2s);              // just in case we somehow read zero bytes from the connection: this *can* happen, even though it's not supposed to; match CLUSTER_TIMEOUT
     }
@@ -217,9 +240,8 @@ dx_cluster::dx_cluster(const drlog_context& context, const POSTING_SOURCE src) :
 dx_cluster::~dx_cluster(void)
 { _connection.send("BYE"s + CRLF);
   
-  { SAFELOCK(rbn_buffer);
-    _unprocessed_input = _connection.read(_timeout / 2);  // add a delay before we tear down the connection
-  }
+  _input.clear();
+  _input.append(_connection.read(_timeout / 2));  // add a delay before we tear down the connection
 }
 
 /*! \brief          Send a message to the cluster
@@ -276,60 +298,95 @@ bool dx_cluster::spot(const string_view msg)
   return send(spot_msg);
 }
 
-/// reset the cluster socket
+/*! \brief  Reset the cluster socket
+
+    Blocks until the connection has been re-established; does nothing if a reset is already in progress
+*/
 void dx_cluster::reset_connection(void)
-{ ost << "Attempting to reset connection" << endl;
+{ if (_resetting.exchange(true))
+  { ost << "Reset of connection already in progress" << endl;
+    return;
+  }
+
+  ost << "Attempting to reset connection" << endl;
+  _input.clear();                               // discard any partial line from the old connection, so that it is not joined to the first line from the new one
   _process_error();
+  _generation++;
+  _resetting = false;
   ost << "Completed reset of connection" << endl;
 }
 
-/*! \brief  Read from the cluster socket
+/*! \brief      Read, without waiting, whatever data are available on the cluster socket, and append them to <i>_input</i>
+    \return     whether the connection is still usable
 
-    Any data read from the socket are appended to <i>_unprocessed_input</i>
+    Wakes any thread in wait_for_new_lines() if a complete line has arrived. Does not attempt to reset a failed connection.
 */
-void dx_cluster::read(void)
-{ string buf;
-    
-  try
-  { buf = _connection.read(_timeout);
-  }
-    
-  catch (const socket_support_error& e)
-  { if (e.code() != SOCKET_SUPPORT_TIMEOUT)    // an error that is not a timeout has to be handled
-    {
-// error reading; try to reconnect
-      ost << "Error reading from socket; socket_support_error code = " << e.code() << " reason = " << e.reason() << "; attempting reconnection" << endl;
+bool dx_cluster::read_available(void)
+{ size_t n_bytes { 0 };
+  bool   rv      { true };
 
-      _process_error();
-    }  // be silent if it's just a timeout
+  try
+  { n_bytes = _connection.read_available(_input);
   }
 
   catch (const tcp_socket_error& e)
-  { ost << "TCP socket error in read(); tcp_socket_error code = " << e.code() << " reason = " << e.reason() << "; attempting reconnection" << endl;
+  { ost << "TCP socket error in read_available(); tcp_socket_error code = " << e.code() << " reason = " << e.reason() << endl;
 
-    _process_error();
+    rv = false;
   }
-  
-  if (!buf.empty())
-  { SAFELOCK(rbn_buffer);
 
-    _unprocessed_input += buf;
-    _time_last_data_received = NOW_TP();
+  if (n_bytes)
+  { { SAFELOCK(rbn_buffer);
+      _time_last_data_received = NOW_TP();
+    }
+
+    if (_input.has_complete_lines())           // wake the processing thread only for complete lines
+      _notify_new_lines();
   }
+
+  return rv;
 }
 
-/*! \brief      Read from the cluster socket
-    \return     the information that has been read from the socket but has not yet been processed
+/*! \brief          Move the complete lines that have been read from the socket, and from any feeds, to a buffer
+    \param  dest    buffer to receive the lines; any existing contents are discarded
+
+    Any trailing partial lines remain within the objects
 */
-string dx_cluster::get_unprocessed_input(void)
-{ string rv;
+void dx_cluster::move_complete_lines_to(line_buffer& dest)
+{ _input.move_complete_lines_to(dest);
 
-  { SAFELOCK(rbn_buffer);
+  lock_guard<mutex> lg(_feeds_mtx);
+
+  for (dx_cluster* feed_p : _feeds)
+    feed_p -> _input.append_complete_lines_to(dest);
+}
+
+/*! \brief          Process the lines from another cluster together with the lines from this one
+    \param  feed    the other cluster
+
+    <i>feed</i> must outlive this object
+*/
+void dx_cluster::add_feed(dx_cluster& feed)
+{ feed._parent_p = this;
+
+  lock_guard<mutex> lg(_feeds_mtx);
+
+  _feeds += &feed;
+}
+
+/*! \brief              Wait until complete lines have been read from the socket
+    \param  max_wait    maximum time to wait
+    \return             whether complete lines have arrived since the previous call
+
+    Returns immediately if lines have arrived since the previous call
+*/
+bool dx_cluster::wait_for_new_lines(const milliseconds max_wait)
+{ unique_lock<mutex> ul(_new_lines_mtx);
+
+  const bool rv { _new_lines_cv.wait_for(ul, max_wait, [this] (void) { return _new_lines; }) };
+
+  _new_lines = false;
 
-    rv = move(_unprocessed_input);
-    _unprocessed_input.clear();
-  }
-  
   return rv;
 }
 
@@ -344,6 +401,613 @@ string dx_cluster::to_string(void) const
   return rv;
 }
 
+// -----------  cluster_reactor  ----------------
+
+/*! \class  cluster_reactor
+    \brief  Read all the cluster and RBN connections in a single thread
+*/
+
+/*! \brief      Register the current socket of a cluster with the epoll, if the cluster is not being reset
+    \param  n   index of the cluster in <i>_registrations</i>
+*/
+void cluster_reactor::_register(const size_t n)
+{ registration& reg     { _registrations[n] };
+  dx_cluster&   cluster { *reg.cluster_p };
+
+  if (cluster.resetting())
+    return;
+
+  const int      fd         { cluster.socket_fd() };
+  const uint64_t generation { cluster.generation() };
+
+  if ( (reg.fd != -1) and (reg.generation == generation) )
+    _epoll -= reg.fd;          // not if the generation has changed: closing the old socket removed it, and its number may since have been reused
+
+  try
+  { cluster.non_blocking();
+    _epoll.add(fd, static_cast<uint64_t>(n));
+  }
+
+  catch (const x_error& e)
+  { ost << "Error registering cluster socket " << fd << " with reactor: " << e.reason() << endl;
+    reg.fd = -1;
+    return;
+  }
+
+  reg.fd = fd;
+  reg.generation = generation;
+  reg.awaiting_reset = false;
+}
+
+/// constructor; starts the reset thread
+cluster_reactor::cluster_reactor(void) :
+  _reset_worker( [this] (stop_token st) { _reset_connections(st); } )
+{ }
+
+/// reset the connection of a cluster in the reset thread
+void cluster_reactor::_reset(registration& reg)
+{ dx_cluster* cluster_p { reg.cluster_p };
+
+  if (cluster_p -> resetting())
+    return;
+
+  if (reg.fd != -1)
+  { _epoll -= reg.fd;
+    reg.fd = -1;
+  }
+
+  reg.awaiting_reset = true;
+
+  { lock_guard<mutex> lg(_reset_mtx);
+
+    _clusters_to_reset += cluster_p;            // the cluster is re-registered by poll() when the reset is complete
+  }
+
+  _reset_cv.notify_one();
+}
+
+/*! \brief          Body of the reset thread
+    \param  st      token that indicates that the thread should exit
+
+    Resets the connections one at a time, in the order in which they were requested
+*/
+void cluster_reactor::_reset_connections(stop_token st)
+{ while (true)
+  { dx_cluster* cluster_p { nullptr };
+
+    { unique_lock<mutex> ul(_reset_mtx);
+
+      if (!_reset_cv.wait(ul, st, [this] (void) { return !_clusters_to_reset.empty(); }))
+        return;                                 // stop has been requested
+
+      cluster_p = _clusters_to_reset.front();
+      _clusters_to_reset.pop_front();
+    }
+
+    cluster_p -> reset_connection();
+  }
+}
+
+/*! \brief  Stop the reset thread
+
+    Waits for any reset in progress to complete; no further resets are performed. Should be called before
+    exit, so that no connection is reset after the clusters have begun to be destroyed.
+*/
+void cluster_reactor::stop_resets(void)
+{ if (_reset_worker.joinable())
+  { _reset_worker.request_stop();
+    _reset_worker.join();
+  }
+}
+
+/*! \brief                  Add a cluster
+    \param  cluster         cluster to add; must outlive this object
+    \param  max_silence     time without data after which the connection is reset by this object
+
+    May be called from any thread
+*/
+void cluster_reactor::add(dx_cluster& cluster, const optional<seconds> max_silence)
+{ { lock_guard<mutex> lg(_mtx);
+
+    _registrations.push_back( { &cluster, -1, 0, max_silence } );
+  }
+
+  _epoll.wake();                // so that poll() registers the new cluster immediately
+}
+
+/*! \brief              Reset the connection of a cluster in the reset thread
+    \param  cluster     cluster whose connection is to be reset; does nothing if <i>cluster</i> has not been added
+
+    May be called from any thread
+*/
+void cluster_reactor::reset(const dx_cluster& cluster)
+{ lock_guard<mutex> lg(_mtx);
+
+  if (const auto it { FIND_IF(_registrations, [&cluster] (const registration& reg) { return (reg.cluster_p == &cluster); }) }; it != _registrations.end())
+    _reset(*it);
+}
+
+/*! \brief              Wait for, and then read, data from any of the clusters
+    \param  max_wait    maximum time to wait
+
+    Must be called repeatedly from just one thread
+*/
+void cluster_reactor::poll(const milliseconds max_wait)
+{
+// (re-)register any clusters that are new, or whose connections have been reset
+  { lock_guard<mutex> lg(_mtx);
+
+    for (size_t n { 0 }; n < _registrations.size(); ++n)
+    { const registration& reg { _registrations[n] };
+
+      if ( ( (reg.fd == -1) and !reg.awaiting_reset ) or (reg.generation != reg.cluster_p -> generation()) )
+        _register(n);
+    }
+  }
+
+  const vector<struct epoll_event> events { _epoll.wait(max_wait) };
+
+  lock_guard<mutex> lg(_mtx);
+
+  for (const auto& ev : events)
+  { if ( (ev.data.u64 == epoller::WAKE_TAG) or (ev.data.u64 >= _registrations.size()) )
+      continue;
+
+    registration& reg { _registrations[ev.data.u64] };
+
+    if ( (reg.fd == -1) or reg.cluster_p -> resetting() )     // stale event
+      continue;
+
+    const bool ok { reg.cluster_p -> read_available() };      // read any data, even if the far end has also hung up
+
+    if (!ok or (ev.events & (EPOLLERR | EPOLLHUP)))
+    { ost << "Connection failure on cluster socket " << reg.fd << "; resetting connection" << endl;
+      _reset(reg);
+    }
+  }
+
+// reset any connections that have been silent for too long
+  for (registration& reg : _registrations)
+  { if ( (reg.fd != -1) and reg.max_silence and (reg.cluster_p -> time_since_data_last_received() > reg.max_silence.value()) )
+    { ost << "No data received on cluster socket " << reg.fd << " for " << reg.max_silence.value().count() << " seconds; resetting connection" << endl;
+      _reset(reg);
+    }
+  }
+}
+
+// -----------  rbn_replay_server  ----------------
+
+/*! \class  rbn_replay_server
+    \brief  A stand-in for an RBN server on the loopback interface, which replays a file written to RBN FILE
+*/
+
+/*! \brief              Constructor
+    \param  lines       the lines to be replayed
+    \param  speedup     factor by which the replay is to be faster than real time; 0 => as fast as possible
+
+    Starts listening on an ephemeral port on the loopback interface; throws a socket_support_error if this is not possible
+*/
+rbn_replay_server::rbn_replay_server(const vector<string>& lines, const double speedup) :
+  _lines(lines),
+  _speedup(speedup)
+{
+// the minute of each line, from its HHMMZ field; a line without a time is sent with the preceding line
+  vector<int> minutes(_lines.size(), 0);
+
+  int  minute        { 0 };
+  int  day_offset    { 0 };             // to allow the replay to cross midnight
+  bool seen_a_minute { false };
+
+  for (size_t n { 0 }; n < _lines.size(); ++n)
+  { const string_view trimmed { remove_trailing_spaces <string_view> (_lines[n]) };
+    const string_view last    { trimmed.substr(trimmed.find_last_of(SPACE) + 1) };    // npos + 1 == 0
+
+    if ( (last.length() == 5) and (last[4] == 'Z') and is_digits(last.substr(0, 4)) )
+    { int this_minute { (from_string<int>(last.substr(0, 2)) * 60) + from_string<int>(last.substr(2, 2)) + day_offset };
+
+      if (seen_a_minute and (this_minute < minute - 720))   // assume that the time has passed midnight
+      { day_offset += 1'440;
+        this_minute += 1'440;
+      }
+
+      minute = this_minute;
+
+      if (!seen_a_minute)
+      { fill_n(minutes.begin(), n, minute);                 // lines before the first time are sent at the start
+        seen_a_minute = true;
+      }
+    }
+
+    minutes[n] = minute;
+  }
+
+// spread the lines in each minute evenly across it
+  const int first_minute { minutes.empty() ? 0 : minutes.front() };
+
+  _schedule.reserve(_lines.size());
+
+  for (size_t n { 0 }; n < minutes.size(); )
+  { size_t end { n };
+
+    while ( (end < minutes.size()) and (minutes[end] == minutes[n]) )
+      end++;
+
+    for (size_t m { n }; m < end; ++m)
+    { const double real_minutes { (minutes[m] - first_minute) + (static_cast<double>(m - n) / static_cast<double>(end - n)) };
+
+      _schedule.push_back( (_speedup > 0) ? microseconds(static_cast<int64_t>(real_minutes * 60'000'000 / _speedup)) : microseconds::zero() );
+    }
+
+    n = end;
+  }
+
+// listen on the loopback interface
+  _listen_fd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+  if (_listen_fd == -1)
+    throw socket_support_error(SOCKET_SUPPORT_LISTEN_ERROR, "Unable to create socket for RBN replay server: "s + strerror(errno));
+
+  sockaddr_storage adr { socket_address(htonl(INADDR_LOOPBACK), 0) };
+  socklen_t        adr_len { sizeof(sockaddr_in) };
+
+  if ( (::bind(_listen_fd, reinterpret_cast<sockaddr*>(&adr), adr_len) == -1) or (::listen(_listen_fd, 1) == -1) or
+       (::getsockname(_listen_fd, reinterpret_cast<sockaddr*>(&adr), &adr_len) == -1) )
+  { const string msg { "Unable to listen for RBN replay connection: "s + strerror(errno) };
+
+    ::close(_listen_fd);
+    throw socket_support_error(SOCKET_SUPPORT_LISTEN_ERROR, msg);
+  }
+
+  _port = ntohs(reinterpret_cast<sockaddr_in*>(&adr) -> sin_port);
+}
+
+/// destructor
+rbn_replay_server::~rbn_replay_server(void)
+{ if (_thread.joinable())
+  { _thread.request_stop();
+    _thread.join();
+  }
+
+  ::close(_listen_fd);
+}
+
+/// start serving the connection, in a separate thread
+void rbn_replay_server::start(void)
+{ _thread = jthread( [this] (stop_token st) { _serve(st); } );
+}
+
+/// serve the connection
+void rbn_replay_server::_serve(stop_token st)
+{ constexpr int POLL_MS { 100 };            // how often to check for a request to stop while waiting
+
+  pollfd pfd { _listen_fd, POLLIN, 0 };
+
+  while (!st.stop_requested() and (::poll(&pfd, 1, POLL_MS) <= 0))
+    ;
+
+  if (st.stop_requested())
+    return;
+
+  const int fd { ::accept(_listen_fd, nullptr, nullptr) };
+
+  if (fd == -1)
+  { ost << "Error accepting RBN replay connection: " << strerror(errno) << endl;
+    return;
+  }
+
+  auto send_all { [fd] (const string_view msg) { for (size_t sent { 0 }; sent < msg.length(); )
+                                                 { const ssize_t status { ::send(fd, msg.data() + sent, msg.length() - sent, MSG_NOSIGNAL) };
+
+                                                   if (status == -1)
+                                                     return false;
+
+                                                   sent += static_cast<size_t>(status);
+                                                 }
+
+                                                 return true;
+                                               } };
+
+// the client logs in as soon as it receives anything; the login itself is ignored
+  send_all("Please enter your call:\r\n"sv);
+
+  const auto start { steady_clock::now() };
+
+  ost << "RBN replay: sending " << _lines.size() << " lines at speedup " << _speedup << endl;
+
+  for (size_t n { 0 }; (n < _lines.size()) and !st.stop_requested(); ++n)
+  { sleep_until(start + _schedule[n]);
+
+    { lock_guard<mutex> lg(_mtx);
+
+      const TIME_POINT now { NOW_TP() };
+
+      if (n == 0)
+        _first_sent = now;
+
+      _unmatched_send_times[_lines[n]].push_back(now);    // record before sending, so that the receiver always finds the time
+      _n_sent++;
+    }
+
+    if (!send_all(_lines[n] + CRLF))
+    { ost << "RBN replay: error sending line " << n << ": " << strerror(errno) << endl;
+      break;
+    }
+  }
+
+  ost << "RBN replay: all lines sent" << endl;
+
+  while (!st.stop_requested())                                    // keep the connection open, so that the client does not try to reconnect
+    sleep_for(milliseconds(POLL_MS));
+
+  ::close(fd);
+}
+
+/*! \brief          Record the lines that are about to be processed in a pass
+    \param  lines   the lines
+
+    Lines that were not sent by the server (or that have already been recorded) are ignored
+*/
+void rbn_replay_server::lines_received(const line_buffer& lines)
+{ lock_guard<mutex> lg(_mtx);
+
+  for (const string_view line : lines.lines())
+  { if (auto it { _unmatched_send_times.find(line) }; it != _unmatched_send_times.end())
+    { _pass_send_times.push_back(it -> second.front());
+      it -> second.pop_front();
+
+      if (it -> second.empty())
+        _unmatched_send_times.erase(it);
+    }
+  }
+}
+
+/*! \brief                  Record the end of a pass
+    \param  queue_depth     number of entries in the bandmap insertion queues before they were processed
+    \return                 whether this pass completed the replay
+*/
+bool rbn_replay_server::pass_complete(const size_t queue_depth)
+{ lock_guard<mutex> lg(_mtx);
+
+  if (_pass_send_times.empty())
+    return false;
+
+  const TIME_POINT now { NOW_TP() };
+
+  for (const TIME_POINT sent : _pass_send_times)
+    _latencies.push_back(duration_cast<microseconds>(now - sent));
+
+  _n_passes++;
+  _n_matched += _pass_send_times.size();
+  _max_lines_per_pass = max(_max_lines_per_pass, _pass_send_times.size());
+  _max_queue_depth = max(_max_queue_depth, queue_depth);
+  _last_processed = now;
+  _pass_send_times.clear();
+
+  return (_n_matched == _lines.size());
+}
+
+/// human-readable report of the replay
+string rbn_replay_server::report(void) const
+{ lock_guard<mutex> lg(_mtx);
+
+  vector<microseconds> latencies { _latencies };
+
+  SORT(latencies);
+
+  auto percentile_ms { [&latencies] (const double pc) { if (latencies.empty())
+                                                          return 0.0;
+
+                                                        const size_t index { min(latencies.size() - 1, static_cast<size_t>(pc / 100 * static_cast<double>(latencies.size()))) };
+
+                                                        return (static_cast<double>(latencies[index].count()) / 1'000);
+                                                      } };
+
+  const double elapsed_secs { (_n_matched ? duration_cast<duration<double>>(_last_processed - _first_sent).count() : 0.0) };
+  const double mean_lines   { (_n_passes ? (static_cast<double>(_n_matched) / static_cast<double>(_n_passes)) : 0.0) };
+
+  string rv { "RBN replay report"s + EOL };
+
+  rv += "  lines in file: "s + ::to_string(_lines.size()) + "; sent: "s + ::to_string(_n_sent) + "; processed: "s + ::to_string(_n_matched) + EOL;
+  rv += "  speedup: "s + ((_speedup > 0) ? ::to_string(_speedup) : "maximum"s) + "; elapsed time: "s + ::to_string(elapsed_secs) + " seconds"s + EOL;
+  rv += "  posts processed per second: "s + ::to_string( (elapsed_secs > 0) ? (static_cast<double>(_n_matched) / elapsed_secs) : 0.0) + EOL;
+  rv += "  passes: "s + ::to_string(_n_passes) + "; lines per pass: mean = "s + ::to_string(mean_lines) + ", maximum = "s + ::to_string(_max_lines_per_pass) + EOL;
+  rv += "  maximum bandmap insertion queue depth: "s + ::to_string(_max_queue_depth) + EOL;
+  rv += "  spot-to-bandmap latency (ms): p50 = "s + ::to_string(percentile_ms(50)) + ", p90 = "s + ::to_string(percentile_ms(90)) +
+        ", p99 = "s + ::to_string(percentile_ms(99)) + ", maximum = "s + ::to_string(percentile_ms(100)) + EOL;
+
+  return rv;
+}
+
+// -----------  line_classifier  ----------------
+
+/*! \class  line_classifier
+    \brief  Classify lines by the patterns that they contain, in a single pass
+*/
+
+/*! \brief              Constructor
+    \param  patterns    patterns and the class of line that contains each of them
+
+    Empty patterns are ignored
+*/
+line_classifier::line_classifier(const vector<pair<string, LINE_CLASS>>& patterns)
+{
+// build the trie; a zero transition means that there is no child
+  for (const auto& [pattern, lc] : patterns)
+  { if (pattern.empty())
+      continue;
+
+    uint32_t state { 0 };
+
+    for (const unsigned char c : pattern)
+    { if (_transitions[state * ALPHABET_SIZE + c] == 0)
+      { const uint32_t new_state { static_cast<uint32_t>(_outputs.size()) };
+
+        _outputs.push_back(LINE_CLASS::NORMAL);
+        _transitions.resize(_transitions.size() + ALPHABET_SIZE, 0);
+        _transitions[state * ALPHABET_SIZE + c] = new_state;
+      }
+
+      state = _transitions[state * ALPHABET_SIZE + c];
+    }
+
+    _outputs[state] = max(_outputs[state], lc);
+    _max_class = max(_max_class, lc);
+  }
+
+// breadth-first, add the failure transitions, so that every state has a transition for every character
+  vector<uint32_t> failure(_outputs.size(), 0);
+  queue<uint32_t>  q;
+
+  for (size_t c { 0 }; c < ALPHABET_SIZE; ++c)
+    if (const uint32_t child { _transitions[c] }; child)
+      q.push(child);                                        // the failure state of a child of the root is the root
+
+  while (!q.empty())
+  { const uint32_t state { q.front() };
+
+    q.pop();
+
+    _outputs[state] = max(_outputs[state], _outputs[failure[state]]);   // a pattern that is a suffix of this one also ends here
+
+    for (size_t c { 0 }; c < ALPHABET_SIZE; ++c)
+    { const uint32_t fail_next { _transitions[failure[state] * ALPHABET_SIZE + c] };
+
+      if (const uint32_t child { _transitions[state * ALPHABET_SIZE + c] }; child)
+      { failure[child] = fail_next;
+        q.push(child);
+      }
+      else
+        _transitions[state * ALPHABET_SIZE + c] = fail_next;
+    }
+  }
+}
+
+/*! \brief          Classify a line
+    \param  line    line to classify
+    \return         the class of <i>line</i>
+*/
+LINE_CLASS line_classifier::operator()(const string_view line) const
+{ if (_max_class == LINE_CLASS::NORMAL)       // no patterns
+    return LINE_CLASS::NORMAL;
+
+  LINE_CLASS rv    { LINE_CLASS::NORMAL };
+  uint32_t   state { 0 };
+
+  for (const unsigned char c : line)
+  { state = _transitions[state * ALPHABET_SIZE + c];
+    rv = max(rv, _outputs[state]);
+
+    if (rv == _max_class)                     // can't get any higher
+      break;
+  }
+
+  return rv;
+}
+
+// -----------  post_fields  ----------------
+
+/*! \class  post_fields
+    \brief  The fields of a line from a cluster or the RBN, located in a single pass
+*/
+
+/*! \brief                  Constructor
+    \param  line            a line received from the cluster or RBN
+    \param  post_source     the origin of the line
+
+    Only HF posts are recognised
+*/
+post_fields::post_fields(const string_view line, const enum POSTING_SOURCE post_source) :
+  _line(line)
+{ size_t posn { 0 };                            // current position in the line
+
+  auto skip_spaces { [&line, &posn] (void) { while ( (posn < line.length()) and (line[posn] == SPACE) )
+                                               posn++;
+                                           } };
+
+// the next run of non-space characters
+  auto next_token { [&line, &posn, &skip_spaces] (void) { skip_spaces();
+
+                                                          const size_t start { posn };
+
+                                                          while ( (posn < line.length()) and (line[posn] != SPACE) )
+                                                            posn++;
+
+                                                          return line.substr(start, posn - start);
+                                                        } };
+
+// set the frequency; returns whether it's an HF frequency
+  auto hf_frequency { [this] (const string_view str) { _frequency_str = str;
+                                                       _freq = frequency(_frequency_str);
+
+                                                       return ( (_freq >= 1'800_kHz) and (_freq <= 29'700_kHz) );
+                                                     } };
+
+// 18073.1  P49V        29-Dec-2009 1931Z  nice signal NW            <N7XR>
+  if (last_char(line) == RIGHT_ANGLE_BRACKET)
+  { if (const string_view freq_str { next_token() }; !freq_str.empty() and isdigit(freq_str[0]) and hf_frequency(freq_str))
+    { _callsign = next_token();
+
+      next_token();                             // date
+      next_token();                             // time
+      skip_spaces();
+
+      if (const size_t bra_posn { line.find_last_of(LEFT_ANGLE_BRACKET) }; (bra_posn != string_view::npos) and (bra_posn >= posn) and !_callsign.empty())
+      { _comment = line.substr(posn, bra_posn - posn);
+        _poster = line.substr(bra_posn + 1, line.length() - bra_posn - 2);
+        _format = POST_FORMAT::SH_DX;
+
+        return;
+      }
+    }
+  }
+
+// RBN posting
+// DX de DK9IP-#:      7006.0  LA3MHA       CQ    21 dB 24 WPM             2257Z JN48
+
+// ordinary posting
+// DX de RX9WN:      3512.0  UE9WFJ       see UE9WURC  QRZ.COM           1932Z
+  if ( (line.length() <= 70) or !line.starts_with("DX de "sv) )
+    return;
+
+  constexpr size_t START_POSN { 6 };            // just after "DX de "
+
+  if (post_source == POSTING_SOURCE::RBN)
+  { posn = START_POSN;
+
+    const string_view poster_str { next_token() };
+    const string_view freq_str   { next_token() };
+    const string_view call_str   { next_token() };
+    const string_view mode_str   { next_token() };
+
+    if (!mode_str.empty() and hf_frequency(freq_str))   // an empty mode means that there are fewer than four fields
+    { _poster = poster_str.substr(0, poster_str.length() - 1);      // remove colon
+      _callsign = call_str;
+      _mode_str = mode_str;
+      _format = POST_FORMAT::DX_DE;
+
+      return;
+    }
+  }
+
+// we treat everything after the call as a comment
+  posn = START_POSN;
+  skip_spaces();
+
+  if (const size_t colon_posn { line.find(COLON, posn) }; colon_posn != string_view::npos)
+  { _poster = line.substr(posn, colon_posn - posn);
+    posn = colon_posn + 1;
+
+    if (hf_frequency(next_token()))
+    { _callsign = next_token();
+      skip_spaces();
+      _comment = line.substr(posn);
+
+      if (!_callsign.empty())
+        _format = POST_FORMAT::DX_DE;
+    }
+  }
+}
+
 // -----------  dx_post  ----------------
 
 /*! \class  dx_post
@@ -525,6 +1189,58 @@ dx_post::dx_post(const string_view received_info, location_database& db, const e
     _band = static_cast<BAND>(_freq);
 }
 
+/*! \brief                  Construct from the fields of a line
+    \param  fields          the fields of a line received from the cluster or RBN
+    \param  db              the location database for this contest
+    \param  post_source     the origin of the post
+
+    Owning strings are created only once the fields have passed the cheap validity checks
+*/
+dx_post::dx_post(const post_fields& fields, location_database& db, const enum POSTING_SOURCE post_source) :
+  _source(post_source),
+  _valid(false)
+{ switch (fields.format())
+  { case POST_FORMAT::NONE :
+    { if (fields.line().length() <= 70)
+        ost << "received short post: " << fields.line() << endl;
+      return;
+    }
+
+    case POST_FORMAT::SH_DX :
+      type_1_post_counter++;
+      break;
+
+    case POST_FORMAT::DX_DE :
+      type_2_post_counter++;
+      break;
+  }
+
+// sanity check for the callsign
+  if (fields.callsign().find_first_not_of(CALLSIGN_CHARS) != string_view::npos)
+    return;
+
+  _callsign = fields.callsign();
+
+  const location_info li { db.info(_callsign) };
+
+  _canonical_prefix = li.canonical_prefix();
+
+// check that it's not blocked
+  if (blocked_posts.contains(_canonical_prefix))
+    return;
+
+  _continent = li.continent();
+  _freq = fields.freq();
+  _frequency_str = ( (fields.format() == POST_FORMAT::SH_DX) ? string { fields.frequency_str() } : _freq.display_string() );  // normalise the _frequency_str for DX de posts; some posters use two decimal places
+  _comment = fields.comment();
+  _mode_str = fields.mode_str();
+  _poster = fields.poster();
+  _poster_continent = db.info(_poster).continent();
+  _band = static_cast<BAND>(_freq);
+  _time_processed = NOW_TP();
+  _valid = true;
+}
+
 /// canonical prefixes for which stations will be blocked
 FLAT_STRING_SET dx_post::blocked_posts { };
 
@@ -551,6 +1267,169 @@ ostream& operator<<(ostream& ost, const dx_post& dxp)
   return ost;
 }
 
+// -----------  post_parser  ----------------
+
+/*! \class  post_parser
+    \brief  A small pool of threads that turns lines from a cluster or the RBN into posts
+*/
+
+/*! \brief              Constructor
+    \param  db          location database used to parse posts
+    \param  src         source of the lines
+    \param  n_workers   number of worker threads, in addition to the calling thread
+    \param  correct     static correction to apply to each post, in the worker thread
+*/
+post_parser::post_parser(location_database& db, const POSTING_SOURCE src, const unsigned int n_workers, CORRECTION_FUN correct) :
+  _db(db),
+  _source(src),
+  _correct(move(correct))
+{ for (unsigned int n { 0 }; n < n_workers; ++n)
+    _workers.emplace_back( [this] (stop_token st) { _worker(st); } );
+}
+
+/*! \brief          Parse a single line
+    \param  line    line to parse
+    \return         the corresponding post; empty if the line could not be parsed
+*/
+optional<dx_post> post_parser::_parse(const string_view line) const
+{ try
+  { dx_post post { post_fields { line, _source }, _db, _source };
+
+    if (_correct)
+      _correct(post);
+
+    return post;
+  }
+
+  catch (const location_error& e)          // e.g., too many slashes in the call
+  { ost << "Error processing post: " << line << "; location_error code = " << e.code() << ", reason = " << e.reason() << endl;
+    return nullopt;
+  }
+
+  catch (const exception& e)              // this runs in a worker thread, so nothing may escape
+  { ost << "Error processing post: " << line << "; exception: " << e.what() << endl;
+    return nullopt;
+  }
+
+  catch (...)
+  { ost << "Error processing post: " << line << "; unknown exception" << endl;
+    return nullopt;
+  }
+}
+
+/// claim and parse lines from the current batch until none remain
+void post_parser::_parse_batch(void)
+{ const vector<string_view>&  lines   { *_lines_p };
+  vector<optional<dx_post>>& results { *_results_p };
+
+  for (size_t n { _next++ }; n < lines.size(); n = _next++)
+    results[n] = _parse(lines[n]);
+}
+
+/*! \brief          Body of a worker thread
+    \param  st      token that indicates that the worker should exit
+*/
+void post_parser::_worker(stop_token st)
+{ uint64_t last_batch_nr { 0 };
+
+  while (true)
+  { { unique_lock<mutex> ul(_mtx);
+
+      if (!_work_cv.wait(ul, st, [this, &last_batch_nr] (void) { return (_batch_nr != last_batch_nr); }))
+        return;                             // stop has been requested
+
+      last_batch_nr = _batch_nr;
+    }
+
+    _parse_batch();
+
+    { lock_guard<mutex> lg(_mtx);
+
+      _n_done++;
+    }
+
+    _done_cv.notify_one();
+  }
+}
+
+/*! \brief          Parse a batch of lines
+    \param  lines   lines to parse; none may be empty
+    \return         the posts, in the same order as <i>lines</i>
+
+    An element of the returned vector is empty if the corresponding line could not be processed.
+    Must not be called simultaneously from more than one thread.
+*/
+vector<optional<dx_post>> post_parser::operator()(const vector<string_view>& lines)
+{ vector<optional<dx_post>> rv(lines.size());
+
+  if ( _workers.empty() or (lines.size() < MIN_PARALLEL_BATCH) )     // not worth waking the workers
+  { for (size_t n { 0 }; n < lines.size(); ++n)
+      rv[n] = _parse(lines[n]);
+
+    return rv;
+  }
+
+  { lock_guard<mutex> lg(_mtx);
+
+    _lines_p = &lines;
+    _results_p = &rv;
+    _next = 0;
+    _n_done = 0;
+    _batch_nr++;
+  }
+
+  _work_cv.notify_all();
+
+  _parse_batch();                             // this thread does its share too
+
+  { unique_lock<mutex> ul(_mtx);
+
+    _done_cv.wait(ul, [this] (void) { return (_n_done == _workers.size()); });   // every worker must have finished before rv is returned
+  }
+
+  return rv;
+}
+
+// -----------  post_coalescer  ----------------
+
+/*! \class  post_coalescer
+    \brief  Merge posts of the same call on the same band and (nearly) the same frequency
+*/
+
+/*! \brief          Add a post
+    \param  post    post to add
+
+    <i>post</i> is merged with the most recent post of the same call on the same band if their frequencies are within <i>_max_skew</i>
+*/
+void post_coalescer::operator+=(const dx_post& post)
+{ _n_posts++;
+
+  const pair<BAND, string> key { post.band(), post.callsign() };
+
+  if (const auto it { _latest.find(key) }; it != _latest.end())
+  { coalesced_post& cp { _posts[it -> second] };
+
+    if (cp.post.freq().difference(post.freq()) <= _max_skew)
+    { cp.post = post;                                   // the most recent post has the most recent frequency
+
+      if (!contains(cp.posters, post.poster()))
+        cp.posters += post.poster();
+
+      return;
+    }
+  }
+
+  _latest[key] = _posts.size();
+  _posts.push_back( { post, { post.poster() } } );
+}
+
+/// remove all the posts
+void post_coalescer::clear(void)
+{ _posts.clear();
+  _latest.clear();
+  _n_posts = 0;
+}
+
 // -----------  monitored_posts_entry  ----------------
 
 /*! \class  monitored_posts_entry
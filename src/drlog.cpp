@@ -141,6 +141,8 @@ QSO    allow_for_callsign_mults(QSO&& qso);
 void   archive_data(void);                                                          ///< Send data to the archive file
 void   audio_error_alert(const string_view msg);                                    ///< Alert the user to an audio-related error
 
+void   benchmark_post_parsing(const string_view filename);                          ///< Compare the speeds of the two post parsers over a recorded RBN file
+void   prepare_rbn_replay(const command_line& cl);                                  ///< Create the server for -rbn-replay
 string bearing(const string_view callsign);                                         ///< Return the bearing to a station
 string build_rit_xit_str(const polled_status& status);                              ///< Build the rit_xit_str string to be displayed
 
@@ -275,16 +277,17 @@ void auto_backup(const string dir, const string log_filename, const string qtc_f
 void auto_screenshot(const string filename);                                                ///< Write a screenshot to a file
 void display_rig_status(const milliseconds poll_time, rig_interface* rigp);                 ///< Display status of the rig
 void display_date_and_time(void);                                                           ///< Thread function to display the date and time, and perform other periodic functions
-void get_cluster_info(dx_cluster* cluster_p);                                               ///< Thread function to obtain data from the cluster or RBN
 void get_indices(const string cmd);                                                         ///< Get SFI, A, K
 void keyboard_test(void);                                                                   ///< Thread function to simulate keystrokes
 void process_rbn_info(window* wclp, window* wcmp, dx_cluster* dcp, running_statistics* statistics_p,
                       location_database* location_database_p, window* win_bandmap_p, BANDMAPS* bandmaps_p);       ///< Thread function to process data from the cluster or the RBN
-void prune_bandmap(window* wp, array<bandmap, NUMBER_OF_BANDS>* bandmaps);                                        ///< Thread function to prune the bandmaps once per minute
-void reset_connection(dx_cluster* rbn_p);                                                   ///< Thread function to reset the RBN or cluster connection
+void prune_bandmap(window* wp, array<bandmap, NUMBER_OF_BANDS>* bandmaps);                                        ///< Thread function to prune the bandmaps once per second
+void read_cluster_connections(void);                                                        ///< Thread function to read all the cluster and RBN connections
 void simulator_thread(string, int);                                                         ///< Thread function to simulate a contest from an extant log
 void spawn_dx_cluster(void);                                                                ///< Thread function to spawn the cluster
+void spawn_extra_rbn_feed(const string server, const unsigned int port);                    ///< Thread function to spawn an additional RBN-style feed
 void spawn_rbn(void);                                                                       ///< Thread function to spawn the RBN
+void spawn_rbn_replay(void);                                                                ///< Thread function to spawn the RBN from the replay server
 
 // values that are used by multiple threads
 // mostly these are essentially RO, so locking is overkill; but we do it anyway,
@@ -463,8 +466,10 @@ int                     ssb_centre_wide      { 1500 };      ///< wide SSB bandwi
 running_statistics      statistics;                         ///< all the QSO statistics to date
 
 map<thread::id, string> thread_map          { };            ///< map C++ thread_id to thread name
-constinit int           type_1_post_counter { 0 };          ///< counter for type 1 posts
-constinit int           type_2_post_counter { 0 };          ///< counter for type 1 posts
+constinit atomic<int>   type_1_post_counter { 0 };          ///< counter for type 1 posts; incremented by the post_parser workers
+constinit atomic<int>   type_2_post_counter { 0 };          ///< counter for type 2 posts; incremented by the post_parser workers
+constinit atomic<uint64_t> n_posts_coalesced          { 0 };   ///< number of posts that reached the coalescer
+constinit atomic<uint64_t> n_bandmap_insertions_saved { 0 };   ///< number of bandmap insertions avoided by coalescing posts
 
 bool                    wicm_calls_is_dirty  { false };     ///< whether there has been a change requiring redisplay to wicm_calls  
 size_t                  wicm_calls_size      { 0 };         ///< maximum number of calls in the WICM window
@@ -574,6 +579,9 @@ drmaster    drm_db    { };              ///< the drmaster database
 dx_cluster* cluster_p { nullptr };      ///< pointer to cluster information
 dx_cluster* rbn_p     { nullptr };      ///< pointer to RBN information
 
+cluster_reactor    cluster_io;                      ///< reads all the cluster and RBN connections
+rbn_replay_server* rbn_replay_p { nullptr };        ///< local stand-in for the RBN, if -rbn-replay is present
+
 const drmaster& drm_cdb { drm_db };     ///< const version of the drmaster database
 
 location_database location_db;              ///< global location database
@@ -1094,6 +1102,9 @@ int main(int argc, char** argv)
     scp_dbs += scp_dynamic_db;    // add the (empty) dynamic SCP database
 
 // build fuzzy database from the drmaster information
+    fuzzy_db.insertions_and_deletions(context.fuzzy_insertions_and_deletions());
+    fuzzy_dynamic_db.insertions_and_deletions(context.fuzzy_insertions_and_deletions());
+
     try
     { fuzzy_db.init_from_calls(drm_cdb.calls());
     }
@@ -1110,7 +1121,7 @@ int main(int argc, char** argv)
     try
     { ac_db.init_from_calls(drm_cdb.calls());
 
-      ost << "number of calls in autocorrect database = " << css(ac_db.n_calls()) << endl;
+      ost << "number of calls in autocorrect database = " << css(ac_db.n_calls()) << "; number of indexed busts = " << css(ac_db.n_busts()) << endl;
       ost << "autocorrect is " << (autocorrect_rbn ? "ON"s : "OFF"s) << endl;
     }
 
@@ -1185,6 +1196,14 @@ int main(int argc, char** argv)
       if (cl.value_present("-test-exchanges"sv))
         test_exchange_templates(rules, cl.value("-test-exchanges"sv));
 
+// possibly benchmark the parsing of posts; this will exit if it executes
+      if (cl.value_present("-benchmark-posts"sv))
+        benchmark_post_parsing(cl.value("-benchmark-posts"sv));
+
+// possibly replay a recorded RBN file instead of connecting to the cluster and the RBN
+      if (cl.value_present("-rbn-replay"sv))
+        prepare_rbn_replay(cl);
+
 // real-time statistics
       try
       { statistics.prepare(country_data, context, rules);
@@ -1312,12 +1331,13 @@ int main(int argc, char** argv)
           exit(-1);
         }
 
-        for (const auto& callsign : calls_from_do_not_show_file(ALL_BANDS))
-          FOR_ALL(bandmaps, [&callsign] (bandmap& bm) { bm.do_not_add(callsign); } );
+        const STRING_SET all_band_calls { calls_from_do_not_show_file(ALL_BANDS) };
+
+        FOR_ALL(bandmaps, [&all_band_calls] (bandmap& bm) { bm.do_not_add(all_band_calls); } );     // add the whole container, so that the matcher is built just once
 
 // now the individual bands
         for (BAND b { MIN_BAND }; b <= MAX_BAND; b = (BAND)((int)b + 1))
-          FOR_ALL(calls_from_do_not_show_file(b), [&bm = bandmaps[static_cast<unsigned int>(b)]] (const auto& callsign) { bm.do_not_add(callsign); });
+          bandmaps[static_cast<unsigned int>(b)].do_not_add(calls_from_do_not_show_file(b));
       }
 
 // set the RBN threshold for each bandmap
@@ -1982,12 +2002,22 @@ int main(int argc, char** argv)
       }
 
 // now we can start the cluster/RBN threads, since we know what we've worked if this was a rebuild
-      if (!context.cluster_server().empty() and !context.cluster_username().empty() and !context.my_ip().empty())
-        jthread(spawn_dx_cluster).detach();
+      const bool use_cluster { !context.cluster_server().empty() and !context.cluster_username().empty() and !context.my_ip().empty() };
+      const bool use_rbn     { !context.rbn_server().empty() and !context.rbn_username().empty() and !context.my_ip().empty() };
+
+      if (use_cluster or use_rbn or rbn_replay_p)
+        jthread(read_cluster_connections).detach();       // a single thread reads all the connections
+
+      if (rbn_replay_p)                                   // a replay replaces both the cluster and the RBN
+        jthread(spawn_rbn_replay).detach();
+      else
+      { if (use_cluster)
+          jthread(spawn_dx_cluster).detach();
 
 // ditto for the RBN
-      if (!context.rbn_server().empty() and !context.rbn_username().empty() and !context.my_ip().empty())
-        jthread(spawn_rbn).detach();
+        if (use_rbn)
+          jthread(spawn_rbn).detach();
+      }
 
       enter_sap_mode();                                       // explicitly enter SAP mode
       win_call <= CURSOR_START_OF_LINE;    // explicitly force the cursor into the call window
@@ -2490,7 +2520,9 @@ void display_rig_status(const milliseconds poll_period, rig_interface* rigp)
 /*! \brief  Thread to process data from the cluster or the RBN.
 
     Must start the thread to obtain data before trying to process it with this one;
-    pulls the data from the cluster object [and removes those data from it]
+    pulls the data from the cluster object [and removes those data from it].
+    A pass starts as soon as new lines arrive, after waiting for the coalescing window so that
+    screen updates are batched
 */
 void process_rbn_info(window* wclp, window* wcmp, dx_cluster* dcp, running_statistics* statistics_p, location_database* location_database_p, window* win_bandmap_p, BANDMAPS* bandmaps_p)
 { using enum WINDOW_ATTRIBUTES;
@@ -2499,7 +2531,6 @@ void process_rbn_info(window* wclp, window* wcmp, dx_cluster* dcp, running_stati
 
   start_of_thread(THREAD_NAME);
 
-  constexpr int       POLL_SECS     { 10 };       // seconds between the end of one processing pass and the start of the next
   constexpr frequency MAX_FREQ_SKEW { 800_Hz };   // maximum change in frequency considered as NOT a QSY
 
 // get access to the information that's been passed to the thread
@@ -2517,22 +2548,52 @@ void process_rbn_info(window* wclp, window* wcmp, dx_cluster* dcp, running_stati
   const int    my_cluster_mult_colour { string_to_colour("COLOUR_17"sv) }; // the colour of my call in the CLUSTER MULT window (window is misnamed, as it also displays RBN data)
   const string type_str               { is_rbn ? "RBN"s : "cluster"s };
 
-  string                         unprocessed_input;     // data from the cluster that have not yet been processed by this thread
+  const milliseconds coalesce_window { context.rbn_coalesce_window() };  // how long to let new lines accumulate before processing them
+
+// is a post in a mode that we do not process? Don't process if RBN and not CW, or cluster and CW and CW is not to be processed
+  const auto is_wrong_mode { [is_rbn, is_cluster] (const dx_post& post) { return (is_rbn and (!post.mode_str().empty() and (post.mode_str() != "CW"sv))) or
+                                                                                 (is_cluster and !cluster_cw and (putative_mode(post.freq()) == MODE_CW)); } };
+
+// parsing, location lookup and static autocorrection are shared among a few workers; the results are committed below in order of arrival
+  const unsigned int n_parser_workers { clamp(thread::hardware_concurrency(), 2u, 5u) - 1 };
+
+  post_parser parse_posts { location_db, rbn.source(), n_parser_workers,
+                            [is_rbn, is_wrong_mode] (dx_post& post) { if (post.valid() and !is_wrong_mode(post) and is_rbn and autocorrect_rbn)  // possibly autocorrect
+                                                                        post.callsign(ac_db.corrected_call(post.callsign()));
+                                                                    } };
+
+  ost << type_str << " posts are parsed by " << parse_posts.n_workers() << " worker threads in addition to the processing thread" << endl;
+
+// patterns that mark lines to be discarded before parsing; all are tested in a single pass over each line
+  const line_classifier classify_line { [rbn_beacons] (void) { vector<pair<string, LINE_CLASS>> rv;
+
+                                                               if (!rbn_beacons)
+                                                                 for (const string& marker : { " BCN "s, " BEACON "s, "/B "s, "/B2 "s, " NCDXF "s })
+                                                                   rv += { marker, LINE_CLASS::BEACON };
+
+                                                               for (const string& pattern : context.blocked_post_patterns())
+                                                                 rv += { pattern, LINE_CLASS::BLOCKED };
+
+                                                               return rv;
+                                                             } () };
+
+  line_buffer                    input;                 // complete lines from the cluster that have not yet been processed by this thread
   deque<pair<string, frequency>> recent_mult_calls;     // the queue of recent calls posted to the mult window (can't be a std::queue)
+  post_coalescer                 coalescer { MAX_FREQ_SKEW };   // merges repeated posts of the same station within a pass
 
-  const int highlight_colour { static_cast<int>(colours.add(COLOUR_WHITE, COLOUR_RED)) };             // colour that will mark that we are processing a ten-second pass
+  const int highlight_colour { static_cast<int>(colours.add(COLOUR_WHITE, COLOUR_RED)) };             // colour that will mark that we are processing a pass
   const int original_colour  { static_cast<int>(colours.add(cluster_line_win.fg(), cluster_line_win.bg())) };
 
   if (is_cluster)
     win_cluster_screen < WINDOW_CLEAR < CURSOR_BOTTOM_LEFT;  // probably unused
 
-  while (1)                                                 // forever; process a POLL_INTERVAL pass
-  { set<BAND> changed_bands                { };             // the bands that have been changed by this ten-second pass
+  while (1)                                                 // forever; process a pass
+  { set<BAND> changed_bands                { };             // the bands that have been changed by this pass
     bool      cluster_mult_win_was_changed { false };       // has cluster_mult_win been changed by this pass?
 
     string last_processed_line { };                             // the last line processed during this pass
 
-    const string new_input { rbn.get_unprocessed_input() }; // get any unprocessed info from the cluster; deletes the data from the cluster
+    rbn.move_complete_lines_to(input);                      // get any complete lines from the cluster; removes them from the cluster
 
     posted_by_vector.clear();                               // prepare the posted_by vector
 
@@ -2542,24 +2603,12 @@ void process_rbn_info(window* wclp, window* wcmp, dx_cluster* dcp, running_stati
 
     cluster_line_win < CURSOR_START_OF_LINE < colour_pair(highlight_colour) < first_char <= colour_pair(original_colour);
 
-    if (is_cluster and !new_input.empty())
-    { const string              no_cr { remove_char(new_input, CR) };
-      const vector<string_view> lines { to_lines <std::string_view> (no_cr) };
-
 // I don't understand why the scrolling occurs automatically... in particular, I don't know what causes it to scroll
-      for (size_t n { 0 }; n < lines.size(); ++n)
-      { win_cluster_screen < lines[n];                       // THIS causes the scroll, but I don't know why
+    if (is_cluster)
+      for (const string_view line : input.lines())
+        win_cluster_screen < line < CURSOR_START_OF_LINE < WINDOW_REFRESH;   // the line causes the scroll, but I don't know why
 
-        if ( (n != (lines.size() - 1)) or no_cr.ends_with(LF) )
-          win_cluster_screen < CURSOR_START_OF_LINE;
-        else
-          win_cluster_screen < WINDOW_SCROLL_DOWN;
-
-        win_cluster_screen < WINDOW_REFRESH;
-      }
-    }
-
-    if (new_input.empty())
+    if (input.empty())
     { const auto time_since_data_last_received { rbn.time_since_data_last_received() };
 
       if (time_since_data_last_received > 60s)
@@ -2567,76 +2616,47 @@ void process_rbn_info(window* wclp, window* wcmp, dx_cluster* dcp, running_stati
         const int     bg_colour     { cluster_line_win.bg() };
         const int     fg_colour     { cluster_line_win.fg() };
         const seconds timeout       { is_rbn ? context.rbn_timeout() : context.cluster_timeout() };
-        const seconds time_to_reset { timeout - time_since_data_last_received };
+        const seconds time_to_reset { max(timeout - duration_cast<seconds>(time_since_data_last_received), 0s) };
         const string  msg           { "NO DATA RECEIVED FOR "s + to_string(N_SECONDS(time_since_data_last_received)) + " SECONDS; RESET IN "s + to_string(N_SECONDS(time_to_reset)) + " SECONDS"};
 
         ost << to_upper(type_str) << ": " << msg << endl;
 
         cluster_line_win < WINDOW_CLEAR < COLOURS(COLOUR_RED, COLOUR_BLACK) < centre(msg, 0) <= COLOURS(fg_colour, bg_colour);
 
-// insert connection reset here if time_since_data_last_received.count() is "too large"
+// the connection is reset by cluster_io, not by this thread, when the timeout is exceeded
         if (time_since_data_last_received > timeout)
-        { ost << "WARNING: " << type_str << " timeout exceeded; connection status = " << endl
-                                                                           << "----------" << endl
-                                                                           << rbn.connection_status() << endl
-                                                                           << "----------" << endl;
-          ost << "dx_cluster object details: " << rbn.to_string() << endl;
-
-          rbn.reset_connection();
-
-          ost << "attempted to reset " << type_str << " connection; connection_status = " << endl
+          ost << "WARNING: " << type_str << " timeout exceeded; connection status = " << endl
                                                                        << "----------" << endl
                                                                        << rbn.connection_status() << endl
                                                                        << "----------" << endl;
-
-          ost << "dx_cluster object new details following reset: " << rbn.to_string() << endl;
-        }
-        else
-          ost << type_str << " timeout of " << timeout.count() << " seconds not yet exceeded; reset not attempted" <<  endl;
       }
     }
 
-    unprocessed_input += move(new_input);         // append the new unprocessed data
-
-    string_view unprocessed_input_sv { unprocessed_input };
+    vector<string_view> lines_to_parse;
 
-    while (unprocessed_input_sv.contains(CRLF))                                     // look for EOL markers
-    { const size_t      posn { unprocessed_input_sv.find(CRLF) };                   // guaranteed to succeed
-      const string_view line { substring <string_view> (unprocessed_input_sv, 0, posn) };      // store the next unprocessed line
-
-      unprocessed_input_sv = substring <string_view> (unprocessed_input_sv, line.length() + 2);  // delete the line (including the CRLF) from the unprocessed buffer
-
-      if (!line.empty())
-      { static const FLAT_STRING_SET beacon_markers { " BCN "s,
-                                                      " BEACON "s,
-                                                      "/B "s,
-                                                      "/B2 "s,
-                                                      " NCDXF "s
-                                                    };
-
-        if (rbn_file.is_open())
+    for (const string_view line : input.lines())
+    { if (!line.empty())
+      { if (rbn_file.is_open())
           rbn_file << line << endl;
 
-        if (!rbn_beacons and ANY_OF(beacon_markers, [&line] (const string& str) { return line.contains(str); }))   // if beacon and we don't want it
-        { rbn.increment_n_posts();        // keep track of the number of posts processed from the cluster/rbn
-          continue;                       // go to end of while loop; these are not counted as posts
-        }
-
-        last_processed_line = line;
+        rbn.increment_n_posts();          // keep track of the number of posts processed from the cluster/rbn, including beacons, blocked lines and lines that cannot be parsed
 
-// display if this is a new mult on any band, and if the poster is on our own continent
-        dx_post post { line, location_db, rbn.source() };                // no longer const to allow for RBN autocorrection
+        if (classify_line(line) == LINE_CLASS::NORMAL)
+          lines_to_parse += line;
+      }
+    }
 
-        rbn.increment_n_posts();        // keep track of the number of posts processed from the cluster/rbn
+    vector<optional<dx_post>> posts { parse_posts(lines_to_parse) };   // in the same order as lines_to_parse
 
-        const bool wrong_mode { (is_rbn and (!post.mode_str().empty() and (post.mode_str() != "CW"sv))) or
-                                (is_cluster and !cluster_cw and (putative_mode(post.freq()) == MODE_CW))
-                              };      // don't process if RBN and not CW, or cluster and CW and CW is not to be processed
+    for (size_t n { 0 }; n < posts.size(); ++n)
+    { if (posts[n])
+      { last_processed_line = lines_to_parse[n];
 
-        if (post.valid() and !wrong_mode)                   // a valid post in the correct mode
-        { if (is_rbn and autocorrect_rbn)                   // possibly autocorrect
-            post.callsign(ac_db.corrected_call(post.callsign()));
+// display if this is a new mult on any band, and if the poster is on our own continent
+        dx_post& post { *posts[n] };     // not const, to allow for RBN autocorrection
 
+        if (post.valid() and !is_wrong_mode(post))          // a valid post in the correct mode; static autocorrection has already been applied by parse_posts
+        {
 // eliminate some obvious busts
           const string call  { post.callsign() };
           const char   first { call[0] };
@@ -2669,13 +2689,9 @@ void process_rbn_info(window* wclp, window* wcmp, dx_cluster* dcp, running_stati
                 ost << "RBN DX call " << old_call << " autocorrected to " << post.callsign() << " on " << to_string(post.band()) << "m" << endl;
             }
 
-            const BAND                    cur_band    { current_band };
-            const string                  dx_callsign { post.callsign() };
-            const string                  poster      { post.poster() };
-            const pair<string, frequency> target      { dx_callsign, post.freq() };
-            const bool                    is_me       { (dx_callsign == my_call) };
-
-            const auto& [target_call, target_freq ] { target };
+            const BAND   cur_band    { current_band };
+            const string dx_callsign { post.callsign() };
+            const bool   is_me       { (dx_callsign == my_call) };
 
 // POSTED BY
             if (is_me and is_rbn)
@@ -2710,124 +2726,144 @@ void process_rbn_info(window* wclp, window* wcmp, dx_cluster* dcp, running_stati
               qrg_map[dx_callsign] = post.frequency_str();
             }
 
+            coalescer += post;                      // the bandmap entry is generated once per merged post, below
+          }
+        }   // no else; if it's an invalid post, do nothing
+      }
+    }
+
+    if (rbn_replay_p and is_rbn)
+      rbn_replay_p -> lines_received(input);
+
+    input.clear();                                  // all the lines have been processed
+
+// generate a single bandmap entry for all the posts that have been merged into each coalesced post
+    for (const auto& [post, posters] : coalescer.posts())
+    { const BAND                    dx_band     { post.band() };
+      const BAND                    cur_band    { current_band };
+      const string                  dx_callsign { post.callsign() };
+      const pair<string, frequency> target      { dx_callsign, post.freq() };
+      const bool                    is_me       { (dx_callsign == my_call) };
+
+      const auto& [target_call, target_freq ] { target };
+
 // generate a bandmap_entry for this post
-            bandmap_entry be { post.from_cluster() ? BANDMAP_ENTRY_SOURCE::CLUSTER : BANDMAP_ENTRY_SOURCE::RBN };
+      bandmap_entry be { post.from_cluster() ? BANDMAP_ENTRY_SOURCE::CLUSTER : BANDMAP_ENTRY_SOURCE::RBN };
 
-            be.callsign(dx_callsign);
-            be.freq(post.freq());        // also sets band and mode
+      be.callsign(dx_callsign);
+      be.freq(post.freq());        // also sets band and mode
 
-            if (rules.score_modes().contains(be.mode()))
-            { be.frequency_str_decimal_places(1);
-              be.expiration_time(be.time() + (post.from_cluster() ? bandmap_decay_time_cluster_secs : bandmap_decay_time_rbn_secs) ); // don't rely on the time in the post
-              be.is_needed( is_needed_qso(dx_callsign, dx_band, be.mode()) );             // do we still need this guy?
+      if (rules.score_modes().contains(be.mode()))
+      { be.expiration_time(be.time() + (post.from_cluster() ? bandmap_decay_time_cluster_secs : bandmap_decay_time_rbn_secs) ); // don't rely on the time in the post
+        be.is_needed( is_needed_qso(dx_callsign, dx_band, be.mode()) );             // do we still need this guy?
 
 // update known mults before we test to see if this is a needed mult
 
 // possibly add the call to the known prefixes
-              update_known_callsign_mults(dx_callsign);
+        update_known_callsign_mults(dx_callsign);
 
 // possibly add the call to the known countries
-              if (auto_remaining_country_mults)
-                update_known_country_mults(dx_callsign);
+        if (auto_remaining_country_mults)
+          update_known_country_mults(dx_callsign);
 
 // possibly add exchange mult value
-              const vector<string> exch_mults { rules.expanded_exchange_mults() };                                      // the exchange multipliers
+        const vector<string> exch_mults { rules.expanded_exchange_mults() };                                      // the exchange multipliers
 
-              for (const auto& exch_mult_name : exch_mults)
-              { if (context.auto_remaining_exchange_mults(exch_mult_name))           // this means that for any mult that is not completely determined, it needs to be listed in AUTO REMAINING EXCHANGE MULTS
+        for (const auto& exch_mult_name : exch_mults)
+        { if (context.auto_remaining_exchange_mults(exch_mult_name))           // this means that for any mult that is not completely determined, it needs to be listed in AUTO REMAINING EXCHANGE MULTS
 // *** consider putting the regex into the multiplier object (in addition to the list of known values)
-                { const vector<string> exchange_field_names       { rules.expanded_exchange_field_names(be.canonical_prefix(), be.mode()) };
-                  const bool           is_possible_exchange_field { contains(exchange_field_names, exch_mult_name) };
-
-                  if (is_possible_exchange_field)
-                  { if (const string guess { exchange_db.guess_value(dx_callsign, exch_mult_name) }; !guess.empty())
-                    { if ( statistics.add_known_exchange_mult(exch_mult_name, MULT_VALUE(exch_mult_name, guess)) )
-                        update_remaining_exch_mults_window(exch_mult_name, statistics, current_band, current_mode);    // update if we added a new value of the mult
-                    }
-                  }
-                }
+          { const vector<string> exchange_field_names       { rules.expanded_exchange_field_names(be.canonical_prefix(), be.mode()) };
+            const bool           is_possible_exchange_field { contains(exchange_field_names, exch_mult_name) };
+
+            if (is_possible_exchange_field)
+            { if (const string guess { exchange_db.guess_value(dx_callsign, exch_mult_name) }; !guess.empty())
+              { if ( statistics.add_known_exchange_mult(exch_mult_name, MULT_VALUE(exch_mult_name, guess)) )
+                  update_remaining_exch_mults_window(exch_mult_name, statistics, current_band, current_mode);    // update if we added a new value of the mult
               }
+            }
+          }
+        }
 
-              be.calculate_mult_status(rules, statistics);
+        be.calculate_mult_status(rules, statistics);
 
-              bool is_recent_call { false };
+        bool is_recent_call { false };
 
-              for (const auto& [recent_mult_call, recent_mult_freq] : recent_mult_calls)      // look to see if this is already in the deque
-                if (!is_recent_call)
-                  is_recent_call = (recent_mult_call == target_call) and (target_freq.difference(recent_mult_freq) <= MAX_FREQ_SKEW); // allow for frequency skew
+        for (const auto& [recent_mult_call, recent_mult_freq] : recent_mult_calls)      // look to see if this is already in the deque
+          if (!is_recent_call)
+            is_recent_call = (recent_mult_call == target_call) and (target_freq.difference(recent_mult_freq) <= MAX_FREQ_SKEW); // allow for frequency skew
 
-              const bool is_interesting_mode { (rules.score_modes().contains(be.mode())) };   // is the mode one that we are following?
+        const bool is_interesting_mode { (rules.score_modes().contains(be.mode())) };   // is the mode one that we are following?
 
 // CLUSTER MULT window
-              if (cluster_mult_win.defined())
-              { if (is_interesting_mode and !is_recent_call and (be.is_needed_callsign_mult() or be.is_needed_country_mult() or be.is_needed_exchange_mult() or is_me))  // if it's a mult and not recently posted...
-                { if (location_db.continent(poster) == my_continent)                                      // heard on our continent?
-                  { const size_t QUEUE_SIZE { static_cast<size_t>(cluster_mult_win.height()) };           // make the queue length the same as the height of the window
+        if (cluster_mult_win.defined())
+        { if (is_interesting_mode and !is_recent_call and (be.is_needed_callsign_mult() or be.is_needed_country_mult() or be.is_needed_exchange_mult() or is_me))  // if it's a mult and not recently posted...
+          { if (ANY_OF(posters, [] (const string& poster) { return (location_db.continent(poster) == my_continent); }))   // heard on our continent?
+            { const size_t QUEUE_SIZE { static_cast<size_t>(cluster_mult_win.height()) };           // make the queue length the same as the height of the window
 
-                    cluster_mult_win_was_changed = true;             // keep track of the fact that we're about to write changes to the window
-                    recent_mult_calls += target;
+              cluster_mult_win_was_changed = true;             // keep track of the fact that we're about to write changes to the window
+              recent_mult_calls += target;
 
-                    while (recent_mult_calls.size() > QUEUE_SIZE)    // keep the list of recent calls to a reasonable size
-                      --recent_mult_calls;
+              while (recent_mult_calls.size() > QUEUE_SIZE)    // keep the list of recent calls to a reasonable size
+                --recent_mult_calls;
 
-                    cluster_mult_win < CURSOR_TOP_LEFT < WINDOW_SCROLL_DOWN;
+              cluster_mult_win < CURSOR_TOP_LEFT < WINDOW_SCROLL_DOWN;
 
-                    const int bg_colour { cluster_mult_win.bg() };
-                    const int fg_colour { cluster_mult_win.fg() };
+              const int bg_colour { cluster_mult_win.bg() };
+              const int fg_colour { cluster_mult_win.fg() };
 
-                    if (is_me)
-                      cluster_mult_win < COLOURS(COLOUR_YELLOW, my_cluster_mult_colour);  // darkish blue
+              if (is_me)
+                cluster_mult_win < COLOURS(COLOUR_YELLOW, my_cluster_mult_colour);  // darkish blue
 
-                    const string frequency_str { pad_left(be.frequency_str(), 7) };
+              const string frequency_str { pad_left(be.frequency_str(), 7) };
 
 // highlight it if it's on our current band
-                    if ( (dx_band == cur_band) or is_me)
-                      cluster_mult_win < WINDOW_HIGHLIGHT;       // swaps fg/bg
+              if ( (dx_band == cur_band) or is_me)
+                cluster_mult_win < WINDOW_HIGHLIGHT;       // swaps fg/bg
 
-                    if (is_me)
-                      cluster_mult_win < WINDOW_BOLD;            // call in bold darkish blue
+              if (is_me)
+                cluster_mult_win < WINDOW_BOLD;            // call in bold darkish blue
 
-                    cluster_mult_win < pad_right(frequency_str + SPACE + dx_callsign, cluster_mult_win.width());  // display it -- removed refresh
+              cluster_mult_win < pad_right(frequency_str + SPACE + dx_callsign, cluster_mult_win.width());  // display it -- removed refresh
 
-                    if (is_me)
-                      cluster_mult_win < COLOURS(fg_colour, bg_colour);
+              if (is_me)
+                cluster_mult_win < COLOURS(fg_colour, bg_colour);
 
-                    if ( (dx_band == cur_band) or is_me)
-                      cluster_mult_win < WINDOW_NORMAL;
-                  }
-                }
-              }
+              if ( (dx_band == cur_band) or is_me)
+                cluster_mult_win < WINDOW_NORMAL;
+            }
+          }
+        }
 
 // add the post to the correct bandmap unless it's a marked frequency
-              if ( is_interesting_mode and (bandmap_show_marked_frequencies or !is_marked_frequency(marked_frequency_ranges, be.mode(), be.freq())) )
-              { auto insert_be { [&changed_bands] (const BAND dx_band, const bandmap_entry& be) { bandmap_insertion_queues[static_cast<unsigned int>(dx_band)] += be;
-                                                                                                  changed_bands += dx_band;      // mark band as changed
-                                                                                                } };
+        if ( is_interesting_mode and (bandmap_show_marked_frequencies or !is_marked_frequency(marked_frequency_ranges, be.mode(), be.freq())) )
+        { auto insert_be { [&changed_bands] (const BAND dx_band, const bandmap_entry& be) { bandmap_insertion_queues[static_cast<unsigned int>(dx_band)] += be;
+                                                                                            changed_bands += dx_band;      // mark band as changed
+                                                                                          } };
 
-                switch (be.source())
-                { case BANDMAP_ENTRY_SOURCE::CLUSTER :
-                  case BANDMAP_ENTRY_SOURCE::RBN :
-                  { n_posters_database* dbp { (be.source() == BANDMAP_ENTRY_SOURCE::CLUSTER) ? &n_posters_db_cluster : &n_posters_db_rbn };   // choose correct n_posters database
+          switch (be.source())
+          { case BANDMAP_ENTRY_SOURCE::CLUSTER :
+            case BANDMAP_ENTRY_SOURCE::RBN :
+            { n_posters_database* dbp { (be.source() == BANDMAP_ENTRY_SOURCE::CLUSTER) ? &n_posters_db_cluster : &n_posters_db_rbn };   // choose correct n_posters database
 
-                    (*dbp) += { be.callsign(), post.poster() };        // associate poster with the call
+              for (const string& poster : posters)
+                (*dbp) += { be.callsign(), poster };            // associate every poster with the call
 
-                    if (dbp -> test_call(be.callsign()))              // if good call
-                      insert_be(dx_band, be);
+              if (dbp -> test_call(be.callsign()))              // if good call
+                insert_be(dx_band, be);
 
-                    break;
-                  }
-
-                  default :                                       // neither cluster nor RBN
-                    insert_be(dx_band, be);
-                }
-              }
+              break;
             }
+
+            default :                                       // neither cluster nor RBN
+              insert_be(dx_band, be);
           }
-        }   // no else; if it's an invalid post, do nothing
+        }
       }
     }
 
-    unprocessed_input = unprocessed_input_sv;       // copy to the original owner of the data
+    n_posts_coalesced += coalescer.n_posts();
+    n_bandmap_insertions_saved += coalescer.n_merged();
+    coalescer.clear();
 
     while (ignore_next_process_insertion_queue)
     { ignore_next_process_insertion_queue = false;
@@ -2837,6 +2873,11 @@ void process_rbn_info(window* wclp, window* wcmp, dx_cluster* dcp, running_stati
 
     BAND displayed_band { bandmap_display_band };   // band to be displayed
 
+    size_t insertion_queue_depth { 0 };             // used only by -rbn-replay
+
+    if (rbn_replay_p)
+      FOR_ALL(bandmap_insertion_queues, [&insertion_queue_depth] (const BANDMAP_INSERTION_QUEUE& biq) { insertion_queue_depth += biq.size(); });
+
     for (const BAND b : changed_bands)
     { if (b == displayed_band)
       { while (ignore_next_process_insertion_queue)
@@ -2858,6 +2899,13 @@ void process_rbn_info(window* wclp, window* wcmp, dx_cluster* dcp, running_stati
         bandmaps[to_uint(b)].process_insertion_queue(bandmap_insertion_queues[to_uint(b)]);
     }
 
+    if (rbn_replay_p and is_rbn and rbn_replay_p -> pass_complete(insertion_queue_depth))
+    { const string report { rbn_replay_p -> report() };
+
+      ost << report;
+      alert("RBN REPLAY COMPLETE; REPORT WRITTEN TO OUTPUT FILE"s);
+    }
+
     if (cluster_mult_win_was_changed)    // update the window on the screen
       cluster_mult_win.refresh();
 
@@ -2920,83 +2968,96 @@ void process_rbn_info(window* wclp, window* wcmp, dx_cluster* dcp, running_stati
     if (!posted_by_vector.empty())
       update_win_posted_by(posted_by_vector);
 
-// see also repeat() suggestion at: https://stackoverflow.com/questions/17711655/c11-range-based-for-loops-without-loop-variable
-    for ( [[maybe_unused]] auto _ : RANGE(1, POLL_SECS) )    // wait POLL_SECS seconds before getting any more unprocessed info
-    {
-      { SAFELOCK(thread_check);
+    { SAFELOCK(thread_check);
 
-        if (exiting)
-        { stop_recording_rbn();
+      if (exiting)
+      { stop_recording_rbn();
 
-          ost << "Number of posts processed by " << ( (rbn.source() == POSTING_SOURCE::CLUSTER) ? "CLUSTER"s : "RBN"s ) << " in processing pass = " << css(rbn.n_posts()) << endl;
+        ost << "Number of posts processed by " << ( (rbn.source() == POSTING_SOURCE::CLUSTER) ? "CLUSTER"s : "RBN"s ) << " in processing pass = " << css(rbn.n_posts()) << endl;
 
-          end_of_thread(THREAD_NAME);
-          return;
-        }
+        end_of_thread(THREAD_NAME);
+        return;
       }
-
-      sleep_for(1s);
     }
+
+// wait for new lines; if none arrive within a second, run a pass anyway, so that a silent connection is noticed
+    if (rbn.wait_for_new_lines(1s))
+      sleep_for(coalesce_window);          // let any more lines that arrive shortly accumulate, so that they are processed in the same pass
   }
 }
 
-/// thread function to obtain data from the cluster or RBN
-void get_cluster_info(dx_cluster* cluster_p)
-{ constexpr int READ_INTERVAL_SEC { 2 };                  // number of seconds to pause between reads from the socket; longer pauses can accumulate large numbers of posts
+/*! \brief  Thread function to read all the cluster and RBN connections
 
-  const string THREAD_NAME { "get cluster info"s };
+    Each pass waits until data arrive on any connection (or one second elapses); the processing thread
+    of a connection is woken as soon as complete lines are available
+*/
+void read_cluster_connections(void)
+{ const string THREAD_NAME { "read cluster connections"s };
 
   start_of_thread(THREAD_NAME);
 
-  dx_cluster& cluster { *cluster_p };    // make the cluster available
-
   while (1)                                                 // forever
-  { cluster.read();                                         // reads the socket and stores the data inside the cluster object
+  { try
+    { cluster_io.poll(1s);                                  // reads the sockets and stores the data inside the cluster objects
+    }
 
-    for ( [[maybe_unused]] auto _ : RANGE(1, READ_INTERVAL_SEC) )    // check the socket every READ_INTERVAL_SEC seconds
-    {
-      { SAFELOCK(thread_check);
+    catch (const epoll_error& e)
+    { ost << "epoll error in " << THREAD_NAME << ": code = " << e.code() << ", reason = " << e.reason() << endl;
+      sleep_for(1s);                                        // don't spin if the error persists
+    }
 
-        if (exiting)
-        { end_of_thread(THREAD_NAME);
-          return;
-        }
-      }
+    SAFELOCK(thread_check);
 
-      sleep_for(1s);
+    if (exiting)
+    { cluster_io.stop_resets();                             // wait for any reset in progress, so that no cluster is touched after exit
+      end_of_thread(THREAD_NAME);
+      return;
     }
   }
 }
 
-/// thread function to prune the bandmaps once per minute
-void prune_bandmap(window* win_bandmap_p, array<bandmap, NUMBER_OF_BANDS>* bandmaps_p)
-{ constexpr int PRUNE_INTERVAL_SEC { 60 };
+/*! \brief                  Thread function to prune the bandmaps once per second
+    \param  win_bandmap_p   pointer to the bandmap window
+    \param  bandmaps_p      pointer to the bandmaps
 
-  const string THREAD_NAME { "prune bandmap"s };
+    Each bandmap removes only its expired entries, so pruning every second is cheap. The displayed
+    bandmap is rewritten whenever it changes, and at the start of each minute so that the colours of
+    the entries fade with age.
+*/
+void prune_bandmap(window* win_bandmap_p, array<bandmap, NUMBER_OF_BANDS>* bandmaps_p)
+{ const string THREAD_NAME { "prune bandmap"s };
 
   start_of_thread(THREAD_NAME);
 
   window&                          bandmap_win { *win_bandmap_p };         // bandmap window
   array<bandmap, NUMBER_OF_BANDS>& bandmaps    { *bandmaps_p };            // bandmaps
 
+  time_t last_display_minute { 0 };
+
   while (1)
-  { FOR_ALL(bandmaps, [] (bandmap& bm) { bm.prune(); } );             // prune all bandmaps
+  { const size_t displayed_band_nr { to_uint(bandmap_display_band) };
+    const time_t this_minute       { NOW() / 60 };
 
-//    bandmap_win <= bandmaps[at_uint(bandmap_display_band)];                    // display the pruned bandmap for the displayed band
-    bandmap_win <= bandmaps[to_uint(bandmap_display_band)];                    // display the pruned bandmap for the displayed band
+    bool display_changed { false };
 
-    for ( [[maybe_unused]] auto _ : RANGE(1, PRUNE_INTERVAL_SEC) )    // check once per second for a minute
-    {
-      { SAFELOCK(thread_check);
+    for (size_t band_nr { 0 }; band_nr < bandmaps.size(); ++band_nr)             // prune all bandmaps
+      if (bandmaps[band_nr].prune() and (band_nr == displayed_band_nr))
+        display_changed = true;
 
-        if (exiting)
-        { end_of_thread(THREAD_NAME);
-          return;
-        }
-      }
+    if (display_changed or (this_minute != last_display_minute))
+    { bandmap_win <= bandmaps[displayed_band_nr];                              // display the pruned bandmap for the displayed band
+      last_display_minute = this_minute;
+    }
+
+    { SAFELOCK(thread_check);
 
-      sleep_for(1s);
+      if (exiting)
+      { end_of_thread(THREAD_NAME);
+        return;
+      }
     }
+
+    sleep_for(1s);
   }
 }
 
@@ -3796,7 +3857,8 @@ void process_CALL_input(window* wp, const keyboard_event& e)
 
 // .RESET RBN -- get a new connection
       if (command == "RESET RBN"sv)
-      { jthread(reset_connection, rbn_p).detach();
+      { if (rbn_p)
+          cluster_io.reset(*rbn_p);               // the connection is reset by the reactor's reset thread
 
         goto FINISHED_PROCESSING_COMMAND;
       }
@@ -4110,7 +4172,7 @@ FINISHED_PROCESSING_COMMAND:
 
         const bandmap_entry old_be { bandmap_this_band[callsign] };
 
-        if ( (old_be.callsign().empty()) or ( old_be.frequency_str() != be.frequency_str()) )  // update bandmap only if there's a change
+        if ( (old_be.callsign().empty()) or !old_be.same_frequency_str(be) )  // update bandmap only if there's a change
         { bandmap_this_band += be;
 
           win_bandmap <= bandmap_this_band;
@@ -4396,11 +4458,9 @@ FINISHED_PROCESSING_COMMAND:
         update_remaining_country_mults_window(statistics, cur_band, cur_mode);
         update_remaining_exchange_mults_windows(statistics, cur_band, cur_mode);
 
-// removal of a Q might change the colour indication of stations
+// removal of a Q might change the colour indication of stations; only those that share a call or a mult with the QSO can change
         for (auto& bm : bandmaps)
-        { FOR_ALL(bm.entries(), [&bm] (auto& be) { if (be.remark(rules, q_history, statistics))
-                                                     bm += be; 
-                                                 });
+        { bm.remark(qso, rules, q_history, statistics);
 
 //          const BAND b = bandmap_display_band;
 //          const unsigned int tmp = static_cast<unsigned int>(b);
@@ -5843,6 +5903,9 @@ void process_LOG_input(window* wp, const keyboard_event& e)
 // log window at:  editable_log.recent_qsos(logbk, true); about 100 lines below
 
 // add the new QSOs
+        vector<QSO> new_qsos;                                       // QSOs that are in the window after the edit
+        vector<QSO> changed_qsos;                                   // QSOs that have been added or removed by the edit
+
         for (size_t n { 0 }; n < new_win_log_snapshot.size(); ++n)
         { if (!remove_peripheral_spaces <string_view> (new_win_log_snapshot[n]).empty())
           { QSO qso { original_qsos[n] };           // start with the original QSO as a basis *** THIS IS A PROBLEM, AS THE MEANING OF AN EXCHANGE COLUMN MIGHT CHANGE
@@ -5872,6 +5935,7 @@ void process_LOG_input(window* wp, const keyboard_event& e)
 // add it to the running statistics; do this before we add it to the log so we can check for dupes against the current log
             statistics.add_qso(qso, logbk, rules);
             logbk += qso;
+            new_qsos += qso;
 
 // possibly change values in the exchange database
             const vector<received_field> fields { qso.received_exchange() };
@@ -5883,7 +5947,9 @@ void process_LOG_input(window* wp, const keyboard_event& e)
 // pretend that we just entered this station on the bandmap by hand
 // do this just for QSOs that have changed
             if (!contains(original_qsos, qso))
-            { bandmap& bm { bandmaps[static_cast<unsigned int>(qso.band())] };
+            { changed_qsos += qso;
+
+              bandmap& bm { bandmaps[static_cast<unsigned int>(qso.band())] };
 
               bandmap_entry be;                       // defaults to manual entry
 
@@ -5899,6 +5965,10 @@ void process_LOG_input(window* wp, const keyboard_event& e)
           }
         }
 
+        for (const QSO& qso : original_qsos)                        // QSOs that have been removed or altered by the edit
+          if (!qso.empty() and !contains(new_qsos, qso))
+            changed_qsos += qso;
+
 // the logbook is now rebuilt
         if (send_qtcs)
         { qtc_buf.rebuild_unsent_list(logbk);
@@ -5951,15 +6021,9 @@ void process_LOG_input(window* wp, const keyboard_event& e)
 
 //        ost << "LOOKING AT BANDMAPS" << endl;
 
-// test --- change current bandmap
+// only the stations that share a call or a mult with a changed QSO can change
         for (auto& bm : bandmaps)
-        { for (bandmap_entry& be : bm.entries())
-          { if (be.remark(rules, q_history, statistics))
-              bm += be;
-            else
-            { //ost << "NOT remarked following log edit: " << be << endl;
-            }
-          }
+        { bm.remark(changed_qsos, rules, q_history, statistics);
 
 //          if (&bm == &(bandmaps[at_uint(current_band)]))
           if (&bm == &(bandmaps[to_uint(current_band)]))
@@ -6855,20 +6919,6 @@ void update_rate_window(void)
            < CURSOR_DOWN <CURSOR_START_OF_LINE <= rate_str;
 }
 
-/// Thread function to reset the RBN or cluster connection
-void reset_connection(dx_cluster* rbn_p)
-{ ost << "Resetting RBN/cluster connection" << endl;    // for now only RESET RBN exists
-
-// no start_of_thread for this one, as it's all asynchronous
-  if (rbn_p)
-  { rbn_p -> reset_connection();
-    ost << "RBN/cluster connection has been reset" << endl;
-  }
-  else
-  { alert("ERROR: reset_connection() passed nullptr");
-  }
-}
-
 /*! \brief          Populate QSO with correct exchange mults
     \param  qso     QSO to poulate
     \param  rules   rules for this contest
@@ -7017,8 +7067,10 @@ void exit_drlog(void)
 
   dump_screen("screenshot-EXIT-"s + suffix);
 
-  ost << "Number of type 1 posts processed: " << type_1_post_counter << endl;
-  ost << "Number of type 2 posts processed: " << type_2_post_counter << endl;
+  ost << "Number of type 1 posts processed: " << type_1_post_counter.load() << endl;
+  ost << "Number of type 2 posts processed: " << type_2_post_counter.load() << endl;
+  ost << "Autocorrect cache: " << ac_db.cache_statistics() << endl;
+  ost << "Coalesced posts: " << n_posts_coalesced.load() << "; bandmap insertions saved: " << n_bandmap_insertions_saved.load() << endl;
 
   if (const auto xruns { audio.xrun_counter() }; xruns)
     ost << "Total number of audio XRUN errors = " << xruns << endl;
@@ -7390,7 +7442,7 @@ void spawn_dx_cluster(void)
 
   win_cluster_line < WINDOW_ATTRIBUTES::CURSOR_START_OF_LINE < WINDOW_ATTRIBUTES::WINDOW_CLEAR <= "CONNECTED"s;
 
-  jthread(get_cluster_info, cluster_p).detach();
+  cluster_io.add(*cluster_p, context.cluster_timeout());   // the reactor resets the connection if it falls silent
   jthread(process_rbn_info, &win_cluster_line, &win_cluster_mult, cluster_p, &statistics, &location_db, &win_bandmap, &bandmaps).detach();
 }
 
@@ -7447,8 +7499,69 @@ void spawn_rbn(void)
 
   start_recording_rbn();
 
-  jthread(get_cluster_info, rbn_p).detach();
+  cluster_io.add(*rbn_p, context.rbn_timeout());           // the reactor resets the connection if it falls silent
   jthread(process_rbn_info, &win_rbn_line, &win_cluster_mult, rbn_p, &statistics, &location_db, &win_bandmap, &bandmaps).detach();
+
+  for (const auto& [server, port] : context.extra_rbn_servers())
+    jthread(spawn_extra_rbn_feed, server, (port ? port : context.rbn_port())).detach();
+}
+
+/// Thread function to spawn the RBN from the replay server
+void spawn_rbn_replay(void)
+{ win_rbn_line <= "UNCONNECTED"s;
+
+  rbn_replay_p -> start();
+
+  try
+  { rbn_p = new dx_cluster(context, POSTING_SOURCE::RBN, "127.0.0.1"s, rbn_replay_p -> port());
+
+    ost << "RBN replay connection: " << rbn_p -> connection_status() << endl;
+  }
+
+  catch (const x_error& e)
+  { ost << "UNABLE TO CONNECT TO RBN REPLAY SERVER: error = " << e.reason() << endl;
+    alert("UNABLE TO CONNECT TO RBN REPLAY SERVER"s);
+
+    return;
+  }
+
+  win_rbn_line < WINDOW_ATTRIBUTES::CURSOR_START_OF_LINE < WINDOW_ATTRIBUTES::WINDOW_CLEAR <= "REPLAY"s;
+
+  cluster_io.add(*rbn_p);              // no timeout: the replay may be silent for long periods, and the replay server accepts only one connection
+  jthread(process_rbn_info, &win_rbn_line, &win_cluster_mult, rbn_p, &statistics, &location_db, &win_bandmap, &bandmaps).detach();
+}
+
+/*! \brief          Thread function to spawn an additional RBN-style feed
+    \param  server  name or IP address of the server
+    \param  port    server port
+
+    The lines from the feed are processed by the RBN processing thread, so the RBN must already exist
+*/
+void spawn_extra_rbn_feed(const string server, const unsigned int port)
+{ dx_cluster* feed_p            { nullptr };
+  bool        signalled_failure { false };
+
+  while (!feed_p)
+  { try
+    { feed_p = new dx_cluster(context, POSTING_SOURCE::RBN, server, port);
+
+      ost << "RBN feed connection to " << server << ":" << port << ": " << feed_p -> connection_status() << endl;
+    }
+
+    catch (...)
+    { ost << "UNABLE TO CREATE RBN FEED: " << server << ":" << port << endl;
+
+      if (!signalled_failure)
+      { alert("UNABLE TO CREATE RBN FEED "s + server + ":"s + to_string(port) + "; WILL RETRY"s);
+        signalled_failure = true;
+      }
+
+      sleep_for(1min);
+    }
+  }
+
+  rbn_p -> add_feed(*feed_p);
+  cluster_io.add(*feed_p, context.rbn_timeout());     // the reactor resets the feed if it falls silent
 }
 
 /*! \brief  Dump useful information to disk
@@ -8127,6 +8240,138 @@ void test_exchange_templates(const contest_rules& rules, const string_view test_
   exit(0);
 }
 
+/*! \brief              Compare the speeds of the two post parsers over a recorded RBN file
+    \param  filename    name of a file written to RBN FILE
+
+    Writes the number of posts per second for the original parser and for the single-pass parser, and the number
+    of lines for which the two disagree, then exits. Each line is parsed as if it came from the RBN.
+*/
+void benchmark_post_parsing(const string_view filename)
+{ constexpr int N_PASSES { 10 };               // number of passes through the file for each parser
+
+  ost << "executing -benchmark-posts" << endl;
+
+  vector<string> lines;
+
+  try
+  { lines = to_lines <string> (remove_char(read_file(filename), CR));
+  }
+
+  catch (const string_function_error& e)
+  { cerr << "Error: unable to read file: " << filename << endl;
+    exit(-1);
+  }
+
+  erase_if(lines, [] (const string& line) { return line.empty(); });
+
+  if (lines.empty())
+  { cerr << "Error: no posts in file: " << filename << endl;
+    exit(-1);
+  }
+
+// time N_PASSES passes of a parser, and return the number of posts per second
+  auto posts_per_second { [&lines] (auto parse) { size_t n_valid { 0 };
+
+                                                  const auto start { steady_clock::now() };
+
+                                                  for (int n { 0 }; n < N_PASSES; ++n)
+                                                    for (const string& line : lines)
+                                                      n_valid += parse(line).valid();
+
+                                                  const duration<double> elapsed { steady_clock::now() - start };
+
+                                                  ost << "  valid posts: " << (n_valid / N_PASSES) << endl;
+
+                                                  return static_cast<double>(lines.size() * N_PASSES) / elapsed.count();
+                                                } };
+
+  const double before { posts_per_second([] (const string_view line) { return dx_post { line, location_db, POSTING_SOURCE::RBN }; }) };
+  const double after  { posts_per_second([] (const string_view line) { return dx_post { post_fields { line, POSTING_SOURCE::RBN }, location_db, POSTING_SOURCE::RBN }; }) };
+
+  size_t n_different { 0 };
+
+  for (const string& line : lines)
+  { const dx_post post_before { line, location_db, POSTING_SOURCE::RBN };
+    const dx_post post_after  { post_fields { line, POSTING_SOURCE::RBN }, location_db, POSTING_SOURCE::RBN };
+
+    const bool same { (post_before.valid() == post_after.valid()) and
+                      (!post_before.valid() or ( (post_before.callsign() == post_after.callsign()) and (post_before.freq() == post_after.freq()) and
+                                                 (post_before.frequency_str() == post_after.frequency_str()) and (post_before.poster() == post_after.poster()) and
+                                                 (post_before.mode_str() == post_after.mode_str()) )) };
+
+    if (!same)
+    { n_different++;
+      ost << "  parsers disagree: " << line << endl;
+    }
+  }
+
+  const string msg { "posts: "s + to_string(lines.size()) + "; posts/second: original parser = "s + to_string(static_cast<long>(before)) +
+                     ", single-pass parser = "s + to_string(static_cast<long>(after)) + "; lines with different results = "s + to_string(n_different) };
+
+  ost << msg << endl;
+  cout << msg << endl;
+
+  exit(0);
+}
+
+/*! \brief      Create the server for -rbn-replay
+    \param  cl  the command line
+
+    The command line contains "-rbn-replay <filename> [speedup]", where <i>filename</i> was written to RBN FILE, and
+    <i>speedup</i> (default 1) is the factor by which the replay is faster than real time; 0 => as fast as possible.
+    Exits if the file cannot be read or the server cannot be created.
+*/
+void prepare_rbn_replay(const command_line& cl)
+{ const string filename { cl.value("-rbn-replay"sv) };
+
+  double speedup { 1.0 };
+
+  for (int n { 1 }; n <= cl.n_parameters() - 2; ++n)
+  { if (cl.parameter(n) == "-rbn-replay"sv)
+    { const string param { cl.parameter(n + 2) };
+
+      if (!param.empty() and (isdigit(param[0]) or (param[0] == '.')))    // speedup is optional
+        speedup = from_string<double>(param);
+    }
+  }
+
+  ost << "executing -rbn-replay; file = " << filename << ", speedup = " << speedup << endl;
+
+  vector<string> lines;
+
+  try
+  { lines = to_lines <string> (remove_char(read_file(filename), CR));
+  }
+
+  catch (const string_function_error& e)
+  { cerr << "Error: unable to read file: " << filename << endl;
+    exit(-1);
+  }
+
+  erase_if(lines, [] (const string& line) { return line.empty(); });
+
+  if (lines.empty())
+  { cerr << "Error: no lines in file: " << filename << endl;
+    exit(-1);
+  }
+
+  if (context.my_ip().empty())
+  { cerr << "Error: MY IP must be set to use -rbn-replay" << endl;
+    exit(-1);
+  }
+
+  try
+  { rbn_replay_p = new rbn_replay_server(lines, speedup);
+  }
+
+  catch (const socket_support_error& e)
+  { cerr << "Error: unable to create RBN replay server: " << e.reason() << endl;
+    exit(-1);
+  }
+
+  ost << "RBN replay server listening on port " << rbn_replay_p -> port() << endl;
+}
+
 /// calculate the time/QSO value of a mult and update <i>win_mult_value</i>
 void update_mult_value(void)
 { const float        mult_value    { statistics.mult_to_qso_value(rules, current_band, current_mode) };
@@ -329,6 +329,22 @@ void drlog_context::_process_configuration_file(const string_view filename)
     if ( (LHS == "BEST DX UNIT"sv) or (LHS == "BEST DX UNITS"sv) )
       _best_dx_unit = RHS;
 
+// BLOCKED POST PATTERNS; a pattern enclosed in quotation marks keeps any leading or trailing spaces (e.g., " BCN ")
+    if (LHS == "BLOCKED POST PATTERNS"sv)
+    { _blocked_post_patterns.clear();
+
+      for (const string_view entry : split_string <string_view> (RHS, COMMA))
+      { const string_view pattern { remove_peripheral_spaces <string_view> (entry) };
+
+        if ( (pattern.length() >= 2) and pattern.starts_with(QUOTATION_MARK) and pattern.ends_with(QUOTATION_MARK) )
+          _blocked_post_patterns += string { pattern.substr(1, pattern.length() - 2) };
+        else
+        { if (!pattern.empty())
+            _blocked_post_patterns += string { pattern };
+        }
+      }
+    }
+
 // BLOCKED POSTS
     if ( (LHS == "BLOCKED POSTS"sv) or (LHS == "BLOCK POSTS"sv) )
       _blocked_posts = SR::to<FLAT_STRING_SET>(clean_split_string <string> (RHS, COMMA));
@@ -610,6 +626,18 @@ void drlog_context::_process_configuration_file(const string_view filename)
     if (LHS == "EXECUTE AT START"sv)
       _execute_at_start += remove_peripheral_spaces <std::string> (rhs);
 
+// EXTRA RBN SERVERS; comma-separated server[:port]
+    if (LHS == "EXTRA RBN SERVERS"sv)
+    { _extra_rbn_servers.clear();
+
+      for (const string& server_and_port : clean_split_string <string> (rhs, COMMA))
+      { const vector<string> tokens { clean_split_string <string> (server_and_port, COLON) };
+
+        if (!tokens.empty() and !tokens[0].empty())
+          _extra_rbn_servers += { tokens[0], (tokens.size() == 2) ? from_string<unsigned int>(tokens[1]) : 0 };
+      }
+    }
+
 // FAST CQ BANDWIDTH; used only in CW mode
     if (LHS == "FAST CQ BANDWIDTH"sv)
       _fast_cq_bandwidth = from_string<decltype(_fast_cq_bandwidth)>(RHS);
@@ -618,6 +646,10 @@ void drlog_context::_process_configuration_file(const string_view filename)
     if (LHS == "FAST SAP BANDWIDTH"sv)
       _fast_sap_bandwidth = from_string<decltype(_fast_sap_bandwidth)>(RHS);
 
+// FUZZY INSERTIONS AND DELETIONS
+    if (LHS == "FUZZY INSERTIONS AND DELETIONS"sv)
+      _fuzzy_insertions_and_deletions = is_true;
+
 // GEOMAGNETIC INDICES COMMAND
     if (LHS == "GEOMAGNETIC INDICES COMMAND"sv)
       _geomagnetic_indices_command = rhs;
@@ -881,6 +913,10 @@ void drlog_context::_process_configuration_file(const string_view filename)
     if (LHS == "RBN BEACONS"sv)
       _rbn_beacons = is_true;
 
+// RBN COALESCE WINDOW
+    if (LHS == "RBN COALESCE WINDOW"sv)
+      _rbn_coalesce_window = std::chrono::milliseconds(from_string<unsigned int>(rhs));
+
 // RBN FILE
     if (LHS == "RBN FILE"sv)
     { _rbn_file = remove_peripheral_spaces <std::string> (rhs);
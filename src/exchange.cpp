@@ -1160,6 +1160,7 @@ void exchange_field_database::set_value(const string_view callsign, const string
 { SAFELOCK(exchange_field_database);
 
   _db[ { string { callsign }, string { field_name } } ] = value;    // don't use insert, since we must overwrite
+  _generation++;
 }
 
 /*! \brief              Set value of a field for multiple calls using a file
@@ -18,7 +18,6 @@
 #include "string_functions.h"
 
 #include <iostream>
-#include <regex>
 #include <vector>
 
 using namespace std;
@@ -31,25 +30,145 @@ extern message_stream    ost;       ///< debugging/logging output
     \brief  The database for the fuzzy function
 */
 
+/*! \brief          Add a call to the indices
+    \param  call    call to be added
+*/
+void fuzzy_database::_index(const string& call)
+{ string variant { call };
+
+  for (size_t posn { 0 }; posn < call.length(); ++posn)
+  { variant[posn] = WILDCARD;
+    _substitutions[variant].emplace_back(call);
+    variant[posn] = call[posn];
+  }
+
+  if (_insertions_and_deletions)
+    for (size_t posn { 0 }; posn < call.length(); ++posn)
+      if ( (posn == 0) or (call[posn] != call[posn - 1]) )          // deleting either of a run of identical characters gives the same variant
+        _deletions[string { call }.erase(posn, 1)].emplace_back(call);
+}
+
+/*! \brief          Remove a call from the indices
+    \param  call    call to be removed
+*/
+void fuzzy_database::_unindex(const string_view call)
+{ auto unindex_from { [&call] (FUZZY_INDEX& index, const string& variant)
+                        { if (auto it { index.find(variant) }; it != index.end())
+                          { erase(it -> second, call);
+
+                            if (it -> second.empty())
+                              index.erase(it);
+                          }
+                        } };
+
+  string variant { call };
+
+  for (size_t posn { 0 }; posn < call.length(); ++posn)
+  { variant[posn] = WILDCARD;
+    unindex_from(_substitutions, variant);
+    variant[posn] = call[posn];
+  }
+
+  if (_insertions_and_deletions)
+    for (size_t posn { 0 }; posn < call.length(); ++posn)
+      if ( (posn == 0) or (call[posn] != call[posn - 1]) )
+        unindex_from(_deletions, string { call }.erase(posn, 1));
+}
+
+/// index every call under each of its deletions
+void fuzzy_database::_index_deletions(void)
+{ _deletions.clear();
+
+  for (const FUZZY_SET& ss : _db)
+    for (const string& call : ss)
+      for (size_t posn { 0 }; posn < call.length(); ++posn)
+        if ( (posn == 0) or (call[posn] != call[posn - 1]) )
+          _deletions[string { call }.erase(posn, 1)].emplace_back(call);
+}
+
+/*! \brief          Add a call to the database
+    \param  call    call to be added
+
+    Does nothing if the call is already in the database
+*/
+void fuzzy_database::operator+=(const string_view call)
+{ const auto [ it, inserted ] { _db[ _to_valid_size(call.length()) ].emplace(call) };
+
+  if (inserted)
+    _index(*it);                // index the copy in the set, which does not move while it remains in the set
+}
+
+/*! \brief          Remove a call from the database
+    \param  call    call to be removed
+    \return         whether <i>call</i> was actually removed
+
+    Does nothing and returns <i>false</i> if <i>call</i> is not in the database
+*/
+bool fuzzy_database::remove_call(const string& call)
+{ FUZZY_SET& ss { _db[ _to_valid_size(call.length()) ] };
+
+  const auto it { ss.find(call) };
+
+  if (it == ss.end())
+    return false;
+
+  _unindex(call);               // before the erasure, as the indices refer to the copy in the set
+  ss.erase(it);
+
+  return true;
+}
+
+/*! \brief          Set whether to match calls with one more or one fewer character than the key
+    \param  b       whether to match such calls
+
+    Matches differ from the key in exactly one position if this is not set, which is the default
+*/
+void fuzzy_database::insertions_and_deletions(const bool b)
+{ if (b != _insertions_and_deletions)
+  { _insertions_and_deletions = b;
+
+    if (_insertions_and_deletions)
+      _index_deletions();
+    else
+      _deletions.clear();
+  }
+}
+
 /*! \brief          Return matches
     \param  key     basic call against which to compare
     \return         fuzzy matches for <i>key</i>
 */
-//FUZZY_SET fuzzy_database::operator[](const string& key) const
 FUZZY_SET fuzzy_database::operator[](const string_view key) const
 { FUZZY_SET rv { };
 
   if (key.length() < 3)
     return rv;
 
-// if the key contains any characters that are interpreted by regex, we should return an empty set
+// the key may contain only characters that can appear in a call; in particular, it must not contain the wildcard
   if (key.find_first_not_of(CALLSIGN_CHARS) != string::npos)
     return rv;
 
-  const FUZZY_SET& ss { _db[ _to_valid_size(key.length()) ] };
+  auto add_matches { [&rv] (const FUZZY_INDEX& index, const string& variant)
+                       { if (const auto it { index.find(variant) }; it != index.end())
+                           FOR_ALL(it -> second, [&rv] (const string_view call) { rv += call; });
+                       } };
+
+// calls that differ from the key in one position
+  string variant { key };
 
   for (size_t posn { 0 }; posn < key.length(); ++posn)
-    rv += regex_matches<base_type<decltype(ss)>>(ss, (key.substr(0, posn) + '.' + key.substr(posn + 1)) );  // allow any character in one position
+  { variant[posn] = WILDCARD;
+    add_matches(_substitutions, variant);
+    variant[posn] = key[posn];
+  }
+
+  if (_insertions_and_deletions)
+  { add_matches(_deletions, variant);                 // calls that have one more character than the key
+
+    for (size_t posn { 0 }; posn < key.length(); ++posn)            // calls that have one fewer character than the key
+      if (const string shorter { string { key }.erase(posn, 1) }; contains(shorter))
+        rv += shorter;
+  }
 
 // 230116 do not include the key in the output set
   rv -= key;
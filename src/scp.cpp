@@ -27,11 +27,87 @@ using namespace      placeholders;
 
 extern message_stream ost;
 
+/*! \brief          Obtain an indexed call
+    \param  start   position of the start of the call in <i>_corpus</i>
+    \return         the call that starts at <i>start</i>
+*/
+string_view scp_database::_call_at(const uint32_t start) const
+{ const string_view remainder { string_view { _corpus }.substr(start) };
+
+  return remainder.substr(0, remainder.find(SEPARATOR));
+}
+
+/*! \brief          Is a call in the index?
+    \param  call    call to test
+    \return         whether <i>call</i> is in the index, regardless of whether it has since been removed
+*/
+bool scp_database::_is_indexed(const string_view call) const
+{ const auto it { ranges::lower_bound(_call_starts, call, less<> { }, [this] (const uint32_t start) { return _call_at(start); }) };
+
+  return ( (it != _call_starts.end()) and (_call_at(*it) == call) );
+}
+
+/// rebuild the index so that it contains all the calls
+void scp_database::_rebuild_index(void)
+{ vector<string> calls;
+
+  calls.reserve(size());
+
+  for (const uint32_t start : _call_starts)
+    if (const string_view call { _call_at(start) }; !_removed.contains(call))
+      calls.emplace_back(call);
+
+  calls.insert(calls.end(), _added.cbegin(), _added.cend());
+  SORT(calls);
+
+// build the corpus
+  _corpus.clear();
+  _call_starts.clear();
+
+  for (const string& call : calls)
+  { _call_starts.push_back(static_cast<uint32_t>(_corpus.length()));
+    _corpus += call;
+    _corpus += SEPARATOR;
+  }
+
+// sort the suffixes by the remainder of their call; a key never contains the separator, so comparisons across the end of a call are consistent with this order
+  vector<string_view> suffixes;
+
+  suffixes.reserve(_corpus.length() - calls.size());
+
+  for (const uint32_t start : _call_starts)
+  { const string_view call { _call_at(start) };
+
+    for (size_t posn { 0 }; posn < call.length(); ++posn)
+      suffixes.push_back(call.substr(posn));
+  }
+
+  SORT(suffixes);
+
+  _suffixes.clear();
+  _suffixes.reserve(suffixes.size());
+
+  for (const string_view suffix : suffixes)
+    _suffixes.push_back(static_cast<uint32_t>(suffix.data() - _corpus.data()));
+
+  _added.clear();
+  _removed.clear();
+}
+
 /// add a call
 void scp_database::operator+=(const string_view call)
 { if (call.length() >= 2)
-    for ( auto start_index : RANGE<unsigned int>(0, call.length() - 1) )
-      (_db[substring <std::string> (call, start_index, 2)]) += call;
+  { if (_removed.contains(call))
+    { _removed.erase(string(call));
+      _generation++;
+    }
+    else
+    { if (!_is_indexed(call) and !_added.contains(call))
+      { _added += call;
+        _generation++;
+      }
+    }
+  }
 }
 
 /*! \brief          Remove a call from the database
@@ -39,28 +115,25 @@ void scp_database::operator+=(const string_view call)
     \return         whether <i>call</i> was actually removed
 */
 bool scp_database::remove_call(const string_view call)
-{ bool rv { false };
-
-  if (call.length() >= 2)
-  { for ( auto start_index : RANGE<unsigned int>(0, call.length() - 1) )
-    { SCP_SET& ss { _db[substring <string> (call, start_index, 2)] };
+{ if (_added.erase(string(call)) == 1)
+  { _generation++;
+    return true;
+  }
 
-//      rv = (ss.erase(string(call)) == 1);       // key remains, regardless of whether the set of matches is empty; erase does not yet support string_view
-      rv = (ss.erase(call) == 1);       // key remains, regardless of whether the set of matches is empty; erase does not yet support string_view
-    }
+  if (_is_indexed(call) and !_removed.contains(call))
+  { _removed += call;
+    _generation++;
+    return true;
   }
 
-  return rv;
+  return false;
 }
 
 /*! \brief          Remove a call from the database
     \param  call    call to remove
 */
 void scp_database::operator-=(const string_view call)
-{ if (call.length() >= 2)
-    for ( auto start_index : RANGE<unsigned int>(0, call.length() - 1) )
-      _db[substring <std::string> (call, start_index, 2)].erase(string(call));       // key remains, regardless of whether the set of matches is empty; erase does not yet support string_view
-}
+{ remove_call(call); }
 
 /*! \brief          Return all the matches for a partial call
     \param  key     partial call
@@ -69,117 +142,130 @@ void scp_database::operator-=(const string_view call)
 SCP_SET scp_database::operator[](const string_view key)
 { if (key.length() < 2)
     return SCP_SET { };
-  
-  const string key_str { key };
-
-  if (key.length() == 2)         // trivial lookup
-  { _last_key = key_str;
-    _last_result = _db[key_str];    // might change _db
-    
-    return _last_result;
-  }
 
-// key length is > 2, look to the cache first
-  if (!_last_key.empty() and key.contains(_last_key))    // cache hit
-  { SCP_SET rv;
-  
-    for (const auto& cache_callsign : _last_result)
-      if (cache_callsign.contains(key))
-        rv += cache_callsign;
-      
-    _last_key = key_str;
-    _last_result = move(rv);
-
-    return _last_result;
-  }
-  
-// cache miss
-  const SCP_SET& calls { _db[substring <string> (key, 0, 2)] };
+  if (_index_is_stale())
+    _rebuild_index();
+
+// the suffixes that start with the key are contiguous in the suffix array
+  auto prefix { [this, &key] (const uint32_t posn) { return string_view { _corpus }.substr(posn, key.length()); } };
+
+  const auto [first, last] { ranges::equal_range(_suffixes, key, less<> { }, prefix) };
 
   SCP_SET rv;
 
-  for (const auto& callsign : calls)
+  for (auto it { first }; it != last; ++it)
+  { const uint32_t    start { *prev(ranges::upper_bound(_call_starts, *it)) };     // the start of the call that contains this suffix
+    const string_view call  { _call_at(start) };
+
+    if (!_removed.contains(call))
+      rv += call;
+  }
+
+  for (const auto& callsign : _added)
     if (callsign.contains(key))
       rv += callsign;
-    
-  _last_key = key_str;
-  _last_result = move(rv);
 
-  return _last_result;      
+  return rv;
 }
 
 /// empty the database; also clears the cache
 void scp_database::clear(void)
-{ _db.clear();
+{ _corpus.clear();
+  _call_starts.clear();
+  _suffixes.clear();
+  _added.clear();
+  _removed.clear();
   clear_cache();
 }
 
-/// clear the cache (without altering the database)
-void scp_database::clear_cache(void)
-{ _last_key.clear();
-  _last_result.clear();
+// -----------  scp_match_session  ----------------
 
-// must also clear the cache of any parents
-  FOR_ALL(_parents, [] (scp_databases* parent_p) { parent_p -> clear_cache_no_children(); } );
-}
+/*! \class  scp_match_session
+    \brief  Incremental SCP matching as a call is typed in a single window
+*/
 
-// -----------  scp_databases  ----------------
+/// discard the matches for any databases that have changed
+void scp_match_session::_discard_changed_databases(void)
+{ for (size_t n { 0 }; n < _dbs.size(); ++n)
+  { if (const uint64_t generation { _dbs[n] -> generation() }; generation != _generations[n])
+    { for (entry& e : _stack)
+        e.matches[n] = nullopt;
+
+      _generations[n] = generation;
+    }
+  }
+}
 
 /// add a database to those that are consulted
-void scp_databases::add_db(scp_database& db)
-{ _vec += (&db);
-  db.add_parent(*this);
+void scp_match_session::add_db(scp_database& db)
+{ _dbs += (&db);
+  _generations += db.generation();
+  _stack.clear();                                   // every entry needs matches for the new database
 }
 
-/// return matches
-SCP_SET scp_databases::operator[](const string_view key)
-{ if (key.length() < 2)
-    return SCP_SET { };
+/*! \brief          Return all the matches for a partial call
+    \param  key     partial call
+    \return         all the partial matches for <i>key</i>, in all the databases
 
-  if (key.length() == 2)         // trivial lookup
-  { _last_key = key;
-    _last_result.clear();
+    The returned reference is valid until the next call to a non-const member function
+*/
+const SCP_SET& scp_match_session::operator[](const string_view key)
+{ static const SCP_SET no_matches { };
 
-    for (auto& db_p : _vec)
-    { scp_database& db { *(db_p) };
+  if (key.length() < 2)
+    return no_matches;
 
-      _last_result += db[key];
-    }
+  _discard_changed_databases();
 
-    return _last_result;
-  }
+// discard the keys that are not contained in the new key; after a backspace, the new key is often on the stack already
+  while (!_stack.empty() and !key.contains(_stack.back().key))
+    _stack.pop_back();
 
-// key length is > 2; look to the cache first
-  if (!_last_key.empty() and key.contains(_last_key))    // cache hit
-  { SCP_SET rv;
+  if (_stack.empty() or (_stack.back().key != key))
+    _stack.push_back( { string { key }, vector<optional<SCP_SET>>(_dbs.size()), SCP_SET { } } );
 
-    for (const auto& cache_callsign : _last_result)
-      if (cache_callsign.contains(key))
-        rv += cache_callsign;
+  entry& top { _stack.back() };
 
-    _last_key = key;
-    _last_result = move(rv);
+  bool recalculated { false };
 
-    return _last_result;
-  }
+  for (size_t n { 0 }; n < _dbs.size(); ++n)
+  { if (top.matches[n])
+      continue;
 
-// key length is > 2; cache miss
-  SCP_SET rv;
+// the nearest entry below the top that has matches for this database; every match for the key is among them
+    const auto below { find_if(next(_stack.rbegin()), _stack.rend(), [n] (const entry& e) { return e.matches[n].has_value(); }) };
+
+    if (below == _stack.rend())
+      top.matches[n] = (*_dbs[n])[key];
+    else
+    { SCP_SET matches;
 
-  for (auto& db_p : _vec)
-  { scp_database& db { *(db_p) };
+      for (const string& callsign : *(below -> matches[n]))
+        if (callsign.contains(key))
+          matches += callsign;
 
-    const SCP_SET& calls { db[substring <string> (key, 0, 2)] };
+      top.matches[n] = move(matches);
+    }
 
-    for (const auto& callsign : calls)
-      if (callsign.contains(key))
-        rv += callsign;
+    recalculated = true;
   }
 
-  _last_key = key;
-  _last_result = move(rv);
+  if (recalculated)
+  { top.all_matches.clear();
 
-  return _last_result;
+    for (const auto& matches : top.matches)
+      top.all_matches.insert(matches -> cbegin(), matches -> cend());
+  }
+
+  return top.all_matches;
+}
+
+// -----------  scp_databases  ----------------
+
+/// add a database to those that are consulted
+void scp_databases::add_db(scp_database& db)
+{ _vec += (&db);
+  _session.add_db(db);
 }
 
 /// clear the cache; also clear the caches of any children
@@ -191,6 +277,5 @@ void scp_databases::clear_cache(void)
 
 /// clear the cache without clearing the caches of any children
 void scp_databases::clear_cache_no_children(void)
-{ _last_key.clear();
-  _last_result.clear();
+{ _session.clear();
 }
@@ -29,6 +29,7 @@
 #include <fcntl.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
+#include <sys/eventfd.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -64,6 +65,82 @@ void fd_set_option(const int opt, const int fd)  // e.g., O_NONBLOCK
     throw socket_support_error(SOCKET_SUPPORT_FLAG_ERROR);
 }
 
+// ---------------------------------  line_buffer  -------------------------------
+
+/// update <i>_complete</i> after data have been added from position <i>from</i> onwards
+void line_buffer::_update_complete(const size_t from)
+{ const size_t      start { (from == 0) ? 0 : from - 1 };     // the terminator might straddle the old end of the data
+  const string_view added { _data.data() + start, _size - start };
+
+  if (const size_t posn { added.rfind("\r\n"sv) }; posn != string_view::npos)
+    _complete = start + posn + 2;
+}
+
+/*! \brief          Append data
+    \param  str     data to append
+*/
+void line_buffer::append(const string_view str)
+{ lock_guard<mutex> lg(_mtx);
+
+  if (_size + str.size() > _data.size())
+    _data.resize(max(_data.size() * 2, _size + str.size()));
+
+  const size_t old_size { _size };
+
+  str.copy(_data.data() + _size, str.size());
+  _size += str.size();
+  _update_complete(old_size);
+}
+
+/*! \brief          Move the complete lines to another buffer
+    \param  dest    destination buffer; must not be in use by another thread
+
+    Any data already in <i>dest</i> are discarded. Only the trailing partial line (if any) is copied; it remains in this buffer
+*/
+void line_buffer::move_complete_lines_to(line_buffer& dest)
+{ scoped_lock lck(_mtx, dest._mtx);
+
+  if (dest._data.size() < _data.size())                  // so that the partial line is guaranteed to fit after the swap
+    dest._data.resize(_data.size());
+
+  swap(_data, dest._data);
+
+  const size_t partial_length { _size - _complete };
+
+  if (partial_length)
+    copy_n(dest._data.data() + _complete, partial_length, _data.data());
+
+  dest._size = dest._complete = _complete;
+  _size = partial_length;
+  _complete = 0;
+}
+
+/*! \brief          Append the complete lines to another buffer
+    \param  dest    destination buffer; must contain only complete lines
+
+    The trailing partial line (if any) remains in this buffer
+*/
+void line_buffer::append_complete_lines_to(line_buffer& dest)
+{ scoped_lock lck(_mtx, dest._mtx);
+
+  if (_complete == 0)
+    return;
+
+  if (dest._size + _complete > dest._data.size())
+    dest._data.resize(max(dest._data.size() * 2, dest._size + _complete));
+
+  copy_n(_data.data(), _complete, dest._data.data() + dest._size);
+  dest._size += _complete;
+  dest._complete = dest._size;                            // every line that has been appended is complete
+
+  const size_t partial_length { _size - _complete };
+
+  copy(_data.data() + _complete, _data.data() + _size, _data.data());      // the ranges may overlap, but the destination is first
+
+  _size = partial_length;
+  _complete = 0;
+}
+
 // ---------------------------------  tcp_socket  -------------------------------
 
 constexpr struct linger DEFAULT_TCP_LINGER { false, 0 };      // the default is not to linger
@@ -626,6 +703,61 @@ string tcp_socket::read(const unsigned long timeout_secs) const
   return rv;
 }
 
+/*! \brief          Receive, without waiting, whatever data are available directly into a line buffer
+    \param  buf     buffer into which data are to be received
+    \return         number of bytes received
+
+    Throws a tcp_socket_error if the far end has closed the connection or an error occurs
+*/
+size_t tcp_socket::read_available(line_buffer& buf) const
+{ constexpr int MAX_READS { 16 };         // don't let one busy connection starve any others that are being serviced by the same thread
+
+  size_t rv { 0 };
+
+  SAFELOCK(_tcp_socket);
+
+  for (int n_reads { 0 }; n_reads < MAX_READS; ++n_reads)
+  { const ssize_t status { buf.fill([this] (char* cp, const size_t n) { return ::recv(_sock, cp, n, MSG_DONTWAIT); }) };
+
+    if (status > 0)
+    { rv += static_cast<size_t>(status);
+      continue;
+    }
+
+    if (status == 0)
+      throw tcp_socket_error(TCP_SOCKET_CLOSED_BY_PEER, "Connection closed by peer"s);
+
+    if ( (errno == EAGAIN) or (errno == EWOULDBLOCK) )      // nothing more to read
+      break;
+
+    if (errno != EINTR)
+    { const string msg { "errno = "s + ::to_string(errno) + ": "s + strerror(errno) };
+
+      ost << "Throwing TCP_SOCKET_ERROR_IN_RECV in read_available(); " << msg << endl;
+      throw tcp_socket_error(TCP_SOCKET_ERROR_IN_RECV, msg);
+    }
+  }
+
+  return rv;
+}
+
+/*! \brief          Set or unset non-blocking mode
+    \param  torf    whether the socket is to be non-blocking
+
+    Throws a tcp_socket_error if an error occurs
+*/
+void tcp_socket::non_blocking(const bool torf)
+{ SAFELOCK(_tcp_socket);
+
+  const int flags { fcntl(_sock, F_GETFL, 0) };
+
+  if (flags == -1)
+    throw tcp_socket_error(TCP_SOCKET_UNABLE_TO_GET_OPTION, "Error getting file status flags"s);
+
+  if (fcntl(_sock, F_SETFL, (torf ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK))) == -1)
+    throw tcp_socket_error(TCP_SOCKET_UNABLE_TO_SET_OPTION, "Error setting O_NONBLOCK"s);
+}
+
 /*! \brief              Set the idle time before a keep-alive is sent
     \param  seconds     time to wait idly before a keep-alive is sent, in seconds
 */
@@ -1011,45 +1143,115 @@ bool icmp_socket::ping(void)
   return rv;
 }
 
-#if 0
-not ready for use
 // ------------------------------------  epoller  ----------------------------------
 
 /*! \class  epoller
     \brief  Encapsulate and manage Linux epoll functions
 */
 
+/// constructor
 epoller::epoller(void)
-{ const int status { epoll_create1(0) };
+{ _fd = epoll_create1(EPOLL_CLOEXEC);
 
-  if (status == -1)
-    throw epoll_error(EPOLL_UNABLE_TO_CREATE, "Error creating epoll object");
+  if (_fd == -1)
+    throw epoll_error(EPOLL_UNABLE_TO_CREATE, "Error creating epoll object: "s + strerror(errno));
 
-  _fd = status;
+  _wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
 
-  _ev.events = EPOLLIN;     // temporary: just show interest in pollin; see man epoll(7)
-//  _ev.data.fd = _fd;
-//
-//  status = epoll_ctl(_fd, EPOLL_CTL_ADD, listen_sock, &ev
- //
- //              if (epoll_ctl(epollfd, EPOLL_CTL_ADD, listen_sock, &ev) == -1) {
- //              perror("epoll_ctl: listen_sock");
-//               exit(EXIT_FAILURE);
-//           }
+  if (_wake_fd == -1)
+  { ::close(_fd);
+    throw epoll_error(EPOLL_UNABLE_TO_CREATE, "Error creating eventfd for epoll object: "s + strerror(errno));
+  }
+
+  try
+  { add(_wake_fd, WAKE_TAG);
+  }
 
-//  }
+  catch (...)
+  { ::close(_wake_fd);
+    ::close(_fd);
+    throw;
+  }
+}
 
+/// destructor
+epoller::~epoller(void)
+{ ::close(_wake_fd);
+  ::close(_fd);
 }
 
-void epoller::operator+=(const int file_descriptor)
-{ _ev.data.fd = file_descriptor;
+/*! \brief                      Register a file descriptor
+    \param  file_descriptor     file descriptor of interest
+    \param  tag                 value to be returned by wait() when <i>file_descriptor</i> is ready
+    \param  events              events of interest
 
-  const int status { epoll_ctl(_fd, EPOLL_CTL_ADD, file_descriptor, &_ev) };
+    Throws an epoll_error if the descriptor cannot be added
+*/
+void epoller::add(const int file_descriptor, const uint64_t tag, const uint32_t events)
+{ struct epoll_event ev { };
 
-  if (status == -1)
-    throw epoll_error(EPOLL_UNABLE_TO_ADD_DESCRIPTOR, "Error adding file descriptor to epoll");
+  ev.events = events;
+  ev.data.u64 = tag;
+
+  if (epoll_ctl(_fd, EPOLL_CTL_ADD, file_descriptor, &ev) == 0)
+    return;
+
+  if ( (errno == EEXIST) and (epoll_ctl(_fd, EPOLL_CTL_MOD, file_descriptor, &ev) == 0) )       // already registered; just update it
+    return;
+
+  throw epoll_error(EPOLL_UNABLE_TO_ADD_DESCRIPTOR, "Error adding file descriptor "s + ::to_string(file_descriptor) + " to epoll: "s + strerror(errno));
+}
+
+/*! \brief                      Unregister a file descriptor
+    \param  file_descriptor     file descriptor no longer of interest
+
+    Does nothing if <i>file_descriptor</i> is not registered or has been closed
+*/
+void epoller::operator-=(const int file_descriptor)
+{ if ( (epoll_ctl(_fd, EPOLL_CTL_DEL, file_descriptor, nullptr) == -1) and (errno != ENOENT) and (errno != EBADF) )
+    throw epoll_error(EPOLL_UNABLE_TO_REMOVE_DESCRIPTOR, "Error removing file descriptor "s + ::to_string(file_descriptor) + " from epoll: "s + strerror(errno));
+}
+
+/*! \brief              Wait for registered file descriptors to become ready
+    \param  max_wait    maximum time to wait
+    \param  max_events  maximum number of events to return
+    \return             the ready events; empty if the wait timed out or was interrupted by a signal
+
+    Throws an epoll_error if an error occurs
+*/
+vector<struct epoll_event> epoller::wait(const milliseconds max_wait, const int max_events) const
+{ vector<struct epoll_event> rv(max_events);
+
+  const int n_events { epoll_wait(_fd, rv.data(), max_events, static_cast<int>(max_wait.count())) };
+
+  if (n_events == -1)
+  { if (errno == EINTR)
+      return { };
+
+    throw epoll_error(EPOLL_WAIT_ERROR, "Error in epoll_wait(): "s + strerror(errno));
+  }
+
+  rv.resize(n_events);
+
+// consume any wake-up, so that the eventfd is ready again only after the next call to wake()
+  for (const auto& ev : rv)
+  { if (ev.data.u64 == WAKE_TAG)
+    { uint64_t value;
+
+      [[maybe_unused]] const ssize_t status { ::read(_wake_fd, &value, sizeof(value)) };
+    }
+  }
+
+  return rv;
+}
+
+/// interrupt a wait() in another thread
+void epoller::wake(void)
+{ const uint64_t value { 1 };
+
+  if ( (::write(_wake_fd, &value, sizeof(value)) == -1) and (errno != EAGAIN) )      // EAGAIN => a wake-up is already pending
+    throw epoll_error(EPOLL_UNABLE_TO_WAKE, "Error waking epoll: "s + strerror(errno));
 }
-#endif
 
 // ---------------------------------------------- generic socket functions ---------------------
 
@@ -54,6 +54,8 @@ void running_statistics::_insert_callsign_mult(const string_view mult_name, cons
 { if (_callsign_mults_used and !mult_value.empty())     // do we actually have to do anything?
   { SAFELOCK(statistics);
 
+    _generation++;
+
     if (known_callsign_mult_name(mult_name))                                                    // do we already know about this mult name?
     { multiplier& mult { (_callsign_multipliers.find(mult_name)) -> second };
 
@@ -284,6 +286,8 @@ string running_statistics::_summary_string(const contest_rules& rules, const set
 void running_statistics::prepare(const cty_data& country_data, const drlog_context& context, const contest_rules& rules)
 { SAFELOCK(statistics);
 
+  _generation++;
+
   _callsign_mults_used = rules.callsign_mults_used();
   _country_mults_used = rules.country_mults_used();
   _auto_country_mults = context.auto_remaining_country_mults();
@@ -423,7 +427,12 @@ bool running_statistics::is_needed_country_mult(const string_view callsign, cons
 bool running_statistics::add_known_country_mult(const string_view str, const contest_rules& rules)
 { SAFELOCK(statistics);
 
-  return ( (rules.country_mults().contains(str)) ? _country_multipliers.add_known(str) : false );
+  if (!rules.country_mults().contains(str) or !_country_multipliers.add_known(str))
+    return false;
+
+  _generation++;
+
+  return true;
 }
 
 /*! \brief          Add a QSO to the ongoing statistics
@@ -433,7 +442,9 @@ bool running_statistics::add_known_country_mult(const string_view str, const con
 */
 void running_statistics::add_qso(const QSO& qso, const logbook& log, const contest_rules& rules)
 { SAFELOCK(statistics);
-  
+
+  _generation++;
+
   const BAND         b       { qso.band() };
   const unsigned int band_nr { to_uint(b) };
   const MODE         mo      { qso.mode() };
@@ -511,7 +522,9 @@ bool running_statistics::add_known_exchange_mult(const string_view name, const s
   for (auto& [ field_name, mult ] : _exchange_multipliers)   // std::vector<std::pair<std::string /* field name */, multiplier> > _exchange_multipliers;
   { if (field_name == name)
     { if (mult.add_known(MULT_VALUE(name, value)))
+      { _generation++;
         return true;
+      }
     }
   }
 
@@ -552,7 +565,9 @@ bool running_statistics::add_worked_exchange_mult(const string_view field_name,
     for (auto& [ fn, mult ] : _exchange_multipliers)   // std::vector<std::pair<std::string /* field name */, multiplier> > _exchange_multipliers;
     { if (fn == field_name)
 //        return ( mult.add_worked(mv, static_cast<BAND>(band_nr), static_cast<MODE>(mode_nr)) );
+      { _generation++;
         return ( mult.add_worked(mv, b, m) );
+      }
     }
   }
 
@@ -564,7 +579,9 @@ bool running_statistics::add_worked_exchange_mult(const string_view field_name,
     \param  rules   contest rules
 */
 void running_statistics::rebuild(const logbook& log, const contest_rules& rules)
-{ logbook l;
+{ _generation++;                    // even if the log is empty
+
+  logbook l;
   l.reserve(log.size());
 
 // done this way so as to account for dupes correctly
@@ -746,6 +763,8 @@ STRING_MAP<MULT_SET /* values */ > running_statistics::worked_exchange_mults(con
 void running_statistics::clear_info(void)
 { SAFELOCK(statistics);
 
+  _generation++;
+
   _n_dupes    = move(decltype(_n_dupes)   ( { { } } ));
   _n_qsos     = move(decltype(_n_qsos)    ( { { } } ));
   _qso_points = move(decltype(_qso_points)( { { } } ));